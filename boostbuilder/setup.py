@@ -78,9 +78,10 @@ class main(object):
         return os.path.join('build','lib.win32-2.5\jflow\lib')
            
         
-    def boost(self, lib = 'python', extralib = None):
+    def boost(self, lib = 'python', extralib = None, exclude = None):
         '''
-        Create the a boost library extension object
+        Create the a boost library extension object.
+        Sources in the subdirectories listed in exclude are not compiled.
         '''
         boost = self.boostdir()
         lib   = str(lib).lower()
@@ -88,11 +89,16 @@ class main(object):
         boostlib = 'boost_%s' % lib
         define_macros = [('BOOST_ALL_NO_LIB',1),
                          ('BOOST_PYTHON_SOURCE',None)]
+        if lib == 'thread':
+            define_macros.append(('BOOST_THREAD_BUILD_DLL',1))
         #if not self.debug:
         #    define_macros.append(('NDEBUG',None))
             
         if os.path.isdir(boostsrc):
             sources = self.getcpp(boostsrc)
+            for ex in exclude or []:
+                exdir   = os.path.join(boostsrc,ex)
+                sources = [s for s in sources if not s.startswith(exdir)]
             return Extension(boostlib,
                              external_library = True,
                              source_directory = boostsrc,
@@ -1,4 +1,4 @@
 
 BOOST_SOURCE  = 'D:/workspace/packages/libs/boost'
 NUMPY_INCLUDE = 'C:/Programs/Python26/Lib/site-packages/numpy/core/include'
-BOOST_LIBS    = ['python']
\ No newline at end of file
+BOOST_LIBS    = ['python','thread']
\ No newline at end of file
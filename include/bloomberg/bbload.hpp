@@ -0,0 +1,140 @@
+//
+/// \file
+/// \brief Load generator for blb, over the loopback Bloomberg API
+/// \ingroup bloomberg
+///
+/// bbload connects a blb to a bbreplay server on the local host, monitors
+/// a number of securities and measures how many ticks per second blb
+/// decodes and publishes to a tick sink. A benchmark is a small program
+/// linked with boost thread and jflib:
+///
+/// \code
+/// #define BB_LOOPBACK_IMPLEMENTATION
+/// #include <bbload.hpp>
+///
+/// int main()  {
+///     bloomberg::bbreplay::options opts;
+///     opts.rate = 1e6;
+///     bloomberg::bbloadresult r = bloomberg::bbload(opts,100,10.);
+///     std::cout << r.rate << " ticks per second, " << r.dropped << " dropped" << std::endl;
+/// }
+/// \endcode
+///
+
+
+#ifndef   __BLOOMBERG_LOAD_QM_HPP__
+#define   __BLOOMBERG_LOAD_QM_HPP__
+
+#include <jflib/error.hpp>
+#include <cstring>
+#include <sstream>
+#include <sys/select.h>
+#include <bbloopback.hpp>
+#include <blb.hpp>
+#include <bbreplay.hpp>
+
+
+namespace bloomberg {
+
+
+/** \brief Result and history holder of a load test, counts what it is given
+ * \ingroup bloomberg
+ */
+struct blbcount  {
+	blbcount():n(0){}
+	long	n;
+	template<class T>
+	void	append(const T&) {++n;}
+};
+
+
+/// \brief Outcome of bbload
+struct bbloadresult  {
+	bbloadresult():sent(0),ticks(0),dropped(0),messages(0),seconds(0),rate(0){}
+	/// \brief Ticks sent by the server
+	long	sent;
+	/// \brief Ticks received through the tick sink
+	long	ticks;
+	/// \brief Ticks decoded but not published, the pool was exhausted or the ring full
+	long	dropped;
+	/// \brief Calls to blb::responce which received feeds or ticks
+	long	messages;
+	/// \brief Seconds until the last message was decoded
+	double	seconds;
+	/// \brief Ticks decoded per second, published or dropped
+	double	rate;
+};
+
+
+/** \brief Stream ticks of securities from a bbreplay server to a blb for
+ * a number of seconds
+ * \ingroup bloomberg
+ *
+ * The blb is driven by blb::responce on the calling thread and its tick
+ * sink is drained after each call, so the result measures decoding and
+ * publishing without a consumer thread. The pool and the ring of the sink
+ * hold pool records. With stats, the blb records its latencies and counts
+ * into it and each tick taken from the ring is timed.
+ */
+inline bbloadresult bbload(const bbreplay::options& opts, std::size_t securities, double seconds,
+						   std::size_t pool = 65536, BLBSTATS stats = BLBSTATS())  {
+	using namespace jflib;
+	using namespace boost::posix_time;
+	typedef blb<blbcount,LIVEDATA,blbcount,int>		blb_type;
+
+	QM_REQUIRE(securities > 0,"At least one security is needed");
+	// The server streams for the given seconds only, a client which cannot
+	// keep up is not flooded past the end of the test
+	bbreplay::options sopts(opts);
+	sopts.duration = seconds;
+	bbreplay server(sopts);
+	server.start();
+
+	BLBCON con(new blbcon);
+	QM_REQUIRE(con->connect(server.port()) == 0,"Could not connect to the replay server on port " << server.port());
+	blb_type::BLB b = blb_type::create(con);
+	BLBTICKPOOL ticks(new blbtickpool(pool));
+	BLBTICKRING ring(new blbtickring(pool));
+	b->set_tick_sink(ticks,ring);
+	b->set_stats(stats);
+
+	for(std::size_t i=0;i<securities;++i)  {
+		std::ostringstream ticker;
+		ticker << "LOAD" << i << " Equity";
+		b->get_live_feed(ticker.str());
+	}
+
+	bbloadresult r;
+	ptime begin = microsec_clock::universal_time();
+	ptime end   = begin + microseconds(long(1e6*seconds));
+	ptime now   = begin;
+	ptime last  = begin;
+	blbtick* t;
+	while(now < end)  {
+		blb_type::BLBFEEDR got = b->responce();
+		now = microsec_clock::universal_time();
+		long taken = r.ticks;
+		while(ring->pop(t))  {
+			if(stats)
+				stats->handoff(*t);
+			ticks->release(t);
+			++r.ticks;
+		}
+		if(!got && taken == r.ticks) continue;
+		++r.messages;
+		last = now;
+	}
+	server.stop();
+
+	r.sent    = server.sent();
+	r.dropped = b->tick_dropped();
+	r.seconds = 1e-6*(last - begin).total_microseconds();
+	r.rate    = r.seconds > 0 ? (r.ticks + r.dropped)/r.seconds : 0;
+	return r;
+}
+
+
+}
+
+
+#endif	//	__BLOOMBERG_LOAD_QM_HPP__
@@ -0,0 +1,247 @@
+//
+/// \file
+/// \brief Loopback stand-in of the Bloomberg API
+/// \ingroup bloomberg
+///
+/// Implements the subset of bbapi.h used by blbcon and blb (connection,
+/// header, tick monitor and stop, tick data, multiple history and static data)
+/// over a TCP connection to a bbreplay server on the local host, so that
+/// blb can be exercised and benchmarked without a terminal.
+///
+/// Define BB_LOOPBACK_IMPLEMENTATION in exactly one translation unit before
+/// including this file, and link it instead of the Bloomberg library.
+///
+/// Messages keep the in-memory layout of bbapi.h, client and server must
+/// run on the same machine.
+///
+
+
+#ifndef   __BLOOMBERG_LOOPBACK_QM_HPP__
+#define   __BLOOMBERG_LOOPBACK_QM_HPP__
+
+#include <bbapi.h>
+#include <vector>
+#include <cstring>
+#include <cstddef>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+
+#define BB_LOOPBACK_MAX_ITEMS		10
+#define BB_LOOPBACK_KEY_SIZE		32
+
+
+namespace bloomberg { namespace loopback {
+
+
+	/// \brief A request sent by the client, service_code tells which
+	struct request  {
+		int4	service_code;
+		int4	request_id;
+		int4	num_securities;
+		int4	num_fields;
+		int4	start, end;
+		int4	fields[BB_LOOPBACK_MAX_ITEMS];
+		char	securities[BB_LOOPBACK_MAX_ITEMS][BB_LOOPBACK_KEY_SIZE];
+	};
+
+	/**
+	 * \brief Header of a message sent by the server, followed by size bytes
+	 *
+	 * The message starts with a bb_comm_header_t. In BB_SVC_GETDATAX
+	 * messages field_ptr holds offsets from the start of the message,
+	 * bb_rcvdata turns them into pointers.
+	 */
+	struct frame  {
+		int4	size;
+		int4	service_code;
+	};
+
+
+	/// \brief Client side of a connection, received bytes are buffered until a message is complete
+	struct connection  {
+		connection(int s):sock(s),next_id(0),buffer(1 << 16),begin(0),end(0),closed(false){}
+
+		int					sock;
+		int4				next_id;
+		std::vector<char>	buffer;
+		std::size_t			begin, end;
+		bool				closed;
+
+		/// \brief Read what the socket holds without blocking, at most the free space
+		/// of the buffer which only grows when a message does not fit
+		void fill()  {
+			if(begin == end)
+				begin = end = 0;
+			else if(begin > 0)  {
+				std::memmove(&buffer[0],&buffer[begin],end - begin);
+				end  -= begin;
+				begin = 0;
+			}
+			if(end == buffer.size())
+				buffer.resize(2*buffer.size());
+			ssize_t n = recv(sock,&buffer[end],buffer.size() - end,MSG_DONTWAIT);
+			if(n > 0)
+				end += n;
+			else if(n == 0)
+				closed = true;
+		}
+
+		/// \brief The next complete message, 0 if none
+		const frame* next() const  {
+			if(end - begin < sizeof(frame)) return 0;
+			const frame* f = reinterpret_cast<const frame*>(&buffer[begin]);
+			return end - begin < sizeof(frame) + f->size ? 0 : f;
+		}
+
+		bool send(const void* data, std::size_t size)  {
+			const char* p = static_cast<const char*>(data);
+			while(size)  {
+				ssize_t n = ::send(sock,p,size,0);
+				if(n <= 0) return false;
+				p    += n;
+				size -= n;
+			}
+			return true;
+		}
+
+		int4 submit(request& r)  {
+			r.request_id = ++next_id;
+			return this->send(&r,sizeof(r)) ? r.request_id : ExitFAILCONNECTION;
+		}
+	};
+
+
+	inline void copykeys(request& r, int4 n, const char* keys)  {
+		r.num_securities = n < BB_LOOPBACK_MAX_ITEMS ? n : BB_LOOPBACK_MAX_ITEMS;
+		for(int4 i=0;i<r.num_securities;++i)
+			std::strncpy(r.securities[i],keys + i*BB_LOOPBACK_KEY_SIZE,BB_LOOPBACK_KEY_SIZE - 1);
+	}
+
+	inline void copyfields(request& r, int4 n, const int4* fields)  {
+		r.num_fields = n < BB_LOOPBACK_MAX_ITEMS ? n : BB_LOOPBACK_MAX_ITEMS;
+		for(int4 i=0;i<r.num_fields;++i)
+			r.fields[i] = fields[i];
+	}
+
+	inline request newrequest(int4 code)  {
+		request r;
+		std::memset(&r,0,sizeof(r));
+		r.service_code = code;
+		return r;
+	}
+
+}}
+
+
+#ifdef	BB_LOOPBACK_IMPLEMENTATION
+
+ExternC bb_connect_t* STDCALL bb_connect(int4 port)  {
+	int s = socket(AF_INET,SOCK_STREAM,0);
+	if(s < 0) return 0;
+	sockaddr_in addr;
+	std::memset(&addr,0,sizeof(addr));
+	addr.sin_family      = AF_INET;
+	addr.sin_port        = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if(connect(s,(sockaddr*)&addr,sizeof(addr)) != 0)  {
+		close(s);
+		return 0;
+	}
+	int one = 1;
+	setsockopt(s,IPPROTO_TCP,TCP_NODELAY,&one,sizeof(one));
+	return new bloomberg::loopback::connection(s);
+}
+
+ExternC int4 STDCALL bb_disconnect(bb_connect_t* c)  {
+	bloomberg::loopback::connection* con = static_cast<bloomberg::loopback::connection*>(c);
+	if(!con) return ExitFAILCONNECTION;
+	close(con->sock);
+	delete con;
+	return ExitOK;
+}
+
+ExternC int4 STDCALL bb_getsocket(bb_connect_t* c)  {
+	return static_cast<bloomberg::loopback::connection*>(c)->sock;
+}
+
+ExternC int4 STDCALL bb_setuser(bb_connect_t*, int4*)  {
+	return 0;
+}
+
+ExternC int4 STDCALL bb_getheaderx(bb_connect_t* c, int4, int4, int4 n, char* keys)  {
+	using namespace bloomberg::loopback;
+	request r = newrequest(BB_SVC_GETHEADERX);
+	copykeys(r,n,keys);
+	return static_cast<connection*>(c)->submit(r);
+}
+
+ExternC int4 STDCALL bb_tickmntrx(bb_connect_t* c, int4 n, char* keys, int4)  {
+	using namespace bloomberg::loopback;
+	request r = newrequest(BB_SVC_TICKMONITORX);
+	copykeys(r,n,keys);
+	return static_cast<connection*>(c)->submit(r);
+}
+
+// The monitor ids are sent in the fields of the request
+ExternC int4 STDCALL bb_stopmntr(bb_connect_t* c, int4 n, int4* monids)  {
+	using namespace bloomberg::loopback;
+	request r = newrequest(BB_SVC_STOPMONITOR);
+	copyfields(r,n,monids);
+	return static_cast<connection*>(c)->submit(r);
+}
+
+ExternC int4 STDCALL bb_mgethistoryx(bb_connect_t* c, int4 n, char* keys, int4*, int4 start, int4 end,
+									 int4 nf, int4* fields, int4)  {
+	using namespace bloomberg::loopback;
+	request r = newrequest(BB_SVC_MGETHISTORYX);
+	copykeys(r,n,keys);
+	copyfields(r,nf,fields);
+	r.start = start;
+	r.end   = end;
+	return static_cast<connection*>(c)->submit(r);
+}
+
+ExternC int4 STDCALL bb_getdatax(bb_connect_t* c, int4 n, int4*, char* keys, int4 nf, int4* fields,
+								 int4, int4*, char*)  {
+	using namespace bloomberg::loopback;
+	request r = newrequest(BB_SVC_GETDATAX);
+	copykeys(r,n,keys);
+	copyfields(r,nf,fields);
+	return static_cast<connection*>(c)->submit(r);
+}
+
+ExternC int4 STDCALL bb_sizeof_nextmsg(bb_connect_t* c)  {
+	bloomberg::loopback::connection* con = static_cast<bloomberg::loopback::connection*>(c);
+	const bloomberg::loopback::frame* f = con->next();
+	if(!f)  {
+		con->fill();
+		f = con->next();
+	}
+	if(f) return f->size;
+	return con->closed ? ExitFAILRECEIVE : BB_SVC_INCOMPLETE;
+}
+
+ExternC int4 STDCALL bb_rcvdata(bb_connect_t* c, void* data, unsigned int4 size)  {
+	bloomberg::loopback::connection* con = static_cast<bloomberg::loopback::connection*>(c);
+	const bloomberg::loopback::frame* f = con->next();
+	if(!f) return BB_SVC_INCOMPLETE;
+	if(size < unsigned(f->size)) return ExitFAILRECEIVEBUFFER;
+	int4 code = f->service_code;
+	std::memcpy(data,f + 1,f->size);
+	con->begin += sizeof(*f) + f->size;
+	if(code == BB_SVC_GETDATAX)  {
+		bb_msg_fieldsx_t* m = static_cast<bb_msg_fieldsx_t*>(data);
+		for(int4 i=0;i<m->comm_header.num_items && i<BB_LOOPBACK_MAX_ITEMS;++i)
+			m->field_ptr[i] = static_cast<char*>(data) + reinterpret_cast<std::ptrdiff_t>(m->field_ptr[i]);
+	}
+	return code;
+}
+
+#endif	//	BB_LOOPBACK_IMPLEMENTATION
+
+
+#endif	//	__BLOOMBERG_LOOPBACK_QM_HPP__
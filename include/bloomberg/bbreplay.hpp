@@ -0,0 +1,462 @@
+//
+/// \file
+/// \brief Replay server for the loopback Bloomberg API
+/// \ingroup bloomberg
+///
+/// bbreplay listens on the local host and answers the requests of the
+/// loopback stand-in (see bbloopback.hpp): headers, tick monitors and their
+/// stop, multiple history and static data. Once securities are monitored it
+/// streams ticks for them, either a recorded stream replayed in a loop or
+/// a synthetic random walk, at a configurable rate.
+///
+
+
+#ifndef   __BLOOMBERG_REPLAY_QM_HPP__
+#define   __BLOOMBERG_REPLAY_QM_HPP__
+
+#include <bbloopback.hpp>
+#include <jflib/error.hpp>
+
+#include <map>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <sstream>
+#include <poll.h>
+#include <boost/bind.hpp>
+#include <boost/atomic.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/date_time/gregorian/gregorian.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+
+namespace bloomberg {
+
+
+/** \brief Loopback server replaying ticks to a blbcon
+ * \ingroup bloomberg
+ *
+ * One client is served at a time, on a thread of the server.
+ */
+class bbreplay : boost::noncopyable {
+public:
+	typedef std::size_t		size_type;
+
+	/// \brief A tick of a recorded stream
+	struct tick  {
+		tick():action(bTickTRADE),price(0),size(0){}
+		std::string		ticker;
+		int4			action;
+		double			price;
+		int4			size;
+	};
+	typedef std::vector<tick>	tick_list;
+
+	struct options  {
+		options():port(0),rate(0),duration(0),batch(BB_MAX_TICKS),seed(1){}
+		/// \brief Port to listen on, any free port if 0
+		int4		port;
+		/// \brief Ticks per second, as fast as possible if 0
+		double		rate;
+		/// \brief Seconds of streaming once a security is monitored, no limit if 0
+		double		duration;
+		/// \brief Ticks per message
+		int4		batch;
+		unsigned	seed;
+	};
+
+	explicit bbreplay(const options& opts = options());
+	~bbreplay();
+
+	/// \brief Port the server listens on
+	int4		port()		const {return m_port;}
+	/// \brief Ticks sent so far
+	long		sent()		const {return m_sent.load(boost::memory_order_relaxed);}
+
+	/// \brief Replay ticks in a loop instead of a random walk. Must be called before start
+	void		replay(const tick_list& ticks);
+	/// \brief Read a recorded stream, one "ticker,action,price,size" line per tick
+	static tick_list load(const std::string& path);
+
+	void		start();
+	void		stop();
+private:
+	typedef std::map<std::string,int4>	monitor_map;
+
+	options							m_options;
+	int								m_listen;
+	int4							m_port;
+	tick_list						m_ticks;
+	boost::shared_ptr<boost::thread>	m_thread;
+	boost::atomic<bool>				m_stop;
+	boost::atomic<long>				m_sent;
+
+	// State of the client being served, used by the server thread only
+	int								m_client;
+	std::vector<char>				m_out;
+	std::vector<std::string>		m_monitored;
+	std::vector<double>				m_prices;
+	// Indices in m_monitored of the securities streamed, and whether each is
+	std::vector<size_type>			m_active;
+	std::vector<bool>				m_streamed;
+	monitor_map						m_monids;
+	size_type						m_next;
+	unsigned						m_random;
+
+	void		run();
+	void		serve();
+	bool		flush();
+	void		handle(const loopback::request& r);
+	void		header(const loopback::request& r);
+	void		monitor(const loopback::request& r);
+	void		stopmonitor(const loopback::request& r);
+	void		history(const loopback::request& r);
+	void		data(const loopback::request& r);
+	void		stream(int4 n);
+	char*		message(int4 code, int4 size, int4 request_id, int4 items);
+	double		uniform();
+	double		price(size_type i);
+};
+
+
+
+inline bbreplay::bbreplay(const options& opts):m_options(opts),m_listen(-1),m_port(0),
+												m_stop(false),m_sent(0),m_client(-1) {
+	using namespace jflib;
+	QM_REQUIRE(m_options.batch > 0,"Batch must be positive");
+	m_listen = socket(AF_INET,SOCK_STREAM,0);
+	QM_REQUIRE(m_listen >= 0,"Could not create the replay socket");
+	int one = 1;
+	setsockopt(m_listen,SOL_SOCKET,SO_REUSEADDR,&one,sizeof(one));
+	sockaddr_in addr;
+	std::memset(&addr,0,sizeof(addr));
+	addr.sin_family      = AF_INET;
+	addr.sin_port        = htons(m_options.port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t len = sizeof(addr);
+	if(bind(m_listen,(sockaddr*)&addr,len) != 0 || listen(m_listen,1) != 0 ||
+	   getsockname(m_listen,(sockaddr*)&addr,&len) != 0)  {
+		close(m_listen);
+		QM_FAIL("Could not listen on port " << m_options.port);
+	}
+	m_port = ntohs(addr.sin_port);
+}
+
+inline bbreplay::~bbreplay()  {
+	this->stop();
+	close(m_listen);
+}
+
+inline void bbreplay::replay(const tick_list& ticks)  {
+	using namespace jflib;
+	QM_REQUIRE(!m_thread,"Ticks must be set before the server starts");
+	m_ticks = ticks;
+}
+
+inline bbreplay::tick_list bbreplay::load(const std::string& path)  {
+	using namespace jflib;
+	std::ifstream in(path.c_str());
+	QM_REQUIRE(in,"Could not open " << path);
+	tick_list ticks;
+	std::string line;
+	while(std::getline(in,line))  {
+		std::istringstream s(line);
+		tick t;
+		char c1, c2;
+		if(!std::getline(s,t.ticker,',')) continue;
+		if(s >> t.action >> c1 >> t.price >> c2 >> t.size && c1 == ',' && c2 == ',')
+			ticks.push_back(t);
+	}
+	return ticks;
+}
+
+inline void bbreplay::start()  {
+	if(m_thread) return;
+	m_stop.store(false);
+	m_thread.reset(new boost::thread(boost::bind(&bbreplay::run,this)));
+}
+
+inline void bbreplay::stop()  {
+	if(!m_thread) return;
+	m_stop.store(true);
+	m_thread->join();
+	m_thread.reset();
+}
+
+
+inline void bbreplay::run()  {
+	while(!m_stop.load(boost::memory_order_relaxed))  {
+		pollfd p = {m_listen,POLLIN,0};
+		if(poll(&p,1,100) <= 0) continue;
+		m_client = accept(m_listen,0,0);
+		if(m_client < 0) continue;
+		int one = 1;
+		setsockopt(m_client,IPPROTO_TCP,TCP_NODELAY,&one,sizeof(one));
+		m_monitored.clear();
+		m_prices.clear();
+		m_active.clear();
+		m_streamed.clear();
+		m_monids.clear();
+		m_out.clear();
+		m_next   = 0;
+		m_random = m_options.seed;
+		try  {
+			this->serve();
+		}
+		catch(std::exception&) {}
+		close(m_client);
+		m_client = -1;
+	}
+}
+
+
+//=================================================================
+//   Serve a client: answer its requests and, once securities are
+//   monitored, stream batches of ticks paced to the rate.
+//=================================================================
+inline void bbreplay::serve()  {
+	using namespace boost::posix_time;
+	loopback::request r;
+	std::size_t got = 0;
+	ptime  begin;
+	double streamed = 0;
+	while(!m_stop.load(boost::memory_order_relaxed))  {
+		bool   streaming = !m_active.empty();
+		double elapsed   = streaming ? 1e-6*(microsec_clock::universal_time() - begin).total_microseconds() : 0;
+		if(streaming && m_options.duration > 0 && elapsed >= m_options.duration)  {
+			if(!this->flush()) return;
+			streaming = false;
+		}
+		bool due       = streaming;
+		int  wait      = streaming ? 0 : 100;
+		if(streaming && m_options.rate > 0)  {
+			double missing = streamed + m_options.batch - elapsed*m_options.rate;
+			if(missing > 0)  {
+				if(!this->flush()) return;
+				due  = false;
+				wait = int(1000*missing/m_options.rate);
+			}
+		}
+		pollfd p = {m_client,POLLIN,0};
+		int rc = poll(&p,1,wait);
+		if(rc < 0) return;
+		if(rc > 0)  {
+			ssize_t n = recv(m_client,reinterpret_cast<char*>(&r) + got,sizeof(r) - got,0);
+			if(n <= 0) return;
+			got += n;
+			if(got == sizeof(r))  {
+				got = 0;
+				bool monitoring = !m_active.empty();
+				this->handle(r);
+				if(!monitoring && m_active.size())  {
+					begin    = microsec_clock::universal_time();
+					streamed = 0;
+				}
+			}
+		}
+		else if(due)  {
+			this->stream(m_options.batch);
+			streamed += m_options.batch;
+			if(m_out.size() >= (1 << 16) && !this->flush()) return;
+		}
+	}
+}
+
+inline bool bbreplay::flush()  {
+	const char* p = m_out.empty() ? 0 : &m_out[0];
+	std::size_t size = m_out.size();
+	while(size)  {
+		ssize_t n = send(m_client,p,size,MSG_NOSIGNAL);
+		if(n <= 0) return false;
+		p    += n;
+		size -= n;
+	}
+	m_out.clear();
+	return true;
+}
+
+// Append a zeroed message to the output, return its start. Sizes are
+// rounded up to 8 bytes so that the next message is aligned
+inline char* bbreplay::message(int4 code, int4 size, int4 request_id, int4 items)  {
+	size = (size + 7)/8*8;
+	std::size_t at = m_out.size();
+	m_out.resize(at + sizeof(loopback::frame) + size,0);
+	loopback::frame* f = reinterpret_cast<loopback::frame*>(&m_out[at]);
+	f->size         = size;
+	f->service_code = code;
+	char* m = &m_out[at + sizeof(loopback::frame)];
+	bb_comm_header_t* h = reinterpret_cast<bb_comm_header_t*>(m);
+	h->request_id   = request_id;
+	h->service_code = code;
+	h->num_items    = items;
+	return m;
+}
+
+inline void bbreplay::handle(const loopback::request& r)  {
+	switch(r.service_code)  {
+		case BB_SVC_GETHEADERX:		this->header(r);	break;
+		case BB_SVC_TICKMONITORX:	this->monitor(r);	break;
+		case BB_SVC_STOPMONITOR:	this->stopmonitor(r);	break;
+		case BB_SVC_MGETHISTORYX:	this->history(r);	break;
+		case BB_SVC_GETDATAX:		this->data(r);		break;
+		default:										break;
+	}
+	this->flush();
+}
+
+inline void bbreplay::header(const loopback::request& r)  {
+	bb_msg_headerx_t* m = reinterpret_cast<bb_msg_headerx_t*>(
+		this->message(BB_SVC_GETHEADERX,sizeof(bb_msg_headerx_t),r.request_id,r.num_securities));
+	for(int4 i=0;i<r.num_securities;++i)  {
+		bb_decode_headerx_t& h = m->sec_header[i];
+		double p = 100 + i;
+		h.status        = 0;
+		h.price_bid     = p - 0.01;
+		h.price_ask     = p + 0.01;
+		h.price_last    = p;
+		h.open_interest = 0;
+		h.volume_total  = 0;
+	}
+}
+
+inline void bbreplay::monitor(const loopback::request& r)  {
+	bb_msg_monid_t* m = reinterpret_cast<bb_msg_monid_t*>(
+		this->message(BB_SVC_TICKMONITORX,sizeof(bb_msg_monid_t),r.request_id,r.num_securities));
+	for(int4 i=0;i<r.num_securities;++i)  {
+		std::string ticker(r.securities[i]);
+		monitor_map::const_iterator it = m_monids.find(ticker);
+		if(it == m_monids.end())  {
+			m_monitored.push_back(ticker);
+			m_prices.push_back(100 + i);
+			m_streamed.push_back(false);
+			it = m_monids.insert(monitor_map::value_type(ticker,int4(m_monitored.size()))).first;
+		}
+		size_type s = it->second - 1;
+		if(!m_streamed[s])  {
+			m_streamed[s] = true;
+			m_active.push_back(s);
+		}
+		m->mon_id[i] = it->second;
+	}
+}
+
+// Monitor ids are in the fields of the request, no reply is sent
+inline void bbreplay::stopmonitor(const loopback::request& r)  {
+	for(int4 i=0;i<r.num_fields;++i)  {
+		size_type s = size_type(r.fields[i] - 1);
+		if(s >= m_streamed.size() || !m_streamed[s]) continue;
+		m_streamed[s] = false;
+		m_active.erase(std::find(m_active.begin(),m_active.end(),s));
+	}
+}
+
+// Points of each field of each security on the weekdays between start and end,
+// after the error codes and the counts
+inline void bbreplay::history(const loopback::request& r)  {
+	using namespace boost::gregorian;
+	std::vector<int4> dates;
+	date d0(r.start/10000,r.start/100 % 100,r.start % 100);
+	date d1(r.end/10000,r.end/100 % 100,r.end % 100);
+	for(day_iterator it(d0);*it<=d1;++it)
+		if(it->day_of_week() != Saturday && it->day_of_week() != Sunday)
+			dates.push_back(it->year()*10000 + it->month()*100 + it->day());
+	int4 S = r.num_securities, F = r.num_fields, N = int4(dates.size());
+	int4 size = offsetof(bb_msg_mhistory_t,mhistory_data) + sizeof(int4)*(S + S*F) +
+				sizeof(bb_decode_history_t)*N*F*S;
+	bb_msg_mhistory_t* m = reinterpret_cast<bb_msg_mhistory_t*>(
+		this->message(BB_SVC_MGETHISTORYX,size,r.request_id,N*F*S));
+	m->num_of_securities = S;
+	m->num_of_fields     = F;
+	int4* counts = m->mhistory_data + S;
+	for(int4 i=0;i<S*F;++i)
+		counts[i] = N;
+	bb_decode_history_t* p = reinterpret_cast<bb_decode_history_t*>(counts + S*F);
+	for(int4 s=0;s<S;++s)
+		for(int4 f=0;f<F;++f)  {
+			double v = 100;
+			for(int4 i=0;i<N;++i,++p)  {
+				v *= 1 + 0.01*(this->uniform() - 0.5);
+				p->date  = dates[i];
+				p->value = v;
+			}
+		}
+}
+
+// For each security, one null terminated string per field
+inline void bbreplay::data(const loopback::request& r)  {
+	std::vector<std::string> values;
+	int4 size = offsetof(bb_msg_fieldsx_t,data_byte);
+	for(int4 s=0;s<r.num_securities;++s)
+		for(int4 f=0;f<r.num_fields;++f)  {
+			std::ostringstream v;
+			v << r.securities[s] << ":" << r.fields[f];
+			values.push_back(v.str());
+			size += int4(values.back().size()) + 1;
+		}
+	bb_msg_fieldsx_t* m = reinterpret_cast<bb_msg_fieldsx_t*>(
+		this->message(BB_SVC_GETDATAX,size,r.request_id,r.num_securities));
+	m->NumFields = r.num_fields;
+	std::ptrdiff_t offset = offsetof(bb_msg_fieldsx_t,data_byte);
+	for(int4 s=0;s<r.num_securities;++s)  {
+		m->field_ptr[s] = reinterpret_cast<char*>(offset);
+		for(int4 f=0;f<r.num_fields;++f)  {
+			const std::string& v = values[s*r.num_fields + f];
+			std::memcpy(reinterpret_cast<char*>(m) + offset,v.c_str(),v.size() + 1);
+			offset += v.size() + 1;
+		}
+	}
+}
+
+// A tick message of n ticks, from the recorded stream or the random walk
+inline void bbreplay::stream(int4 n)  {
+	int4 size = offsetof(bb_msg_tickx_t,tick_data) + n*sizeof(bb_decode_tickx_t);
+	bb_msg_tickx_t* m = reinterpret_cast<bb_msg_tickx_t*>(this->message(BB_SVC_TICKDATA,size,0,n));
+	bb_decode_tickx_t* ticks = m->tick_data;
+	int4 items = 0;
+	for(int4 k=0;k<n;++k)  {
+		bb_decode_tickx_t& t = ticks[items];
+		if(m_ticks.size())  {
+			const tick& rt = m_ticks[m_next++ % m_ticks.size()];
+			monitor_map::const_iterator it = m_monids.find(rt.ticker);
+			if(it == m_monids.end() || !m_streamed[it->second - 1]) continue;
+			t.mon_id = it->second;
+			t.action = rt.action;
+			t.data.TRADE.price = rt.price;
+			t.data.TRADE.size  = rt.size;
+			if(rt.action == bTickVOLUME)
+				t.data.VOLUME.volume = rt.size;
+		}
+		else  {
+			size_type i = m_active[m_next++ % m_active.size()];
+			t.mon_id = int4(i + 1);
+			switch((m_next / m_active.size()) % 4)  {
+				case 0:  t.action = bTickTRADE;  t.data.TRADE.price = this->price(i); t.data.TRADE.size = 100; break;
+				case 1:  t.action = bTickBID;    t.data.BID.price   = m_prices[i] - 0.01; t.data.BID.size = 100; break;
+				case 2:  t.action = bTickASK;    t.data.ASK.price   = m_prices[i] + 0.01; t.data.ASK.size = 100; break;
+				default: t.action = bTickVOLUME; t.data.VOLUME.volume = int4(m_next);  break;
+			}
+		}
+		++items;
+	}
+	m->comm_header.num_items = items;
+	m_sent.fetch_add(items,boost::memory_order_relaxed);
+}
+
+// Linear congruential generator, reproducible with the seed
+inline double bbreplay::uniform()  {
+	m_random = 1664525u*m_random + 1013904223u;
+	return m_random/4294967296.0;
+}
+
+inline double bbreplay::price(size_type i)  {
+	m_prices[i] *= 1 + 0.001*(this->uniform() - 0.5);
+	return m_prices[i];
+}
+
+
+}
+
+
+#endif	//	__BLOOMBERG_REPLAY_QM_HPP__
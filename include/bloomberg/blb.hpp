@@ -6,6 +6,8 @@
 ///
 ///	Set	BB_USING_DLL to compile with bloomberg dll
 /// Set USE_BOOST_THREAD to compile with boost thread
+/// blbevent runs the receive loop on its own thread (epoll on linux, poll elsewhere),
+/// blbevent and blbshards are not available on WIN32
 ///
 /// BB_PLATFORM_WINDOWS_NT ?
 ///
@@ -18,14 +20,45 @@
 
 //#include <qmlib/corelib/templates/timeserie.hpp>
 #include <map>
+#include <set>
 #include <list>
+#include <vector>
 #include <jflib/templates/buffer.hpp>
+#include <jflib/threads/ring.hpp>
+#include <jflib/threads/latency.hpp>
 #include <bbapi.h>
 
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/cstdint.hpp>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <errno.h>
+#ifndef	WIN32
+#	include <fcntl.h>
+#	include <unistd.h>
+#	if defined(__linux__)
+#		define BLB_USE_EPOLL
+#		include <sys/epoll.h>
+#	else
+#		include <poll.h>
+#	endif
+#endif	//	WIN32
+
 
 typedef double	qm_real;
 typedef long 	qm_long;
 
+#ifndef	WIN32
+typedef int		SOCKET;
+#endif	//	WIN32
+
 
 #ifdef	USE_BOOST_THREAD
 #include <boost/thread/mutex.hpp>
@@ -42,6 +75,8 @@ void blb_wrap();
 #define REQUEST_TIMEOUT  300
 #define BLB_BUF_SIZE     2048
 #define BLB_ID_SIZE      4
+#define BLB_KEY_SIZE     32
+#define BLB_WINDOW       16
 
 
 class livedata;
@@ -49,6 +84,20 @@ class blbcon;
 typedef boost::shared_ptr<livedata> LIVEDATA;
 typedef boost::shared_ptr<blbcon>   BLBCON;
 
+class blbFeedBase;
+struct blbtick;
+class blbtickpool;
+class blbconflator;
+class blbjournal;
+class blbstats;
+template<class HR> struct blbhistory;
+typedef boost::shared_ptr<blbconflator>			BLBCONFLATOR;
+typedef boost::shared_ptr<blbjournal>			BLBJOURNAL;
+typedef boost::shared_ptr<blbstats>				BLBSTATS;
+typedef boost::shared_ptr<blbtickpool>			BLBTICKPOOL;
+typedef jflib::threads::spscring<blbtick*>		blbtickring;
+typedef boost::shared_ptr<blbtickring>			BLBTICKRING;
+
 
 class livedata  {
 public:
@@ -92,11 +141,22 @@ public:
 	
 	long				m_req_mon_id;
     long				m_tick_id;
+	/// \brief Last tick message which updated the feed, used by blb to list each feed once
+	unsigned long		m_stamp;
+	/// \brief Slot of the feed in the blbconflator of its blb, -1 if none
+	long				m_conflated;
+	/// \brief Index of the feed in the ticker table of the blbjournal of its blb, -1 if none
+	/// and -2 if the journal refused the feed
+	long				m_journaled;
+	/// \brief Slot of the feed in the blbbars building bars from its ticks, -1 if none
+	long				m_barred;
 
 	fieldlisttype	    fields;
+
+	void				set_reqid(long id) {m_req_id = id;}
 	
 	blbFeedBase(const std::string& ticker, qm_long req_id):
-		m_req_mon_id(0),m_tick_id(0),m_ticker(ticker),m_req_id(req_id){}
+		m_req_mon_id(0),m_tick_id(0),m_stamp(0),m_conflated(-1),m_journaled(-1),m_barred(-1),m_ticker(ticker),m_req_id(req_id){}
 
 protected:
 	void initdata(){}
@@ -187,9 +247,10 @@ public:
 	typedef boost::shared_ptr<blb_hist_feed_type>	BLBHISTFEED;
 
 	typedef std::map<qm_long,BLBLIVEFEED>			id_container;
-	typedef std::map<qm_long,BLBHISTFEED>			id_hist_container;
-	typedef std::list<BLBLIVEFEED>					live_list;
-	typedef	boost::shared_ptr<live_list>			LIVE_LIST;
+	typedef std::vector<BLBHISTFEED>				hist_list;
+	typedef std::map<qm_long,hist_list>				id_hist_container;
+	typedef std::vector<BLBLIVEFEED>				live_list;
+	typedef std::vector<std::string>				ticker_list;
 
 	typedef jflib::void_buffer						buffertype;
 	typedef jflib::qm_buffer<long>					fieldlisttype;				
@@ -204,8 +265,25 @@ public:
 	static BLB create(BLBCON c) {return BLB(new blb(c));}
 
 	BLBLIVEFEED     get_live_feed(const std::string& ticker);
+	/// \brief Stop the ticks of the live feed of ticker, false if ticker is not monitored.
+	/// The feed is kept by the blb until every tick published before is back in the tick pool
+	bool			stop_live_feed(const std::string& ticker);
 	BLBHISTFEED     get_hist_feed(const std::string& ticker, long startDate, long endDate, const fieldlisttype& fields);
 	BLBHISTFEED     get_data_feed(const std::string& ticker, const fieldlisttype& fields);
+	/// \brief History of many securities, BB_MAX_MHIST_SECS securities and at most
+	/// BB_MAX_MHIST_FLDS fields per request. Requests beyond the window, or refused
+	/// by the API, wait and are sent again as replies come back. Feeds are returned
+	/// by responce as their requests complete
+	hist_list		get_hist_feeds(const ticker_list& tickers, long startDate, long endDate, const fieldlisttype& fields);
+	/// \brief Static data of many securities, BB_MAX_SECS securities and at most
+	/// BB_MAX_FIELDS fields per request
+	hist_list		get_data_feeds(const ticker_list& tickers, const fieldlisttype& fields);
+	/// \brief Maximum number of history and static data requests in flight
+	unsigned		window()  const {return m_window;}
+	void			set_window(unsigned w) {m_window = std::max(w,1u); this->SendPending();}
+	/// \brief Requests in flight and waiting for the window
+	unsigned		inflight() const {return m_hist_ids.size();}
+	unsigned		pending()  const {return m_pending.size();}
 	void			clear();
 
 #ifdef	BB_USING_DLL
@@ -214,33 +292,91 @@ public:
 #endif	//	BB_USING_DLL
 
 	BLBCON   get_connection() const {return m_connection;}
+
+	/// \brief Publish a record of each live tick into ring, records come from pool and
+	/// are released to it by the consumer. The live feeds are updated in any case,
+	/// but are no longer returned by responce and receive
+	void	 set_tick_sink(BLBTICKPOOL pool, BLBTICKRING ring);
+	/// \brief Ticks not published because the pool was exhausted or the ring full
+	long	 tick_dropped() const {return m_tick_dropped;}
+	/// \brief Feeds of history and static data replies which could not be decoded
+	/// into the history data type, they are not returned by responce
+	long	 history_dropped() const {return m_history_dropped;}
+	/// \brief Keep the latest live data of each security in conflator, updated once per tick message
+	void	 set_conflator(BLBCONFLATOR conflator) {m_conflator = conflator;}
+	/// \brief Record each live tick in journal, see blbjournalreader to replay it
+	void	 set_journal(BLBJOURNAL journal) {m_journal = journal;}
+	/// \brief Time the stages of each message and tick and count the messages in stats
+	void	 set_stats(BLBSTATS stats) {m_stats = stats;}
+	BLBSTATS stats() const {return m_stats;}
 	//void	 set_connection(BLBCON con) {m_connection = con;}
 
+	/// \brief Wait a second for the socket and decode its messages, the result is null
+	/// if no feed was received or updated
 	BLBFEEDR  responce();
+	/// \brief Decode the messages waiting on the socket, without select.
+	/// Called by blbevent when the socket is readable, at readable on the clock of blbstats
+	BLBFEEDR  receive(boost::int64_t readable = 0) {return this->Decode(readable);}
 private:
+	/// \brief Securities sent in one request, they share the fields of the first feed
+	struct batch  {
+		bool		history;
+		long		start, end;
+		hist_list	feeds;
+	};
+
 	blb(BLBCON);
 	buffertype								 m_buffer;
 	jflib::qm_buffer<int4>					 m_secTypeList;
 	jflib::qm_buffer<char>					 m_secName;
+	jflib::qm_buffer<int4>					 m_fieldids;
 	id_container					         m_request_monitor_id;
     id_container					         m_live_tick_id;
 	id_hist_container						 m_hist_ids;
+	std::list<batch>						 m_pending;
+	unsigned								 m_window;
 	BLBCON									 m_connection;
 	fd_set									 read_set, exec_set;
 	BLBFEEDR								 m_none;
+	live_list								 m_updated;
+	live_list								 m_stopped;
+	std::set<const blbFeedBase*>			 m_stopping;
+	unsigned long							 m_generation;
+	BLBTICKPOOL								 m_tick_pool;
+	BLBTICKRING								 m_tick_sink;
+	BLBCONFLATOR							 m_conflator;
+	BLBJOURNAL								 m_journal;
+	BLBSTATS								 m_stats;
+	boost::int64_t							 m_readable;
+	boost::int64_t							 m_received;
+	long									 m_tick_dropped;
+	long									 m_history_dropped;
 
 	static bool								 m_loaded_fields;
 
-	BLBFEEDR	  Decode();
+	BLBFEEDR	  Decode(boost::int64_t readable);
+	int4*		  fieldids(const fieldlisttype& fields);
     BLBLIVEFEED   DecodeHeader(bb_header_type* h);
 	BLBLIVEFEED   startTickMonitor(BLBLIVEFEED rat, bb_decoder_header_type* p);
 	void	      HandleMonitor(bb_monid_type* m);
-
-    LIVE_LIST     UpDateLiveData(bb_tick_type* t);
-
-    BLBHISTFEED   DecodeHistory(bb_history_type* t);
-	BLBHISTFEED	  fillData(BLBHISTFEED qp, bb_history_type* t);
-	BLBHISTFEED   DecodeStaticData(bb_msg_fieldsx_t *t);
+	void		  StopMonitor(typename id_container::iterator it);
+	void		  ReleaseStopped();
+
+    void          UpDateLiveData(bb_tick_type* t);
+	void		  PublishTick(blbFeedBase* feed, const bb_decode_tickx_t& tick, qm_real value, int size);
+
+	hist_list	  QueueBatch(const ticker_list& tickers, const fieldlisttype& fields,
+							 bool history, long startDate, long endDate, unsigned size);
+	void		  SendPending();
+	/// \brief Send a request for feeds, return its id, negative if the API refused it
+	long		  SendHistory(const hist_list& feeds, long startDate, long endDate);
+	long		  SendData(const hist_list& feeds);
+	char*		  keys(const hist_list& feeds);
+
+    hist_list     DecodeHistory(bb_history_type* t);
+	void		  fillData(const hist_list& feeds, bb_history_type* t);
+	hist_list     DecodeStaticData(bb_msg_fieldsx_t *t);
+	void		  DropReply(const hist_list& feeds);
     //
     double   BB_PTOS(double x){return x == BB_VAL_MISSING ? 0 : x;}
 
@@ -254,9 +390,17 @@ private:
 };
 
 
+#include<blbtick.hpp>
+#include<blbstats.hpp>
+#include<blbconflate.hpp>
+#include<blbjournal.hpp>
 #include<blb_impl.hpp>
 #include<con_impl.hpp>
 #include<blbloop.hpp>
+#ifndef	WIN32
+#include<blbevent.hpp>
+#include<blbshards.hpp>
+#endif	//	WIN32
 
 
 }  
@@ -1,12 +1,18 @@
 
 
 template<class F, class LR, class HR, class L>
-inline blb<F,LR,HR,L>::blb(BLBCON c):m_connection(c),
-						 			 m_secTypeList(1),m_secName(32) {
+bool blb<F,LR,HR,L>::m_loaded_fields = false;
+
+
+template<class F, class LR, class HR, class L>
+inline blb<F,LR,HR,L>::blb(BLBCON c):m_buffer(BLB_BUF_SIZE),m_connection(c),
+						 			 m_secTypeList(BB_MAX_SECS),m_secName(BB_MAX_SECS*BLB_KEY_SIZE),
+									 m_window(BLB_WINDOW),m_generation(0),m_readable(0),m_received(0),m_tick_dropped(0),m_history_dropped(0) {
 	using namespace jflib;
 	QM_REQUIRE(m_connection,"Bloomberg connection is null");
 	for(unsigned i=0;i<m_secTypeList.size();++i)
 		m_secTypeList[i] = 730;
+	m_updated.reserve(BLB_BUF_SIZE);
 	//for(unsigned i=0;i<m_fieldList.size();++i)
 	//	m_fieldList[i] = i;
 }
@@ -14,12 +20,39 @@ inline blb<F,LR,HR,L>::blb(BLBCON c):m_connection(c),
 
 template<class F, class LR, class HR, class L>
 inline void blb<F,LR,HR,L>::clear()  {
+	if(m_conflator)
+		for(typename id_container::const_iterator it=m_live_tick_id.begin();it!=m_live_tick_id.end();++it)
+			if(it->second)
+				m_conflator->release(*it->second);
 	m_request_monitor_id.clear();
 	m_live_tick_id.clear();
 	m_hist_ids.clear();
+	m_pending.clear();
+	m_updated.clear();
+	m_stopping.clear();
+	this->ReleaseStopped();
 	m_loaded_fields = false;
 }
 
+
+// Field ids as the int4 array of the API, fieldlisttype holds longs
+template<class F, class LR, class HR, class L>
+inline int4* blb<F,LR,HR,L>::fieldids(const typename blb<F,LR,HR,L>::fieldlisttype& fields)  {
+	m_fieldids.Alloca(fields.size());
+	for(unsigned i=0;i<fields.size();++i)
+		m_fieldids[i] = int4(fields[i]);
+	return m_fieldids;
+}
+
+
+template<class F, class LR, class HR, class L>
+inline void blb<F,LR,HR,L>::set_tick_sink(BLBTICKPOOL pool, BLBTICKRING ring)  {
+	using namespace jflib;
+	QM_REQUIRE(!ring || pool,"A tick ring needs a tick pool");
+	m_tick_pool = pool;
+	m_tick_sink = ring;
+}
+
 /*
 #ifdef	USE_BOOST_THREAD
 template<class F, class LR, class HR>
@@ -51,6 +84,7 @@ blb<F,LR,HR,L>::get_live_feed(const std::string& ticker)  {
 	                                  BHeaderENHANCEDSEARCH | EXTENDED_HEADER,
 		                              0, 1, tik);
 	BLBLIVEFEED rat(new blb_live_feed_type(ticker,header_id));
+	rat->set_data(livedata_type(new livedata));
 	m_request_monitor_id[header_id] = rat;
     return rat;
 }
@@ -63,21 +97,119 @@ blb<F,LR,HR,L>::get_hist_feed(const std::string& ticker, long startDate, long en
 							  const typename blb<F,LR,HR,L>::fieldlisttype& fields)  {
     using namespace jflib;
 	QM_REQUIRE(m_connection->connection(),"Not connected to API. Connect please.");
-	char* tik = (char*)ticker.c_str();
-	//m_fieldList[0] = 1;
-	//m_fieldList[0] = 2;
-	//m_fieldList[0] = 3;
-	//strcpy(m_secName, tik);
+	QM_REQUIRE(fields.size() <= BB_MAX_MHIST_FLDS,"At most " << BB_MAX_MHIST_FLDS << " fields per history request");
+	QM_REQUIRE(blbhistory<histdata_type>::accepts(fields.size()),"History of " << fields.size() << " fields cannot be decoded");
+	BLBHISTFEED hf(new blb_hist_feed_type(ticker,0));
+	hf->fields.copy(fields);
+	QM_REQUIRE(this->SendHistory(hist_list(1,hf),startDate,endDate) >= 0,"Error from history request. Bad request ID");
+	return hf;
+}
+
+
+
+template<class F, class LR, class HR, class L>
+inline typename blb<F,LR,HR,L>::BLBHISTFEED
+blb<F,LR,HR,L>::get_data_feed(const std::string& ticker,
+							  const typename blb<F,LR,HR,L>::fieldlisttype& fields)  {
+    using namespace jflib;
+	QM_REQUIRE(m_connection->connection(),"Not connected to API. Connect please.");
+	QM_REQUIRE(fields.size() <= BB_MAX_FIELDS,"At most " << BB_MAX_FIELDS << " fields per static data request");
+	QM_REQUIRE(blbhistory<histdata_type>::static_data,"Static data cannot be decoded into the history data type");
+	BLBHISTFEED hf(new blb_hist_feed_type(ticker,0));
+	hf->fields.copy(fields);
+	QM_REQUIRE(this->SendData(hist_list(1,hf)) >= 0,"Error from static data request. Bad request ID");
+	return hf;
+}
+
+
+//====================================================================
+//    Batches of securities. Securities are packed into requests
+//    within the API limits, requests beyond the window wait in
+//    m_pending and are sent as replies come back. A batch leaves
+//    m_pending once the API accepts it, a refused batch is sent
+//    again by the next call, so that Decode never throws.
+//====================================================================
+template<class F, class LR, class HR, class L>
+inline typename blb<F,LR,HR,L>::hist_list
+blb<F,LR,HR,L>::get_hist_feeds(const ticker_list& tickers, long startDate, long endDate,
+							   const typename blb<F,LR,HR,L>::fieldlisttype& fields)  {
+	using namespace jflib;
+	QM_REQUIRE(fields.size() <= BB_MAX_MHIST_FLDS,"At most " << BB_MAX_MHIST_FLDS << " fields per history request");
+	QM_REQUIRE(blbhistory<histdata_type>::accepts(fields.size()),"History of " << fields.size() << " fields cannot be decoded");
+	return this->QueueBatch(tickers,fields,true,startDate,endDate,BB_MAX_MHIST_SECS);
+}
+
+template<class F, class LR, class HR, class L>
+inline typename blb<F,LR,HR,L>::hist_list
+blb<F,LR,HR,L>::get_data_feeds(const ticker_list& tickers,
+							   const typename blb<F,LR,HR,L>::fieldlisttype& fields)  {
+	using namespace jflib;
+	QM_REQUIRE(fields.size() <= BB_MAX_FIELDS,"At most " << BB_MAX_FIELDS << " fields per static data request");
+	QM_REQUIRE(blbhistory<histdata_type>::static_data,"Static data cannot be decoded into the history data type");
+	return this->QueueBatch(tickers,fields,false,0,0,BB_MAX_SECS);
+}
+
+template<class F, class LR, class HR, class L>
+inline typename blb<F,LR,HR,L>::hist_list
+blb<F,LR,HR,L>::QueueBatch(const ticker_list& tickers, const fieldlisttype& fields,
+						   bool history, long startDate, long endDate, unsigned size)  {
+    using namespace jflib;
+	QM_REQUIRE(m_connection->connection(),"Not connected to API. Connect please.");
+	hist_list feeds;
+	feeds.reserve(tickers.size());
+	for(typename ticker_list::const_iterator it=tickers.begin();it!=tickers.end();++it)  {
+		QM_REQUIRE(it->size() < BLB_KEY_SIZE,"Security key too long: " << *it);
+		BLBHISTFEED hf(new blb_hist_feed_type(*it,0));
+		hf->fields.copy(fields);
+		feeds.push_back(hf);
+	}
+	for(unsigned i=0;i<feeds.size();i+=size)  {
+		batch b;
+		b.history = history;
+		b.start   = startDate;
+		b.end     = endDate;
+		b.feeds.assign(feeds.begin() + i,feeds.begin() + std::min(unsigned(feeds.size()),i + size));
+		m_pending.push_back(b);
+	}
+	this->SendPending();
+	return feeds;
+}
+
+template<class F, class LR, class HR, class L>
+inline void blb<F,LR,HR,L>::SendPending()  {
+	while(!m_pending.empty() && m_hist_ids.size() < m_window)  {
+		const batch& b = m_pending.front();
+		long rID = b.history ? this->SendHistory(b.feeds,b.start,b.end) : this->SendData(b.feeds);
+		if(rID < 0)
+			return;
+		m_pending.pop_front();
+	}
+}
+
+// Security keys of feeds, BLB_KEY_SIZE bytes each
+template<class F, class LR, class HR, class L>
+inline char* blb<F,LR,HR,L>::keys(const hist_list& feeds)  {
+	m_secName.Alloca(BLB_KEY_SIZE*feeds.size());
+	std::fill(m_secName.ptr(),m_secName.ptr() + m_secName.size(),0);
+	for(unsigned i=0;i<feeds.size();++i)
+		std::strncpy(m_secName.ptr() + i*BLB_KEY_SIZE,feeds[i]->ticker().c_str(),BLB_KEY_SIZE - 1);
+	return m_secName;
+}
+
+
+//    Send an Hystorical Data Request for feeds, which share fields
+template<class F, class LR, class HR, class L>
+inline long blb<F,LR,HR,L>::SendHistory(const hist_list& feeds, long startDate, long endDate)  {
+	const fieldlisttype& fields = feeds.front()->fields;
 	long NF = fields.size();
 	
 	long rID = bb_mgethistoryx(
 		// connection object
 		m_connection->connection(),
-		// number of securities
-		1,
+		// number of securities ( <= 8 )
+		feeds.size(),
 		// security keys (32 bytes each)
-		//m_secName,
-		tik,
+		this->keys(feeds),
 		// key types, long*
 		m_secTypeList,
 		// Start date YYYYMMDD
@@ -87,51 +219,48 @@ blb<F,LR,HR,L>::get_hist_feed(const std::string& ticker, long startDate, long en
 		// number of fields ( <= 10 )
 		NF,
 		// array of Requested field ids
-		fields.ptr(),
+		this->fieldids(fields),
 		// Various ORed flags
 		BHistoryxDAILY);
 		//						  BHistoryxDAILY | BHistoryxALLCALDAYS);
 
-	QM_REQUIRE(rID>=0,"Error from history request. Bad request ID");
-
-	BLBHISTFEED hf(new blb_hist_feed_type(ticker,rID));
-	hf->fields.copy(fields);
-	m_hist_ids[rID] = hf;
-	return hf;
+	if(rID < 0)
+		return rID;
+	for(typename hist_list::const_iterator it=feeds.begin();it!=feeds.end();++it)
+		(*it)->set_reqid(rID);
+	m_hist_ids[rID] = feeds;
+	return rID;
 }
 
 
-
 template<class F, class LR, class HR, class L>
-inline typename blb<F,LR,HR,L>::BLBHISTFEED
-blb<F,LR,HR,L>::get_data_feed(const std::string& ticker,
-							  const typename blb<F,LR,HR,L>::fieldlisttype& fields)  {
-    using namespace jflib;
-	QM_REQUIRE(m_connection->connection(),"Not connected to API. Connect please.");
-	char* tik = (char*)ticker.c_str();
+inline long blb<F,LR,HR,L>::SendData(const hist_list& feeds)  {
+	const fieldlisttype& fields = feeds.front()->fields;
+	char* keys = this->keys(feeds);
 	long NF = fields.size();
 	long rID = bb_getdatax(
 		// connection object
 		m_connection->connection(),
-		// number of securities
-		1,
+		// number of securities ( <= 10 )
+		feeds.size(),
 		// key types, long*
 		m_secTypeList,
 		// security keys (32 bytes each)
-		tik,
+		keys,
 		// number of fields ( <= 10 )
 		NF,
 		// array of Requested field ids
-		fields.ptr(),
+		this->fieldids(fields),
 		0,
 		m_secTypeList,
-		tik);
-
-	QM_REQUIRE(rID>=0,"Error from static data request. Bad request ID");
-	BLBHISTFEED hf(new blb_hist_feed_type(ticker,rID));
-	hf->fields.copy(fields);
-	m_hist_ids[rID] = hf;
-	return hf;
+		keys);
+
+	if(rID < 0)
+		return rID;
+	for(typename hist_list::const_iterator it=feeds.begin();it!=feeds.end();++it)
+		(*it)->set_reqid(rID);
+	m_hist_ids[rID] = feeds;
+	return rID;
 }
 
 
@@ -169,7 +298,7 @@ blb<F,LR,HR,L>::DecodeHeader(typename blb<F,LR,HR,L>::bb_header_type* h)  {
 	using namespace jflib;
     if(h->comm_header.num_items != 1) return BLBLIVEFEED();
     qm_long id = h->comm_header.request_id;
-    id_container::const_iterator rat = m_request_monitor_id.find(id);
+    typename id_container::const_iterator rat = m_request_monitor_id.find(id);
 
     QM_REQUIRE(rat != m_request_monitor_id.end(),"Received request to a header id not requested!!!");
 	BLBLIVEFEED qp = rat->second;
@@ -183,6 +312,7 @@ blb<F,LR,HR,L>::DecodeHeader(typename blb<F,LR,HR,L>::bb_header_type* h)  {
 	  case  0: return this->startTickMonitor(qp,p);
     }
     m_request_monitor_id.erase(id);
+	m_stopping.erase(qp.get());
     return BLBLIVEFEED();
 }
 
@@ -201,7 +331,51 @@ inline void blb<F,LR,HR,L>::HandleMonitor(typename blb<F,LR,HR,L>::bb_monid_type
 	qm_long rID = m->comm_header.request_id;
 	qm_long mID = m->mon_id[0];
 	BLBLIVEFEED qp	= m_request_monitor_id[rID];
-	if(qp) m_live_tick_id[mID] = qp;
+	if(!qp) return;
+	m_live_tick_id[mID] = qp;
+	// Stopped while waiting for its monitor id
+	if(m_stopping.erase(qp.get()))
+		this->StopMonitor(m_live_tick_id.find(mID));
+}
+
+
+//====================================================================
+//    Stop monitoring a live feed. A feed waiting for its header or
+//    monitor id is stopped when the monitor id arrives.
+//====================================================================
+template<class F, class LR, class HR, class L>
+inline bool blb<F,LR,HR,L>::stop_live_feed(const std::string& ticker)  {
+	for(typename id_container::iterator it=m_live_tick_id.begin();it!=m_live_tick_id.end();++it)
+		if(it->second && it->second->ticker() == ticker)  {
+			this->StopMonitor(it);
+			return true;
+		}
+	for(typename id_container::const_iterator it=m_request_monitor_id.begin();it!=m_request_monitor_id.end();++it)
+		if(it->second && it->second->ticker() == ticker)
+			return m_stopping.insert(it->second.get()).second;
+	return false;
+}
+
+template<class F, class LR, class HR, class L>
+inline void blb<F,LR,HR,L>::StopMonitor(typename id_container::iterator it)  {
+	BLBLIVEFEED qp = it->second;
+	int4 monid = int4(it->first);
+	m_live_tick_id.erase(it);
+	m_request_monitor_id.erase(qp->reqid());
+	m_request_monitor_id.erase(qp->req_mon_id());
+	if(m_conflator)
+		m_conflator->release(*qp);
+	m_stopped.push_back(qp);
+	bb_stopmntr(m_connection->connection(),1,&monid);
+}
+
+// Ticks published before the stop may point to a stopped feed, which is
+// released once every tick record is back in the pool. Checked before a
+// message is decoded, when a consumer which keeps up has taken every tick
+template<class F, class LR, class HR, class L>
+inline void blb<F,LR,HR,L>::ReleaseStopped()  {
+	if(!m_stopped.empty() && (!m_tick_pool || m_tick_pool->available() == m_tick_pool->capacity()))
+		m_stopped.clear();
 }
 
 
@@ -209,152 +383,267 @@ inline void blb<F,LR,HR,L>::HandleMonitor(typename blb<F,LR,HR,L>::bb_monid_type
 //
 // We just got some updates.  Make sure we've already got the header
 // so we have something to update.  If not, just ignore the tick.
-// Then, Loop through the ticks, apply each one to the corresponding 
-// security header, then print out the updated header.
+// Then, Loop through the ticks and apply each one to the corresponding 
+// security header. The updated feeds are listed once in m_updated and,
+// with a tick sink, each tick is published as a pooled record.
+// A journal records each tick, a conflator receives the latest data
+// of each updated feed.
+// Nothing is allocated once m_updated has reached its working size.
 //
 //=========================================================================
 template<class F, class LR, class HR, class L>
-inline typename blb<F,LR,HR,L>::LIVE_LIST
-blb<F,LR,HR,L>::UpDateLiveData(typename blb<F,LR,HR,L>::bb_tick_type* t)  {
+inline void blb<F,LR,HR,L>::UpDateLiveData(typename blb<F,LR,HR,L>::bb_tick_type* t)  {
 
     int itms = t->comm_header.num_items;
-
-	LIVE_LIST		ret(new live_list);
-	if(itms <= 0) return ret;
-
-	live_list*      pet = ret.get();
+	m_updated.clear();
+	if(itms <= 0) return;
 
 #	ifdef	USE_BOOST_THREAD
 	//boost::mutex::scoped_lock scoped_lock(m_mutex);
 #	endif	//	USE_BOOST_THREAD
 
-	qm_long         idm;
-	id_container    tmp;
-	LIVEDATA		ld;
+	++m_generation;
+	// tick_data is declared with one element, index through a pointer so
+	// that the compiler does not bound the loop to it
+	const bb_decode_tickx_t* ticks = t->tick_data;
+	if(m_stats)
+		m_stats->add(blbstats::TICKS,itms);
+	if(m_journal)
+		m_journal->stamp();
 //
 //. Now update the appropriate fields in the header, depending on the tick type
     for(int i=0;i<itms;i++)  {
-		idm = t->tick_data[i].mon_id;
-		BLBLIVEFEED qp = tmp[idm];
-		if(!qp) {
-			qp = m_live_tick_id[idm];
-			if(!qp) continue;
-			tmp[idm] = qp;
-			pet->push_back(qp);
-		}
-		ld = qp->get_data();
-
-		switch (t->tick_data[i].action)  {
-			case bTickTRADE:          ld->set_last(t->tick_data[i].data.TRADE.price);     break;
-			case bTickBID:            ld->set_bid(t->tick_data[i].data.BID.price);        break;
-			case bTickASK:            ld->set_ask(t->tick_data[i].data.ASK.price);        break;
-			case bTickOPEN_INTEREST : ld->set_open(t->tick_data[i].data.OPEN.price);      break;
-			case bTickVOLUME        : ld->set_volume(t->tick_data[i].data.VOLUME.volume); break;
+		const bb_decode_tickx_t& tick = ticks[i];
+		typename id_container::const_iterator it = m_live_tick_id.find(tick.mon_id);
+		if(it == m_live_tick_id.end() || !it->second) continue;
+		const BLBLIVEFEED& qp = it->second;
+		livedata* ld = qp->get_data().get();
+
+		qm_real value;
+		int     size = 0;
+		switch (tick.action)  {
+			case bTickTRADE:          value = tick.data.TRADE.price;   size = tick.data.TRADE.size; ld->set_last(value);   break;
+			case bTickBID:            value = tick.data.BID.price;     size = tick.data.BID.size;   ld->set_bid(value);    break;
+			case bTickASK:            value = tick.data.ASK.price;     size = tick.data.ASK.size;   ld->set_ask(value);    break;
+			case bTickOPEN_INTEREST : value = tick.data.OPEN.price;                                 ld->set_open(value);   break;
+			case bTickVOLUME        : value = tick.data.VOLUME.volume;                              ld->set_volume(value); break;
 			default: continue;
 		}
+		if(qp->m_stamp != m_generation)  {
+			qp->m_stamp = m_generation;
+			m_updated.push_back(qp);
+		}
+		if(m_tick_sink)
+			this->PublishTick(qp.get(),tick,value,size);
+		if(m_journal)
+			m_journal->append(*qp,tick,value,size);
+	}
+	if(m_journal)
+		m_journal->commit();
+	if(m_conflator)
+		for(typename live_list::const_iterator it=m_updated.begin();it!=m_updated.end();++it)
+			m_conflator->update(**it,*(*it)->get_data());
+}
+
+
+template<class F, class LR, class HR, class L>
+inline void blb<F,LR,HR,L>::PublishTick(blbFeedBase* feed, const bb_decode_tickx_t& tick, qm_real value, int size)  {
+	blbtick* r = m_tick_pool->acquire();
+	if(!r)  {
+		++m_tick_dropped;
+		return;
+	}
+	r->feed   = feed;
+	r->value  = value;
+	r->mon_id = tick.mon_id;
+	r->readable = m_readable;
+	r->received = m_received;
+	r->action = tick.action;
+	r->size   = size;
+	r->time   = tick.time;
+	if(!m_tick_sink->push(r))  {
+		m_tick_pool->release(r);
+		++m_tick_dropped;
 	}
-    return ret;
 }
 
 
 
 template<class F, class LR, class HR, class L>
-inline typename blb<F,LR,HR,L>::BLBHISTFEED
+inline typename blb<F,LR,HR,L>::hist_list
 blb<F,LR,HR,L>::DecodeHistory(typename blb<F,LR,HR,L>::bb_history_type* t)  {
 	qm_long id = t->comm_header.request_id;
-	BLBHISTFEED qp = m_hist_ids[id];
-	if(qp)  {
-		m_hist_ids.erase(id);
-		return this->fillData(qp,t);
+	typename id_hist_container::iterator it = m_hist_ids.find(id);
+	if(it == m_hist_ids.end()) return hist_list();
+	// The reply is checked before the request is erased, a reply which
+	// cannot be decoded is dropped rather than thrown out of Decode
+	bool valid = t->num_of_securities == long(it->second.size()) &&
+				 blbhistory<histdata_type>::accepts(t->num_of_fields);
+	hist_list feeds;
+	feeds.swap(it->second);
+	m_hist_ids.erase(it);
+	if(!valid)  {
+		this->DropReply(feeds);
+		return hist_list();
 	}
-	else
-		return qp;
+	this->fillData(feeds,t);
+	return feeds;
 }
 
 
-
-
 template<class F, class LR, class HR, class L>
-inline typename blb<F,LR,HR,L>::BLBHISTFEED
-blb<F,LR,HR,L>::fillData(typename blb<F,LR,HR,L>::BLBHISTFEED qp, typename blb<F,LR,HR,L>::bb_history_type* t)  {
+inline void blb<F,LR,HR,L>::DropReply(const typename blb<F,LR,HR,L>::hist_list& feeds)  {
+	m_history_dropped += long(feeds.size());
+	if(m_stats)
+		m_stats->add(blbstats::ERRORS);
+}
 
-	typedef bb_decode_mhistory_t				   	  bb_decode_type;
-	typedef bb_decode_history_t						  bb_single_history;
 
-	long numKeys	 = t->num_of_securities;
-	long totNumItems = t->comm_header.num_items;
-	long numFields   = t->num_of_fields;
-	long secStart    = numFields + 1;
-	long   dte;
-	double val;
 
-	bb_single_history   *hist;
+/** \brief Fill the history data of a feed from the points of a reply
+ * \ingroup bloomberg
+ *
+ * The default fills the generic holder: the field ids, the dates of the
+ * first field and a list of values per field, "#NA" for missing values.
+ * Static data are the list of the field strings.
+ * blbts.hpp specialises it to decode into jflib timeseries.
+ *
+ * accepts tells whether a reply of numFields fields can be decoded and
+ * static_data whether strings is available. Requests which cannot be
+ * decoded are refused, replies which cannot be decoded are dropped.
+ */
+template<class HR>
+struct blbhistory  {
+	static const bool	static_data = true;
+	static bool			accepts(long) {return true;}
+
+	/// \brief Static data, one null terminated string per field at p
+	template<class FEED>
+	static void strings(FEED& qp, const char* p, long numFields)  {
+		HR data;   // Data holder
+		for (long n=0; n<numFields; n++) {
+			std::string sp(p);
+			data.append(sp);
+			//if (is_Bulk_field(piFieldList[n])) {
+			//	printf ("\tField: 0x%X  Bulk Data:\n", piFieldList[n]);
+			//	decodeBulkData (p);
+			//}
+			//else {
+				//printf ("\tField: 0x%X \t=\t%s\n", piFieldList[n],p);
+			//}
+			p += sp.size()+1;
+		}
+		qp.set_data(data);
+	}
+
 
-	if(numKeys != 1)  {
-		//m_log->critical("Number of securities should be 1");
-		return BLBHISTFEED();
+	/// \brief counts[f] points of field f follow at points, return the end of the points
+	template<class FEED>
+	static const bb_decode_history_t* fill(FEED& qp, const int4* counts, long numFields,
+										   const bb_decode_history_t* points)  {
+		long   dte;
+		double val;
+
+		HR ffil;	// Holder for field ids
+		HR data;	// Data holder
+		HR datad;	// holder for dates
+
+		data.append(ffil);	// append field ids to data holder
+		data.append(datad); // append dates to data holder
+
+		// Loop around fields
+		for(long f=0;f<numFields;f++)  {
+			unsigned npoins = counts[f];
+			HR dataf;
+			ffil.append(qp.fields.get_slow(f));
+			data.append(dataf);
+
+			// loop around data points
+			for(unsigned i=0;i<npoins;i++)  {
+				dte = points[i].date;
+				val = points[i].value;
+
+				if(f==0) datad.append(dte);
+
+				if(val == BB_VAL_MISSING)
+					dataf.append("#NA");
+				else
+					dataf.append(val);
+			}
+			points += npoins;
+		}
+		qp.set_data(data);
+		return points;
 	}
+};
+
+
+/// \brief Static data of a feed through blbhistory<HR>::strings, value is
+/// false and nothing is decoded if HR has no static data
+template<class HR, bool S = blbhistory<HR>::static_data>
+struct blbstrings  {
+	static const bool value = true;
+	template<class FEED>
+	static void apply(FEED& qp, const char* p, long numFields) {blbhistory<HR>::strings(qp,p,numFields);}
+};
 
-	histdata_type ffil;	  // Holder for field ids
-	histdata_type data;   // Data holder
-	histdata_type datad;  // holder for dates
+template<class HR>
+struct blbstrings<HR,false>  {
+	static const bool value = false;
+	template<class FEED>
+	static void apply(FEED&, const char*, long) {}
+};
 
-	data.append(ffil);	// append field ids to data holder
-	data.append(datad); // append dates to data holder
+
+
+//====================================================================
+//   The message holds an error code per security, the number of
+//   points of each field of each security, then the points,
+//   security by security and field by field. DecodeHistory has
+//   checked the securities and the fields against the request.
+//====================================================================
+template<class F, class LR, class HR, class L>
+inline void blb<F,LR,HR,L>::fillData(const typename blb<F,LR,HR,L>::hist_list& feeds,
+									 typename blb<F,LR,HR,L>::bb_history_type* t)  {
+
+	long numKeys	 = t->num_of_securities;
+	long numFields   = t->num_of_fields;
+	long secStart    = numKeys + numKeys*numFields;
 
 	// Pointer to start of Security Error Codes
-	long  *pSecurityError  = &(t->mhistory_data[0]);
+	int4  *pSecurityError  = t->mhistory_data;
 
 	// Pointer to start of number of points per field
-	long *pNumPts          = &(t->mhistory_data[numKeys]);
+	int4 *pNumPts          = pSecurityError + numKeys;
 
-	bb_decode_type *pData = (bb_decode_type*) t->mhistory_data[secStart];
+	// The points follow the counts
+	const bb_decode_history_t *pData = (const bb_decode_history_t*) (pSecurityError + secStart);
 	
-	// Loop around fields
-	for(int f=0;f<numFields;f++)  {
-		unsigned npoins = pNumPts[f];
-		histdata_type dataf;
-		ffil.append(qp->fields.get_slow(f));
-		data.append(dataf);
-		hist = pData->mhist_data;
-
-		// loop around data points
-		for(unsigned i=0;i<npoins;i++)  {
-			dte = hist[i].date;
-			val = hist[i].value;
-
-			if(f==0) datad.append(dte);
-
-			if(val == BB_VAL_MISSING)
-				dataf.append("#NA");
-			else
-				dataf.append(val);
-		}
-		pData += npoins;
-	}
-	qp->set_data(data);
-	return qp;
+	// Loop around securities
+	for(long s=0;s<numKeys;s++)
+		pData = blbhistory<histdata_type>::fill(*feeds[s],pNumPts + s*numFields,numFields,pData);
 }
 
 
 
 template<class F, class LR, class HR, class L>
-inline typename blb<F,LR,HR,L>::BLBHISTFEED
+inline typename blb<F,LR,HR,L>::hist_list
 blb<F,LR,HR,L>::DecodeStaticData(bb_msg_fieldsx_t *t) {
-    char *p;
-	int lp;
 	int i;
-	int n;
     
 	qm_long id = t->comm_header.request_id;
-	BLBHISTFEED qp = m_hist_ids[id];
-	if(qp)
-		m_hist_ids.erase(id);
-	else
-		return qp;
+	typename id_hist_container::iterator it = m_hist_ids.find(id);
+	if(it == m_hist_ids.end()) return hist_list();
+	hist_list feeds;
+	feeds.swap(it->second);
+	m_hist_ids.erase(it);
+	if(!blbstrings<histdata_type>::value)  {
+		this->DropReply(feeds);
+		return hist_list();
+	}
 	int iNumOfFields = t->NumFields;
+	int iNumOfItems  = std::min(int(t->comm_header.num_items),int(feeds.size()));
 
-	histdata_type data;   // Data holder
     /*
     ** Get the pointer to the first security fields into p.  The field_ptr array will
     ** have the pointers to the fields for each security in the order we 
@@ -363,25 +652,9 @@ blb<F,LR,HR,L>::DecodeStaticData(bb_msg_fieldsx_t *t) {
     ** requested the fields.
     */
 
-	for (i=0; i<t->comm_header.num_items; i++) {
-		p = t->field_ptr[i];
-
-		for (n=0; n<iNumOfFields; n++) {
-			std::string sp(p);
-			data.append(sp);
-			lp = strlen(p)+1;
-			//if (is_Bulk_field(piFieldList[n])) {
-			//	printf ("\tField: 0x%X  Bulk Data:\n", piFieldList[n]);
-			//	decodeBulkData (p);
-			//}
-			//else {
-				//printf ("\tField: 0x%X \t=\t%s\n", piFieldList[n],p);
-			//}
-			p += lp;
-		}
-	}
-	qp->set_data(data);
-	return qp;
+	for (i=0; i<iNumOfItems; i++)
+		blbstrings<histdata_type>::apply(*feeds[i],t->field_ptr[i],iNumOfFields);
+	return feeds;
 }
 
 
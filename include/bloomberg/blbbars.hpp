@@ -0,0 +1,270 @@
+//
+/// \file
+/// \brief Open, high, low, close and volume bars built from live ticks
+/// \ingroup bloomberg
+///
+/// A blbbars consumes the ticks a blb publishes into its tick sink and
+/// keeps, for each ticker and each interval, the bar being built. When a
+/// bar closes it is appended to a jflib timeseries of the ticker, keyed by
+/// the start of the bar in microseconds since the epoch, as a 64 bits integer:
+///
+/// \code
+/// bloomberg::blbbars bars(60.);       // one minute bars
+/// blbtick* t;
+/// while(ring->pop(t))  {
+///     bars.update(*t);
+///     pool->release(t);
+/// }
+/// bars.close(bloomberg::blbjournal::now());
+/// bloomberg::blbbars::tstype ts = bars.series("VOD LN Equity");
+/// \endcode
+///
+
+
+#ifndef   __BLOOMBERG_BARS_QM_HPP__
+#define   __BLOOMBERG_BARS_QM_HPP__
+
+#include <blb.hpp>
+#include <jflib/timeseries/structures.hpp>
+#include <jflib/timeseries/timeseries_matrix.hpp>
+
+
+namespace bloomberg {
+
+
+/** \brief Bars of the trades of each ticker over one or more intervals
+ * \ingroup bloomberg
+ *
+ * Trades update the bar of their interval, other ticks are ignored. Bars
+ * are aligned on multiples of the interval since the epoch, a bar closes
+ * when a trade falls in a later interval or when close is called after its
+ * end. Intervals without trades have no bar. A trade older than the open
+ * bar is added to it.
+ *
+ * The slot of a feed is found through blbFeedBase::m_barred, so an update
+ * costs a few operations per interval whatever the number of tickers.
+ * Nothing is allocated but the slot of a new ticker and the doubling of a
+ * timeseries which is full. A new feed of a ticker seen before, as after a
+ * resubscription, takes over the slot and the bars of the ticker.
+ *
+ * A single thread, the consumer of the ticks, calls update and close.
+ * series can be called from any thread: it returns a copy of the bars
+ * closed so far, which shares nothing with the timeseries the builder
+ * appends to.
+ */
+class blbbars : boost::noncopyable {
+public:
+	typedef boost::int64_t	time_type;
+	typedef jflib::timeseries::traits::ts<time_type,qm_real,jflib::timeseries::ublas_tsmatrix>::type	tstype;
+	typedef std::size_t		size_type;
+
+	/// \brief Series of the timeseries of bars
+	enum series_type {OPEN, HIGH, LOW, CLOSE, VOLUME, SERIES};
+
+	/// \param interval	Seconds in a bar
+	/// \param reserve	Bars preallocated in each timeseries
+	explicit blbbars(double interval, size_type reserve = 64);
+	/// \brief Bars over each of intervals
+	explicit blbbars(const std::vector<double>& intervals, size_type reserve = 64);
+
+	size_type		intervals()				const {return m_intervals.size();}
+	/// \brief Seconds in the bars of interval j
+	double			interval(size_type j)	const {return 1e-6*m_intervals[j];}
+
+	/// \brief Tickers which have traded so far
+	size_type		tickers() const;
+	std::string		ticker(size_type i) const;
+	/// \brief Index of ticker
+	size_type		find(const std::string& ticker) const;
+
+	/// \brief Copy of the closed bars of ticker i over interval j
+	tstype			series(size_type i, size_type j = 0) const;
+	tstype			series(const std::string& ticker, size_type j = 0) const {return this->series(this->find(ticker),j);}
+
+	/// \brief Add a tick at time, in microseconds since the epoch
+	void			update(const blbtick& t, time_type time);
+	/// \brief Add a tick at its time, taken as seconds since the epoch.
+	/// A tick without time (0) is added at the time it is consumed
+	void			update(const blbtick& t) {this->update(t,t.time ? 1000000*time_type(t.time) : blbjournal::now());}
+
+	/// \brief Close the bars which end before time and return how many
+	size_type		close(time_type time);
+private:
+	struct slot  {
+		slot(const blbFeedBase* f):feed(f),ticker(f->ticker()){}
+		const blbFeedBase*	feed;
+		std::string			ticker;
+	};
+	struct bar  {
+		bar():active(false),start(0),open(0),high(0),low(0),close(0),volume(0){}
+		bool		active;
+		time_type	start;
+		qm_real		open, high, low, close, volume;
+		tstype		series;
+	};
+	typedef std::map<std::string,size_type>		ticker_map;
+
+	std::vector<time_type>	m_intervals;
+	size_type				m_reserve;
+	std::vector<slot>		m_slots;
+	std::vector<bar>		m_bars;
+	ticker_map				m_ids;
+	mutable boost::mutex	m_mutex;
+
+	void		init();
+	size_type	add(blbFeedBase& feed);
+	void		emit(bar& b);
+};
+
+
+
+inline blbbars::blbbars(double interval, size_type reserve):m_intervals(1,time_type(1e6*interval)),m_reserve(reserve)  {
+	this->init();
+}
+
+inline blbbars::blbbars(const std::vector<double>& intervals, size_type reserve):m_reserve(reserve)  {
+	for(std::vector<double>::const_iterator it=intervals.begin();it!=intervals.end();++it)
+		m_intervals.push_back(time_type(1e6*(*it)));
+	this->init();
+}
+
+inline void blbbars::init()  {
+	using namespace jflib;
+	QM_REQUIRE(m_intervals.size(),"At least one interval is needed");
+	QM_REQUIRE(m_reserve > 0,"At least one bar must be reserved");
+	for(std::vector<time_type>::const_iterator it=m_intervals.begin();it!=m_intervals.end();++it)
+		QM_REQUIRE(*it > 0,"Intervals must be at least one microsecond");
+}
+
+
+inline blbbars::size_type blbbars::tickers() const  {
+	boost::mutex::scoped_lock lock(m_mutex);
+	return m_slots.size();
+}
+
+inline std::string blbbars::ticker(size_type i) const  {
+	using namespace jflib;
+	boost::mutex::scoped_lock lock(m_mutex);
+	QM_REQUIRE(i < m_slots.size(),"Ticker out of range");
+	return m_slots[i].ticker;
+}
+
+inline blbbars::size_type blbbars::find(const std::string& ticker) const  {
+	using namespace jflib;
+	boost::mutex::scoped_lock lock(m_mutex);
+	ticker_map::const_iterator it = m_ids.find(ticker);
+	QM_REQUIRE(it != m_ids.end(),"No bars for " << ticker);
+	return it->second;
+}
+
+inline blbbars::tstype blbbars::series(size_type i, size_type j) const  {
+	using namespace jflib;
+	boost::mutex::scoped_lock lock(m_mutex);
+	QM_REQUIRE(i < m_slots.size() && j < m_intervals.size(),"Bars out of range");
+	return m_bars[i*m_intervals.size() + j].series.clone();
+}
+
+
+inline void blbbars::update(const blbtick& t, time_type time)  {
+	if(t.action != bTickTRADE) return;
+	long s = t.feed->m_barred;
+	if(s < 0 || size_type(s) >= m_slots.size() || m_slots[s].feed != t.feed)
+		s = long(this->add(*t.feed));
+	size_type k = m_intervals.size();
+	bar* b = &m_bars[s*k];
+	for(size_type j=0;j<k;++j,++b)  {
+		time_type start = time - time % m_intervals[j];
+		if(b->active && start > b->start)
+			this->emit(*b);
+		if(!b->active)  {
+			b->active = true;
+			b->start  = start;
+			b->open   = b->high = b->low = t.value;
+			b->volume = 0;
+		}
+		else  {
+			b->high = std::max(b->high,t.value);
+			b->low  = std::min(b->low,t.value);
+		}
+		b->close   = t.value;
+		b->volume += t.size;
+	}
+}
+
+inline blbbars::size_type blbbars::close(time_type time)  {
+	size_type k = m_intervals.size();
+	size_type n = 0;
+	for(size_type i=0;i<m_bars.size();++i)  {
+		bar& b = m_bars[i];
+		if(b.active && b.start + m_intervals[i % k] <= time)  {
+			this->emit(b);
+			++n;
+		}
+	}
+	return n;
+}
+
+
+//=================================================================
+//   A new ticker gets a slot and an empty timeseries per interval,
+//   a new feed of a known ticker takes over the slot of the ticker.
+//   m_barred of a feed in another builder is not overwritten.
+//=================================================================
+inline blbbars::size_type blbbars::add(blbFeedBase& feed)  {
+	using namespace jflib;
+	QM_REQUIRE(feed.m_barred < 0,"The feed of " << feed.ticker() << " is in another bar builder");
+	boost::mutex::scoped_lock lock(m_mutex);
+	ticker_map::const_iterator it = m_ids.find(feed.ticker());
+	if(it != m_ids.end())  {
+		m_slots[it->second].feed = &feed;
+		feed.m_barred = long(it->second);
+		return it->second;
+	}
+	size_type s = m_slots.size();
+	m_slots.push_back(slot(&feed));
+	m_bars.resize(m_bars.size() + m_intervals.size());
+	for(size_type j=0;j<m_intervals.size();++j)
+		m_bars[s*m_intervals.size() + j].series = tstype(feed.ticker(),m_reserve,SERIES);
+	m_ids[feed.ticker()] = s;
+	feed.m_barred = long(s);
+	return s;
+}
+
+//=================================================================
+//   Append the bar to its timeseries. A full timeseries is copied
+//   into one twice as large.
+//=================================================================
+inline void blbbars::emit(bar& b)  {
+	boost::mutex::scoped_lock lock(m_mutex);
+	size_type r = b.series.size();
+	tstype::matrix_type_ptr m = b.series.support();
+	if(r == m->rows())  {
+		tstype ts(b.series.name(),2*r,SERIES);
+		tstype::matrix_type_ptr g = ts.support();
+		for(size_type c=0;c<SERIES;++c)
+			for(size_type i=0;i<r;++i)  {
+				g->data(i,c) = m->data(i,c);
+				g->mask(i,c) = m->mask(i,c);
+			}
+		size_type i = 0;
+		for(tstype::const_key_iterator k=b.series.key_begin();k!=b.series.key_end();++k,++i)
+			ts.insertrow(ts.end(),i,*k);
+		b.series = ts;
+		m = g;
+	}
+	m->data(r,OPEN)   = b.open;
+	m->data(r,HIGH)   = b.high;
+	m->data(r,LOW)    = b.low;
+	m->data(r,CLOSE)  = b.close;
+	m->data(r,VOLUME) = b.volume;
+	for(size_type c=0;c<SERIES;++c)
+		m->mask(r,c) = 1;
+	b.series.insertrow(b.series.end(),r,b.start);
+	b.active = false;
+}
+
+
+}
+
+
+#endif	//	__BLOOMBERG_BARS_QM_HPP__
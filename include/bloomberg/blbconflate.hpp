@@ -0,0 +1,203 @@
+
+
+
+/** \brief Latest live data of each security, for consumers which do not need every tick
+ * \ingroup bloomberg
+ *
+ * A single writer, the thread decoding the ticks, overwrites the slot of a
+ * security with its latest livedata. Any number of readers take
+ * snapshots of the securities updated since their previous snapshot
+ * through a blbsubscriber. Slots are preallocated and guarded by a
+ * sequence lock, so the writer never waits for readers and readers never
+ * see a half written update.
+ *
+ * Consumers which need every tick use a tick sink instead (see
+ * blb::set_tick_sink).
+ *
+ * Each slot records the feed it belongs to, so a feed whose slot is in
+ * another conflator gets a new slot. The slot of a stopped feed is
+ * released and reused by the next new feed. Updates of securities beyond
+ * the capacity are counted in dropped(). Tickers longer than
+ * ticker_size - 1 characters are truncated.
+ */
+class blbconflator : boost::noncopyable {
+public:
+	typedef std::size_t		size_type;
+	static const size_type	ticker_size = 64;
+
+	/// \brief Latest data of a security
+	struct snapshot  {
+		std::string		ticker;
+		livedata		data;
+		/// \brief Updates conflated into this snapshot
+		unsigned long	updates;
+	};
+	typedef std::vector<snapshot>	snapshot_list;
+
+	explicit blbconflator(size_type securities = 4096);
+	~blbconflator() {delete [] m_slots;}
+
+	size_type	capacity()	const {return m_capacity;}
+	/// \brief Slots used so far, released slots included
+	size_type	size()		const {return m_size.load(boost::memory_order_acquire);}
+	/// \brief Updates lost because the conflator was full
+	unsigned long	dropped() const {return m_dropped.load(boost::memory_order_relaxed);}
+
+	/// \brief Overwrite the latest data of feed. Called by the writer only
+	void		update(blbFeedBase& feed, const livedata& data);
+	/// \brief Release the slot of a stopped feed for later feeds. Called by the writer only
+	void		release(blbFeedBase& feed);
+
+	/// \brief Append to out the securities updated after the sequence numbers
+	/// in seen and advance them. Called by blbsubscriber
+	size_type	collect(std::vector<unsigned long>& seen, snapshot_list& out) const;
+private:
+	/// \brief Latest data of a feed, an empty ticker for a released slot.
+	/// The ticker is written under the sequence lock, as the data
+	struct slot  {
+		slot():sequence(0),feed(0){ticker[0] = 0;}
+		boost::atomic<unsigned long>	sequence;
+		const blbFeedBase*				feed;
+		char							ticker[ticker_size];
+		qm_real							last, bid, ask, open, volume;
+		char							pad[QM_CACHE_LINE];
+	};
+	slot*							m_slots;
+	size_type						m_capacity;
+	boost::atomic<size_type>		m_size;
+	boost::atomic<unsigned long>	m_dropped;
+	/// \brief Released slots, reserved to the capacity. Used by the writer only
+	std::vector<size_type>			m_free;
+};
+
+
+/** \brief A consumer of a blbconflator
+ * \ingroup bloomberg
+ *
+ * Each consumer thread owns its subscriber. snapshot returns what changed
+ * since the previous call, poll does the same at most once per interval.
+ */
+class blbsubscriber  {
+public:
+	typedef blbconflator::size_type			size_type;
+	typedef blbconflator::snapshot_list		snapshot_list;
+
+	/// \param interval Minimum number of seconds between two polls
+	blbsubscriber(boost::shared_ptr<blbconflator> conflator, double interval = 0.):
+		m_conflator(conflator),m_interval(boost::posix_time::microseconds(long(1e6*interval))),
+		m_next(boost::posix_time::min_date_time){}
+
+	double		interval() const {return 1e-6*m_interval.total_microseconds();}
+	void		set_interval(double v) {m_interval = boost::posix_time::microseconds(long(1e6*v));}
+
+	/// \brief Snapshots of the securities updated since the previous call, now
+	size_type	snapshot(snapshot_list& out)  {
+		m_next = boost::posix_time::microsec_clock::universal_time() + m_interval;
+		return m_conflator->collect(m_seen,out);
+	}
+	/// \brief As snapshot, but returns 0 without collecting if the interval has not elapsed
+	size_type	poll(snapshot_list& out)  {
+		if(boost::posix_time::microsec_clock::universal_time() < m_next) return 0;
+		return this->snapshot(out);
+	}
+private:
+	boost::shared_ptr<blbconflator>		m_conflator;
+	boost::posix_time::time_duration	m_interval;
+	boost::posix_time::ptime			m_next;
+	std::vector<unsigned long>			m_seen;
+};
+
+
+
+inline blbconflator::blbconflator(size_type securities):m_slots(new slot[securities]),
+									m_capacity(securities),m_size(0),m_dropped(0)  {
+	m_free.reserve(securities);
+}
+
+
+inline void blbconflator::update(blbFeedBase& feed, const livedata& data)  {
+	size_type n = m_size.load(boost::memory_order_relaxed);
+	bool fresh = feed.m_conflated < 0 || size_type(feed.m_conflated) >= n || m_slots[feed.m_conflated].feed != &feed;
+	if(fresh)  {
+		size_type i = n;
+		if(!m_free.empty())  {
+			i = m_free.back();
+			m_free.pop_back();
+		}
+		else if(n == m_capacity)  {
+			m_dropped.store(m_dropped.load(boost::memory_order_relaxed) + 1,boost::memory_order_relaxed);
+			return;
+		}
+		m_slots[i].feed  = &feed;
+		feed.m_conflated = long(i);
+	}
+	slot& s = m_slots[feed.m_conflated];
+	unsigned long seq = s.sequence.load(boost::memory_order_relaxed);
+	s.sequence.store(seq + 1,boost::memory_order_relaxed);
+	boost::atomic_thread_fence(boost::memory_order_release);
+	if(fresh)  {
+		const std::string& ticker = feed.ticker();
+		size_type len = std::min<size_type>(ticker.size(),ticker_size - 1);
+		std::memcpy(s.ticker,ticker.data(),len);
+		s.ticker[len] = 0;
+	}
+	s.last   = data.get_last();
+	s.bid    = data.get_bid();
+	s.ask    = data.get_ask();
+	s.open   = data.get_open();
+	s.volume = data.get_volume();
+	s.sequence.store(seq + 2,boost::memory_order_release);
+	if(size_type(feed.m_conflated) == n)
+		m_size.store(n + 1,boost::memory_order_release);
+}
+
+
+inline void blbconflator::release(blbFeedBase& feed)  {
+	size_type n = m_size.load(boost::memory_order_relaxed);
+	if(feed.m_conflated < 0 || size_type(feed.m_conflated) >= n || m_slots[feed.m_conflated].feed != &feed) return;
+	slot& s = m_slots[feed.m_conflated];
+	unsigned long seq = s.sequence.load(boost::memory_order_relaxed);
+	s.sequence.store(seq + 1,boost::memory_order_relaxed);
+	boost::atomic_thread_fence(boost::memory_order_release);
+	s.ticker[0] = 0;
+	s.sequence.store(seq + 2,boost::memory_order_release);
+	s.feed = 0;
+	m_free.push_back(size_type(feed.m_conflated));
+	feed.m_conflated = -1;
+}
+
+
+inline blbconflator::size_type
+blbconflator::collect(std::vector<unsigned long>& seen, snapshot_list& out) const  {
+	size_type n = this->size();
+	seen.resize(n,0);
+	size_type count = 0;
+	for(size_type i=0;i<n;++i)  {
+		const slot& s = m_slots[i];
+		if(s.sequence.load(boost::memory_order_acquire) == seen[i]) continue;
+		livedata d;
+		char ticker[ticker_size];
+		unsigned long before, after;
+		do  {
+			before = s.sequence.load(boost::memory_order_acquire);
+			d = livedata(s.last,s.bid,s.ask,s.open,s.volume);
+			std::memcpy(ticker,s.ticker,ticker_size);
+			boost::atomic_thread_fence(boost::memory_order_acquire);
+			after = s.sequence.load(boost::memory_order_relaxed);
+		} while(before != after || (before & 1));
+		// a released slot
+		if(!ticker[0])  {
+			seen[i] = after;
+			continue;
+		}
+		snapshot sn;
+		sn.ticker  = ticker;
+		sn.data    = d;
+		sn.updates = (after - seen[i])/2;
+		out.push_back(sn);
+		seen[i] = after;
+		++count;
+	}
+	return count;
+}
+
@@ -0,0 +1,312 @@
+
+
+
+/** \brief No-op guard, the default of blbevent
+ * \ingroup bloomberg
+ */
+struct blbnoguard {};
+
+
+/** \brief Event loop of a Bloomberg connection on a dedicated I/O thread
+ * \ingroup bloomberg
+ *
+ * The I/O thread waits on the Bloomberg socket with epoll (poll where epoll
+ * is not available), decodes the messages and hands the decoded feeds to
+ * the consumers through single producer rings. Requests are queued from any
+ * thread in a multiple producers ring and sent by the I/O thread, so that
+ * the Bloomberg API is used by the I/O thread only.
+ *
+ * A G object is held while the I/O thread uses the API or creates results,
+ * jflib::python::acquire_gil when results hold python objects.
+ *
+ * Consumers are added before start and poll their ring, a full ring drops
+ * the result and counts it in dropped().
+ *
+ * The wake up pipe and the wait are POSIX, blbevent is not available on WIN32.
+ */
+template<class B, class G = blbnoguard>
+class blbevent : boost::noncopyable {
+public:
+	typedef B										blb_type;
+	typedef G										guard_type;
+	typedef typename blb_type::BLB					BLB;
+	typedef typename blb_type::BLBFEEDR				BLBFEEDR;
+	typedef typename blb_type::fieldlisttype		fieldlisttype;
+	typedef std::size_t								size_type;
+
+	typedef jflib::threads::spscring<BLBFEEDR>		consumer_type;
+	typedef boost::shared_ptr<consumer_type>		CONSUMER;
+
+	/// \brief A request queued for the I/O thread. Fields are copied, qm_buffer copies share memory
+	struct request {
+		enum kind {LIVE, STOP, HISTORY, STATIC};
+		request():type(LIVE),start(0),end(0){}
+		kind				type;
+		std::string			ticker;
+		std::vector<long>	fields;
+		long				start, end;
+	};
+	typedef jflib::threads::mpscring<request>		request_ring;
+
+	blbevent(BLB b, size_type requests = 1024);
+	~blbevent();
+
+	/// \brief Add a consumer ring. Must be called before start
+	CONSUMER	add_consumer(size_type capacity = 4096);
+
+	void		start();
+	void		stop();
+	bool		running()	const {return m_running.load(boost::memory_order_acquire);}
+	/// \brief Number of results dropped because a consumer ring was full
+	size_type	dropped()	const {return m_dropped.load(boost::memory_order_relaxed);}
+	/// \brief Last error of the I/O thread, empty if none
+	std::string	error()		const;
+
+	/// \brief Queue requests, return false if the request ring is full
+	bool		live(const std::string& ticker);
+	bool		stop_live(const std::string& ticker);
+	bool		history(const std::string& ticker, long startDate, long endDate, const fieldlisttype& fields);
+	bool		data(const std::string& ticker, const fieldlisttype& fields);
+private:
+	BLB									m_blb;
+	std::vector<CONSUMER>				m_consumers;
+	request_ring						m_requests;
+	boost::shared_ptr<boost::thread>	m_thread;
+	boost::atomic<bool>					m_stop;
+	boost::atomic<bool>					m_running;
+	boost::atomic<size_type>			m_dropped;
+	mutable boost::mutex				m_mutex;
+	std::string							m_error;
+	int									m_wake[2];
+	int									m_poll;
+
+	bool	queue(const request& r);
+	void	wake();
+	void	run();
+	void	loop();
+	void	send();
+	void	publish(const BLBFEEDR& r);
+};
+
+
+
+template<class B, class G>
+inline blbevent<B,G>::blbevent(BLB b, size_type requests):m_blb(b),m_requests(requests),
+							m_stop(false),m_running(false),m_dropped(0),m_poll(-1) {
+	using namespace jflib;
+	QM_REQUIRE(m_blb,"Bloomberg wrapper is null");
+	QM_REQUIRE(pipe(m_wake) == 0,"Could not create the wake up pipe of the Bloomberg event loop");
+	fcntl(m_wake[0],F_SETFL,fcntl(m_wake[0],F_GETFL) | O_NONBLOCK);
+	fcntl(m_wake[1],F_SETFL,fcntl(m_wake[1],F_GETFL) | O_NONBLOCK);
+}
+
+template<class B, class G>
+inline blbevent<B,G>::~blbevent()  {
+	this->stop();
+	close(m_wake[0]);
+	close(m_wake[1]);
+}
+
+template<class B, class G>
+inline typename blbevent<B,G>::CONSUMER
+blbevent<B,G>::add_consumer(size_type capacity)  {
+	using namespace jflib;
+	QM_REQUIRE(!m_thread,"Consumers must be added before the event loop starts");
+	CONSUMER c(new consumer_type(capacity));
+	m_consumers.push_back(c);
+	return c;
+}
+
+template<class B, class G>
+inline void blbevent<B,G>::start()  {
+	using namespace jflib;
+	if(m_thread) return;
+	BLBCON con = m_blb->get_connection();
+	QM_REQUIRE(con->connection(),"Not connected to API. Connect please.");
+	int sock = (int)con->bb_sock;
+#ifdef	BLB_USE_EPOLL
+	m_poll = epoll_create(2);
+	QM_REQUIRE(m_poll >= 0,"Could not create the epoll instance of the Bloomberg event loop");
+	epoll_event ev;
+	ev.events  = EPOLLIN;
+	ev.data.fd = m_wake[0];
+	epoll_ctl(m_poll,EPOLL_CTL_ADD,m_wake[0],&ev);
+	ev.data.fd = sock;
+	QM_REQUIRE(epoll_ctl(m_poll,EPOLL_CTL_ADD,sock,&ev) == 0,"Could not watch the Bloomberg socket");
+#endif	//	BLB_USE_EPOLL
+	m_stop.store(false);
+	m_running.store(true);
+	m_thread.reset(new boost::thread(boost::bind(&blbevent::run,this)));
+}
+
+template<class B, class G>
+inline void blbevent<B,G>::stop()  {
+	if(!m_thread) return;
+	m_stop.store(true,boost::memory_order_release);
+	this->wake();
+	m_thread->join();
+	m_thread.reset();
+#ifdef	BLB_USE_EPOLL
+	close(m_poll);
+	m_poll = -1;
+#endif	//	BLB_USE_EPOLL
+}
+
+template<class B, class G>
+inline std::string blbevent<B,G>::error() const  {
+	boost::mutex::scoped_lock lock(m_mutex);
+	return m_error;
+}
+
+template<class B, class G>
+inline bool blbevent<B,G>::live(const std::string& ticker)  {
+	request r;
+	r.type   = request::LIVE;
+	r.ticker = ticker;
+	return this->queue(r);
+}
+
+template<class B, class G>
+inline bool blbevent<B,G>::stop_live(const std::string& ticker)  {
+	request r;
+	r.type   = request::STOP;
+	r.ticker = ticker;
+	return this->queue(r);
+}
+
+template<class B, class G>
+inline bool blbevent<B,G>::history(const std::string& ticker, long startDate, long endDate,
+								   const fieldlisttype& fields)  {
+	request r;
+	r.type   = request::HISTORY;
+	r.ticker = ticker;
+	r.start  = startDate;
+	r.end    = endDate;
+	r.fields.assign(fields.ptr(),fields.ptr() + fields.size());
+	return this->queue(r);
+}
+
+template<class B, class G>
+inline bool blbevent<B,G>::data(const std::string& ticker, const fieldlisttype& fields)  {
+	request r;
+	r.type   = request::STATIC;
+	r.ticker = ticker;
+	r.fields.assign(fields.ptr(),fields.ptr() + fields.size());
+	return this->queue(r);
+}
+
+template<class B, class G>
+inline bool blbevent<B,G>::queue(const request& r)  {
+	if(!m_requests.push(r)) return false;
+	this->wake();
+	return true;
+}
+
+// A full pipe already holds a pending wake up, the write result is ignored
+template<class B, class G>
+inline void blbevent<B,G>::wake()  {
+	char c = 0;
+	ssize_t rc = write(m_wake[1],&c,1);
+	(void)rc;
+}
+
+
+template<class B, class G>
+inline void blbevent<B,G>::run()  {
+	try  {
+		this->loop();
+	}
+	catch(std::exception& e)  {
+		boost::mutex::scoped_lock lock(m_mutex);
+		m_error = e.what();
+	}
+	m_running.store(false,boost::memory_order_release);
+}
+
+
+//=================================================================
+//   The I/O thread: wait for the socket or a wake up, send the
+//   queued requests and decode what the socket has received.
+//=================================================================
+template<class B, class G>
+inline void blbevent<B,G>::loop()  {
+	using namespace jflib;
+	int  sock = (int)m_blb->get_connection()->bb_sock;
+	char drain[64];
+#ifndef	BLB_USE_EPOLL
+	pollfd fds[2];
+	fds[0].fd = m_wake[0];
+	fds[0].events = POLLIN;
+	fds[1].fd = sock;
+	fds[1].events = POLLIN;
+#endif	//	BLB_USE_EPOLL
+
+	while(!m_stop.load(boost::memory_order_acquire))  {
+		bool readable = false;
+		bool failed   = false;
+#ifdef	BLB_USE_EPOLL
+		epoll_event ev[2];
+		int n = epoll_wait(m_poll,ev,2,-1);
+		for(int i=0;i<n;++i)  {
+			if(ev[i].data.fd != sock) continue;
+			readable = (ev[i].events & EPOLLIN) != 0;
+			failed   = (ev[i].events & (EPOLLERR | EPOLLHUP)) != 0;
+		}
+#else
+		int n = poll(fds,2,-1);
+		if(n > 0)  {
+			readable = (fds[1].revents & POLLIN) != 0;
+			failed   = (fds[1].revents & (POLLERR | POLLHUP | POLLNVAL)) != 0;
+		}
+#endif	//	BLB_USE_EPOLL
+		if(n < 0)  {
+			if(errno == EINTR) continue;
+			QM_FAIL("Bloomberg Loop: error from wait.");
+		}
+		// The wait returned, the latency of a message starts here
+		boost::int64_t stamp = readable && m_blb->stats() ? blbstats::now() : 0;
+		while(read(m_wake[0],drain,sizeof(drain)) > 0);
+
+		if(readable || !m_requests.empty())  {
+			guard_type guard;
+			(void)guard;
+			this->send();
+			if(readable)
+				this->publish(m_blb->receive(stamp));
+		}
+		// Messages received before a hang up are published first
+		if(failed)
+			QM_FAIL("Exeption on Bloomberg socket.");
+	}
+}
+
+template<class B, class G>
+inline void blbevent<B,G>::send()  {
+	request r;
+	while(m_requests.pop(r))  {
+		fieldlisttype fields(r.fields.size());
+		std::copy(r.fields.begin(),r.fields.end(),fields.ptr());
+		try  {
+			switch(r.type)  {
+				case request::LIVE:		m_blb->get_live_feed(r.ticker);						break;
+				case request::STOP:		m_blb->stop_live_feed(r.ticker);					break;
+				case request::HISTORY:	m_blb->get_hist_feed(r.ticker,r.start,r.end,fields);	break;
+				case request::STATIC:	m_blb->get_data_feed(r.ticker,fields);				break;
+			}
+		}
+		catch(std::exception& e)  {
+			// A rejected request does not stop the loop
+			boost::mutex::scoped_lock lock(m_mutex);
+			m_error = e.what();
+		}
+	}
+}
+
+template<class B, class G>
+inline void blbevent<B,G>::publish(const BLBFEEDR& r)  {
+	if(!r) return;
+	for(typename std::vector<CONSUMER>::const_iterator it=m_consumers.begin();it!=m_consumers.end();++it)
+		if(!(*it)->push(r))
+			m_dropped.fetch_add(1,boost::memory_order_relaxed);
+}
+
@@ -0,0 +1,442 @@
+
+
+
+/** \brief A journaled tick, 32 bytes
+ * \ingroup bloomberg
+ */
+struct blbjournalrecord  {
+	/// \brief Microseconds since the epoch when the tick message was received
+	boost::int64_t	time;
+	qm_real			value;
+	/// \brief Index of the ticker in the ticker table of the segment
+	boost::int32_t	ticker;
+	boost::int32_t	action;
+	boost::int32_t	size;
+	/// \brief Time of the tick sent by Bloomberg
+	boost::int32_t	tick_time;
+};
+
+
+/** \brief Header of a journal segment file
+ * \ingroup bloomberg
+ *
+ * The ticker table, tickers entries of BLB_JOURNAL_KEY_SIZE bytes, and the
+ * records follow the header at the given offsets. count and names are the
+ * records and tickers written so far, the rest of the file is preallocated.
+ */
+struct blbjournalheader  {
+	char			magic[8];
+	boost::uint32_t	version;
+	boost::uint32_t	endian;
+	boost::uint32_t	recordsize;
+	boost::uint32_t	tickers;
+	boost::uint64_t	capacity;
+	boost::uint64_t	names;
+	boost::uint64_t	count;
+	boost::uint64_t	table;
+	boost::uint64_t	records;
+	boost::uint64_t	size;
+};
+
+#define BLB_JOURNAL_KEY_SIZE	32
+
+static const char			 blbjournal_magic[8]	= {'B','L','B','J','R','N','L','1'};
+static const boost::uint32_t blbjournal_version		= 1;
+static const boost::uint32_t blbjournal_endian		= 0x01020304;
+
+
+/// \brief File name of segment n of the journal prefix
+inline std::string blbjournal_segment(const std::string& prefix, unsigned n)  {
+	char s[16];
+	std::sprintf(s,".%06u.blj",n);
+	return prefix + s;
+}
+
+
+
+/** \brief Append-only journal of the live ticks of a blb
+ * \ingroup bloomberg
+ *
+ * Records are written into memory-mapped segment files of a fixed number
+ * of records, allocated when the segment is created, so that appending a
+ * tick is a copy into memory. A new segment is created when the current
+ * one is full. Each segment holds the table of the tickers journaled so
+ * far and can be read on its own.
+ *
+ * A single writer, the thread decoding the ticks, appends records. The
+ * records count of a segment is published once per tick message.
+ *
+ * Segments are preallocated on disk, so that a full disk is found when a
+ * segment is created rather than when a page of the mapping is written.
+ * The writer never throws: ticks which cannot be journaled, because the
+ * ticker table is full or a new segment cannot be created, are counted in
+ * dropped() and the last failure is kept in error(). Creating the segment
+ * is tried again with the next tick message.
+ */
+class blbjournal : boost::noncopyable {
+public:
+	typedef std::size_t		size_type;
+
+	/// \param prefix		Segment files are prefix.000000.blj, prefix.000001.blj, ...
+	/// \param records		Records per segment
+	/// \param tickers		Maximum number of tickers
+	explicit blbjournal(const std::string& prefix, size_type records = 1 << 20, size_type tickers = 4096);
+	~blbjournal() {this->flush();}
+
+	const std::string&	prefix()	const {return m_prefix;}
+	/// \brief Segments created so far
+	unsigned			segments()	const {return m_segment + 1;}
+	/// \brief Records written so far
+	boost::uint64_t		size()		const {return m_written;}
+	/// \brief Ticks not journaled
+	unsigned long		dropped()	const {return m_dropped.load(boost::memory_order_relaxed);}
+	/// \brief Last failure of the writer, empty if none
+	std::string			error()		const;
+
+	/// \brief Index of ticker, added to the ticker table if new. -1 if the
+	/// ticker is too long or the table is full, see error()
+	boost::int32_t		ticker(const std::string& ticker);
+	/// \brief Time stamp of the following records, called once per tick message
+	void				stamp();
+	/// \brief Append a tick of feed
+	void				append(blbFeedBase& feed, const bb_decode_tickx_t& tick, qm_real value, int size);
+	/// \brief Publish the records appended since the previous commit
+	void				commit()	{m_header->count = m_count;}
+	/// \brief Write the mapped segment to disk
+	void				flush();
+
+	/// \brief Microseconds since the epoch
+	static boost::int64_t now();
+private:
+	typedef boost::interprocess::mapped_region	region_type;
+	typedef std::map<std::string,boost::int32_t>	ticker_map;
+
+	std::string						m_prefix;
+	size_type						m_capacity;
+	size_type						m_tickers;
+	unsigned						m_segment;
+	boost::shared_ptr<region_type>	m_region;
+	blbjournalheader*				m_header;
+	char*							m_table;
+	blbjournalrecord*				m_records;
+	boost::uint64_t					m_count;
+	boost::uint64_t					m_written;
+	boost::int64_t					m_time;
+	ticker_map						m_ids;
+	std::vector<std::string>		m_names;
+	bool							m_retry;
+	boost::atomic<unsigned long>	m_dropped;
+	std::string						m_error;
+	mutable boost::mutex			m_error_mutex;
+
+	bool	open(unsigned n);
+	void	name(boost::int32_t id);
+	bool	fail(const std::string& error);
+	void	drop()	{m_dropped.store(m_dropped.load(boost::memory_order_relaxed) + 1,boost::memory_order_relaxed);}
+};
+
+
+
+/** \brief Reader of a blbjournal, replays it to the consumers of a blb
+ * \ingroup bloomberg
+ *
+ * Segments are memory-mapped read-only. replay publishes the records as
+ * blbtick into a tick sink and updates a conflator, the consumer interface
+ * of blb, at the original speed, faster, or as fast as the consumers take
+ * them. The feeds of the ticks are owned by the reader. Ticks are stamped
+ * readable and received when published, blbstats::handoff times the
+ * consumers.
+ */
+class blbjournalreader : boost::noncopyable {
+public:
+	typedef std::size_t		size_type;
+
+	explicit blbjournalreader(const std::string& prefix);
+
+	size_type					segments()	const {return m_segments.size();}
+	/// \brief Records of all segments
+	size_type					size()		const {return m_size;}
+	size_type					tickers()	const {return m_feeds.size();}
+	const std::string&			ticker(size_type id) const {return m_feeds[id]->ticker();}
+	/// \brief Record i, in the order of writing
+	const blbjournalrecord&		at(size_type i) const;
+
+	void	set_tick_sink(BLBTICKPOOL pool, BLBTICKRING ring);
+	void	set_conflator(BLBCONFLATOR conflator) {m_conflator = conflator;}
+
+	/// \brief Replay the records, speed times faster than they were received,
+	/// as fast as possible if speed is 0. Return the number of records replayed
+	size_type	replay(double speed = 1.);
+private:
+	typedef boost::interprocess::mapped_region	region_type;
+	typedef boost::shared_ptr<blbFeedBase>		FEED;
+
+	struct segment  {
+		boost::shared_ptr<region_type>	region;
+		const blbjournalrecord*			records;
+		size_type						count;
+	};
+	std::vector<segment>		m_segments;
+	std::vector<FEED>			m_feeds;
+	std::vector<livedata>		m_data;
+	size_type					m_size;
+	BLBTICKPOOL					m_tick_pool;
+	BLBTICKRING					m_tick_sink;
+	BLBCONFLATOR				m_conflator;
+
+	void	publish(const blbjournalrecord& r);
+};
+
+
+
+inline blbjournal::blbjournal(const std::string& prefix, size_type records, size_type tickers):
+						m_prefix(prefix),m_capacity(records),m_tickers(tickers),m_segment(0),
+						m_header(0),m_count(0),m_written(0),m_time(0),m_retry(true),m_dropped(0)  {
+	using namespace jflib;
+	QM_REQUIRE(records > 0 && tickers > 0,"Journal segments need room for records and tickers");
+	QM_REQUIRE(this->open(0),m_error);
+}
+
+inline boost::int64_t blbjournal::now()  {
+	using namespace boost::posix_time;
+	static const ptime epoch(boost::gregorian::date(1970,1,1));
+	return (microsec_clock::universal_time() - epoch).total_microseconds();
+}
+
+inline void blbjournal::stamp()  {
+	m_time  = now();
+	m_retry = true;
+}
+
+inline std::string blbjournal::error() const  {
+	boost::mutex::scoped_lock lock(m_error_mutex);
+	return m_error;
+}
+
+inline bool blbjournal::fail(const std::string& error)  {
+	boost::mutex::scoped_lock lock(m_error_mutex);
+	m_error = error;
+	return false;
+}
+
+inline boost::int32_t blbjournal::ticker(const std::string& ticker)  {
+	ticker_map::const_iterator it = m_ids.find(ticker);
+	if(it != m_ids.end()) return it->second;
+	if(m_names.size() == m_tickers)  {
+		std::ostringstream s;
+		s << "Too many tickers for the journal, capacity " << m_tickers << ", " << ticker << " is not journaled";
+		this->fail(s.str());
+		return -1;
+	}
+	if(ticker.size() >= BLB_JOURNAL_KEY_SIZE)  {
+		this->fail("Ticker too long for the journal: " + ticker);
+		return -1;
+	}
+	boost::int32_t id = boost::int32_t(m_names.size());
+	m_names.push_back(ticker);
+	m_ids[ticker] = id;
+	this->name(id);
+	return id;
+}
+
+// A feed refused by the ticker table is marked -2 and not looked up again
+inline void blbjournal::append(blbFeedBase& feed, const bb_decode_tickx_t& tick, qm_real value, int size)  {
+	if(feed.m_journaled == -1 && (feed.m_journaled = this->ticker(feed.ticker())) < 0)
+		feed.m_journaled = -2;
+	if(feed.m_journaled < 0)  {
+		this->drop();
+		return;
+	}
+	if(m_count == m_capacity)  {
+		if(!m_retry)  {
+			this->drop();
+			return;
+		}
+		this->commit();
+		this->flush();
+		m_retry = false;
+		if(!this->open(m_segment + 1))  {
+			this->drop();
+			return;
+		}
+	}
+	blbjournalrecord& r = m_records[m_count++];
+	r.time      = m_time;
+	r.value     = value;
+	r.ticker    = boost::int32_t(feed.m_journaled);
+	r.action    = tick.action;
+	r.size      = size;
+	r.tick_time = tick.time;
+	++m_written;
+}
+
+inline void blbjournal::flush()  {
+	if(!m_region) return;
+	this->commit();
+	m_region->flush();
+}
+
+// Create segment n, preallocated, with the tickers known so far. On failure
+// the current segment is kept and the error recorded
+inline bool blbjournal::open(unsigned n)  {
+	namespace ip = boost::interprocess;
+	blbjournalheader h;
+	std::memset(&h,0,sizeof(h));
+	std::memcpy(h.magic,blbjournal_magic,sizeof(blbjournal_magic));
+	h.version    = blbjournal_version;
+	h.endian     = blbjournal_endian;
+	h.recordsize = sizeof(blbjournalrecord);
+	h.tickers    = boost::uint32_t(m_tickers);
+	h.capacity   = m_capacity;
+	h.table      = (sizeof(h) + QM_CACHE_LINE - 1)/QM_CACHE_LINE*QM_CACHE_LINE;
+	h.records    = h.table + (m_tickers*BLB_JOURNAL_KEY_SIZE + QM_CACHE_LINE - 1)/QM_CACHE_LINE*QM_CACHE_LINE;
+	h.size       = h.records + m_capacity*sizeof(blbjournalrecord);
+
+	std::string path = blbjournal_segment(m_prefix,n);
+#	ifndef	WIN32
+	int fd = ::open(path.c_str(),O_RDWR | O_CREAT | O_TRUNC,0644);
+	if(fd < 0)
+		return this->fail("Cannot create journal segment " + path + ": " + std::strerror(errno));
+	int err = posix_fallocate(fd,0,off_t(h.size));
+	::close(fd);
+	if(err)
+		return this->fail("Cannot allocate journal segment " + path + ": " + std::strerror(err));
+#	else
+	{
+		std::filebuf fbuf;
+		if(!fbuf.open(path.c_str(),std::ios_base::in | std::ios_base::out | std::ios_base::trunc | std::ios_base::binary))
+			return this->fail("Cannot create journal segment " + path);
+		fbuf.pubseekoff(h.size-1,std::ios_base::beg);
+		fbuf.sputc(0);
+	}
+#	endif	//	WIN32
+	try  {
+		ip::file_mapping file(path.c_str(),ip::read_write);
+		boost::shared_ptr<region_type> region(new region_type(file,ip::read_write));
+		m_region = region;
+	}
+	catch(std::exception& e)  {
+		return this->fail("Cannot map journal segment " + path + ": " + e.what());
+	}
+	m_region->advise(region_type::advice_sequential);
+	char* base = static_cast<char*>(m_region->get_address());
+	std::memcpy(base,&h,sizeof(h));
+	m_header  = reinterpret_cast<blbjournalheader*>(base);
+	m_table   = base + h.table;
+	m_records = reinterpret_cast<blbjournalrecord*>(base + h.records);
+	m_segment = n;
+	m_count   = 0;
+	for(boost::int32_t id=0;id<boost::int32_t(m_names.size());++id)
+		this->name(id);
+	return true;
+}
+
+inline void blbjournal::name(boost::int32_t id)  {
+	std::strncpy(m_table + id*BLB_JOURNAL_KEY_SIZE,m_names[id].c_str(),BLB_JOURNAL_KEY_SIZE - 1);
+	m_header->names = id + 1;
+}
+
+
+
+
+inline blbjournalreader::blbjournalreader(const std::string& prefix):m_size(0)  {
+	using namespace jflib;
+	namespace ip = boost::interprocess;
+	for(unsigned n=0;;++n)  {
+		std::string path = blbjournal_segment(prefix,n);
+		if(!std::ifstream(path.c_str())) break;
+		ip::file_mapping file(path.c_str(),ip::read_only);
+		segment s;
+		s.region.reset(new region_type(file,ip::read_only));
+		s.region->advise(region_type::advice_sequential);
+		const char* base = static_cast<const char*>(s.region->get_address());
+		QM_REQUIRE(s.region->get_size() >= sizeof(blbjournalheader),"Not a journal segment: " << path);
+		const blbjournalheader& h = *reinterpret_cast<const blbjournalheader*>(base);
+		QM_REQUIRE(std::memcmp(h.magic,blbjournal_magic,sizeof(blbjournal_magic)) == 0,"Not a journal segment: " << path);
+		QM_REQUIRE(h.version == blbjournal_version,"Unsupported journal version " << h.version);
+		QM_REQUIRE(h.endian == blbjournal_endian,"Journal written with a different byte order");
+		QM_REQUIRE(h.recordsize == sizeof(blbjournalrecord),"Journal has a different record size");
+		QM_REQUIRE(s.region->get_size() >= h.size,"Journal segment is truncated: " << path);
+		// Later segments repeat the tickers of the earlier ones
+		const char* table = base + h.table;
+		for(std::size_t id=m_feeds.size();id<h.names;++id)  {
+			std::string ticker(table + id*BLB_JOURNAL_KEY_SIZE);
+			m_feeds.push_back(FEED(new blbFeedBase(ticker,qm_long(id))));
+		}
+		s.records = reinterpret_cast<const blbjournalrecord*>(base + h.records);
+		s.count   = h.count;
+		m_size   += s.count;
+		m_segments.push_back(s);
+	}
+	QM_REQUIRE(m_segments.size(),"No journal segment " << blbjournal_segment(prefix,0));
+	m_data.resize(m_feeds.size());
+}
+
+inline const blbjournalrecord& blbjournalreader::at(size_type i) const  {
+	using namespace jflib;
+	for(std::vector<segment>::const_iterator it=m_segments.begin();it!=m_segments.end();++it)  {
+		if(i < it->count) return it->records[i];
+		i -= it->count;
+	}
+	QM_FAIL("Journal record out of range");
+}
+
+inline void blbjournalreader::set_tick_sink(BLBTICKPOOL pool, BLBTICKRING ring)  {
+	using namespace jflib;
+	QM_REQUIRE(!ring || pool,"A tick ring needs a tick pool");
+	m_tick_pool = pool;
+	m_tick_sink = ring;
+}
+
+
+//=================================================================
+//   Replay the records in order. Ticks are paced on their receive
+//   time and wait for the consumers rather than being dropped.
+//=================================================================
+inline blbjournalreader::size_type blbjournalreader::replay(double speed)  {
+	using namespace boost::posix_time;
+	size_type n = 0;
+	boost::int64_t first = 0;
+	ptime begin = microsec_clock::universal_time();
+	for(std::vector<segment>::const_iterator it=m_segments.begin();it!=m_segments.end();++it)
+		for(size_type i=0;i<it->count;++i,++n)  {
+			const blbjournalrecord& r = it->records[i];
+			if(n == 0)
+				first = r.time;
+			else if(speed > 0)  {
+				long due = long((r.time - first)/speed) - (microsec_clock::universal_time() - begin).total_microseconds();
+				if(due > 0)
+					boost::this_thread::sleep(microseconds(due));
+			}
+			this->publish(r);
+		}
+	return n;
+}
+
+inline void blbjournalreader::publish(const blbjournalrecord& r)  {
+	blbFeedBase& feed = *m_feeds[r.ticker];
+	livedata& ld = m_data[r.ticker];
+	switch(r.action)  {
+		case bTickTRADE:          ld.set_last(r.value);   break;
+		case bTickBID:            ld.set_bid(r.value);    break;
+		case bTickASK:            ld.set_ask(r.value);    break;
+		case bTickOPEN_INTEREST : ld.set_open(r.value);   break;
+		case bTickVOLUME        : ld.set_volume(r.value); break;
+	}
+	if(m_conflator)
+		m_conflator->update(feed,ld);
+	if(!m_tick_sink) return;
+	blbtick* t;
+	while(!(t = m_tick_pool->acquire()))
+		boost::this_thread::yield();
+	t->feed   = &feed;
+	t->value  = r.value;
+	t->mon_id = r.ticker;
+	t->readable = t->received = blbstats::now();
+	t->action = r.action;
+	t->size   = r.size;
+	t->time   = r.tick_time;
+	while(!m_tick_sink->push(t))
+		boost::this_thread::yield();
+}
+
@@ -27,14 +27,13 @@ blb<F,LR,HR,L>::responce()  {
 #ifdef WIN32
 	if(rcode == SOCKET_ERROR) QM_FAIL("Error from select.");
 #else
-    if(rcode == -1)
-		m_log->error("Bloomberg Loop: error from select.");
+    if(rcode == -1) QM_FAIL("Bloomberg Loop: error from select.");
 #endif
 
 	if(FD_ISSET((int)  bb_sock, &exec_set))
 		QM_FAIL("Exeption on Bloomberg socket.");
 	else  if(FD_ISSET((int) bb_sock, &read_set))
-		return this->Decode();
+		return this->Decode(m_stats ? blbstats::now() : 0);
 	
 	QM_FAIL("Unknown error in responce");
 }
@@ -44,24 +43,40 @@ blb<F,LR,HR,L>::responce()  {
 //
 //   receive data from a Bloomberg API connection.
 //   This routine should be called after select
-//   indicates there is data on the socket.
+//   indicates there is data on the socket, at
+//   readable on the clock of blbstats.
+//   Feeds updated by ticks are returned only without
+//   a tick sink, and nothing is allocated for messages
+//   which return no feed.
 //=================================================
 template<class F, class LR, class HR, class L>
 inline typename blb<F,LR,HR, L>::BLBFEEDR
-blb<F,LR,HR,L>::Decode()  {
+blb<F,LR,HR,L>::Decode(boost::int64_t readable)  {
 	void* in_use_buffer;
     int   size, code;
     
     bool  bDone = false;
 	BLBFEEDRD   retl;
+	unsigned	nretl = 0;
 	BLBLIVEFEED lf;
-	BLBHISTFEED hf;
+	hist_list   hl;
+	blbstats*	stats = m_stats.get();
+	if(stats)  {
+		if(!readable)
+			readable = blbstats::now();
+		stats->add(blbstats::WAKEUPS);
+	}
+	m_readable = readable;
+	m_received = 0;
+	// before new ticks are published, the consumer may have released every record
+	this->ReleaseStopped();
 
     while(!bDone)  {
 		size = bb_sizeof_nextmsg(m_connection->connection());
 
 		if(size < 0)  {
 			//m_log->warning("Error Receiving Data");
+			if(stats) stats->add(blbstats::ERRORS);
 			break;
 		}
 		else if(size == BB_SVC_INCOMPLETE) {
@@ -69,14 +84,18 @@ blb<F,LR,HR,L>::Decode()  {
 			break;
 		}
 
-		//  if the message is larger than our buffer, allocate a temporary buffer
-		m_buffer.Alloca(size);
+		//  the receive buffer only grows, doubling, so that steady state messages do not allocate
+		if(unsigned(size) > m_buffer.size())
+			m_buffer.Alloca(std::max(unsigned(size),2*m_buffer.size()));
 		in_use_buffer = m_buffer;
 
 		code = bb_rcvdata(m_connection->connection(), in_use_buffer, m_buffer.size());
+		if(stats)
+			m_received = blbstats::now();
 
 		if(code < 0)  {
 			//m_log->warning("Bloomberg API. Permission Problem.");
+			if(stats) stats->add(blbstats::ERRORS);
 			break;
 		}
 
@@ -93,8 +112,9 @@ blb<F,LR,HR,L>::Decode()  {
 
 			//________________________________________ HISTORY
 			case BB_SVC_MGETHISTORYX:  {
-				hf = DecodeHistory((bb_history_type*)in_use_buffer);
-				if(hf) retl.append(hf);
+				hl = DecodeHistory((bb_history_type*)in_use_buffer);
+				for(typename hist_list::const_iterator it=hl.begin();it!=hl.end();++it,++nretl)
+					retl.append(*it);
 				break;
 			}
 			//case BB_SVC_GETHISTORYX:  {
@@ -104,8 +124,9 @@ blb<F,LR,HR,L>::Decode()  {
 
 		    //________________________________________ STATIC DATA
 			case BB_SVC_GETDATAX:  {
-				hf = DecodeStaticData((bb_msg_fieldsx_t *)in_use_buffer);
-			    if(hf) retl.append(hf);
+				hl = DecodeStaticData((bb_msg_fieldsx_t *)in_use_buffer);
+				for(typename hist_list::const_iterator it=hl.begin();it!=hl.end();++it,++nretl)
+					retl.append(*it);
 				break;
 			}
 
@@ -113,7 +134,10 @@ blb<F,LR,HR,L>::Decode()  {
 			//________________________________________ GOT HEADER FOR LIVE RATE
 			case BB_SVC_GETHEADERX: {
 				lf = DecodeHeader((bb_header_type*)in_use_buffer);
-				if(lf) retl.append(lf);
+				if(lf)  {
+					retl.append(lf);
+					++nretl;
+				}
 				break;
 			}
 
@@ -127,8 +151,9 @@ blb<F,LR,HR,L>::Decode()  {
 			}
 
 			case BB_SVC_TICKDATA: {
-				LIVE_LIST ll = UpDateLiveData((bb_tick_type*)in_use_buffer);
-				for(typename live_list::const_iterator it=ll->begin();it!=ll->end();++it)
+				UpDateLiveData((bb_tick_type*)in_use_buffer);
+				if(m_tick_sink) break;
+				for(typename live_list::const_iterator it=m_updated.begin();it!=m_updated.end();++it,++nretl)
 					retl.append(*it);
 				break;
 			}
@@ -154,6 +179,10 @@ blb<F,LR,HR,L>::Decode()  {
 				break;
 			}
 	    }
+		if(stats)
+			stats->decoded(code,readable,m_received);
     }
-	return BLBFEEDR(new blbfeedr(retl));
+	// Replies free the window for the batches waiting
+	this->SendPending();
+	return nretl ? BLBFEEDR(new blbfeedr(retl)) : m_none;
 }
\ No newline at end of file
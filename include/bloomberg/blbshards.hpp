@@ -0,0 +1,225 @@
+
+
+
+/** \brief Round robin merge of single producer rings
+ * \ingroup bloomberg
+ *
+ * One consumer thread pops the values of all the rings, each ring is
+ * tried in turn starting after the ring of the previous value. Values of
+ * a ring keep their order.
+ */
+template<class T>
+class blbmerge : boost::noncopyable {
+public:
+	typedef jflib::threads::spscring<T>			ring_type;
+	typedef boost::shared_ptr<ring_type>		RING;
+	typedef std::size_t							size_type;
+
+	blbmerge():m_next(0){}
+
+	void		add(RING ring) {m_rings.push_back(ring);}
+	size_type	rings()	const {return m_rings.size();}
+	/// \brief Values waiting in the rings, exact only when called by the consumer
+	size_type	size()	const  {
+		size_type n = 0;
+		for(typename std::vector<RING>::const_iterator it=m_rings.begin();it!=m_rings.end();++it)
+			n += (*it)->size();
+		return n;
+	}
+	bool		empty()	const {return this->size() == 0;}
+
+	/// \brief The next value of the rings, return false if they are all empty
+	bool		pop(T& v)  {
+		size_type n = m_rings.size();
+		for(size_type k=0;k<n;++k)  {
+			size_type i = m_next;
+			m_next = i + 1 == n ? 0 : i + 1;
+			if(m_rings[i]->pop(v)) return true;
+		}
+		return false;
+	}
+private:
+	std::vector<RING>	m_rings;
+	size_type			m_next;
+};
+
+
+
+/** \brief Live subscriptions spread over several Bloomberg connections
+ * \ingroup bloomberg
+ *
+ * Each shard is a blb on its own connection, decoded by its own blbevent
+ * I/O thread. A ticker always goes to the shard of its hash, so that
+ * subscribe and unsubscribe reach the connection which monitors it and
+ * its ticks arrive in order.
+ *
+ * Consumers see one stream: each consumer added by add_consumer merges
+ * the results of all the shards, and the ticks of all the shards are
+ * merged into one tick stream read by pop and handed back by release.
+ * Requests are queued from any thread, each consumer and the tick stream
+ * are read by one thread.
+ */
+template<class B, class G = blbnoguard>
+class blbshards : boost::noncopyable {
+public:
+	typedef B										blb_type;
+	typedef G										guard_type;
+	typedef blbevent<B,G>							event_type;
+	typedef boost::shared_ptr<event_type>			EVENT;
+	typedef typename blb_type::BLB					BLB;
+	typedef typename blb_type::BLBFEEDR				BLBFEEDR;
+	typedef typename blb_type::fieldlisttype		fieldlisttype;
+	typedef blbmerge<BLBFEEDR>						consumer_type;
+	typedef boost::shared_ptr<consumer_type>		CONSUMER;
+	typedef std::size_t								size_type;
+
+	/// \brief shards connections to port
+	/// \param ticks	Tick records of each shard, no tick stream if 0
+	explicit blbshards(size_type shards, unsigned port = BLP_PORT, size_type ticks = 65536);
+	/// \brief A shard for each of blbs, which are connected
+	explicit blbshards(const std::vector<BLB>& blbs, size_type ticks = 65536);
+	~blbshards() {this->stop();}
+
+	size_type	size()					const {return m_shards.size();}
+	BLB			get_blb(size_type i)	const {return m_blbs[i];}
+	EVENT		event(size_type i)		const {return m_shards[i];}
+
+	/// \brief FNV-1a hash of ticker, the same on every run and platform
+	static boost::uint32_t	hash(const std::string& ticker);
+	/// \brief Shard of ticker
+	size_type	shard(const std::string& ticker) const {return hash(ticker) % m_shards.size();}
+
+	/// \brief Add a consumer of the results of all shards. Must be called before start
+	CONSUMER	add_consumer(size_type capacity = 4096);
+
+	void		start();
+	void		stop();
+	/// \brief True if every I/O thread is running
+	bool		running()	const;
+	/// \brief Results dropped because a consumer ring was full
+	size_type	dropped()	const;
+	/// \brief Last error of the I/O threads, empty if none
+	std::string	error()		const;
+
+	/// \brief Queue requests to the shard of ticker, return false if its request ring is full
+	bool		subscribe(const std::string& ticker)	{return m_shards[this->shard(ticker)]->live(ticker);}
+	bool		unsubscribe(const std::string& ticker)	{return m_shards[this->shard(ticker)]->stop_live(ticker);}
+	bool		history(const std::string& ticker, long startDate, long endDate, const fieldlisttype& fields)  {
+		return m_shards[this->shard(ticker)]->history(ticker,startDate,endDate,fields);
+	}
+	bool		data(const std::string& ticker, const fieldlisttype& fields)  {
+		return m_shards[this->shard(ticker)]->data(ticker,fields);
+	}
+
+	/// \brief The next tick of any shard, return false if none is waiting
+	bool		pop(blbtick*& t) {return m_ticks.pop(t);}
+	/// \brief Return a tick taken by pop to the pool of its shard, throw if no shard owns it
+	void		release(blbtick* t);
+private:
+	std::vector<BLB>			m_blbs;
+	std::vector<EVENT>			m_shards;
+	std::vector<BLBTICKPOOL>	m_pools;
+	blbmerge<blbtick*>			m_ticks;
+
+	void	init(size_type ticks);
+};
+
+
+
+template<class B, class G>
+inline blbshards<B,G>::blbshards(size_type shards, unsigned port, size_type ticks)  {
+	using namespace jflib;
+	QM_REQUIRE(shards > 0,"At least one shard is needed");
+	for(size_type i=0;i<shards;++i)  {
+		BLBCON con(new blbcon);
+		QM_REQUIRE(con->connect(port) == 0,"Could not connect shard " << i << " to port " << port);
+		m_blbs.push_back(blb_type::create(con));
+	}
+	this->init(ticks);
+}
+
+template<class B, class G>
+inline blbshards<B,G>::blbshards(const std::vector<BLB>& blbs, size_type ticks):m_blbs(blbs)  {
+	using namespace jflib;
+	QM_REQUIRE(m_blbs.size(),"At least one shard is needed");
+	this->init(ticks);
+}
+
+template<class B, class G>
+inline void blbshards<B,G>::init(size_type ticks)  {
+	for(typename std::vector<BLB>::const_iterator it=m_blbs.begin();it!=m_blbs.end();++it)  {
+		m_shards.push_back(EVENT(new event_type(*it)));
+		if(!ticks) continue;
+		BLBTICKPOOL pool(new blbtickpool(ticks));
+		BLBTICKRING ring(new blbtickring(ticks));
+		(*it)->set_tick_sink(pool,ring);
+		m_pools.push_back(pool);
+		m_ticks.add(ring);
+	}
+}
+
+template<class B, class G>
+inline boost::uint32_t blbshards<B,G>::hash(const std::string& ticker)  {
+	boost::uint32_t h = 2166136261u;
+	for(std::string::const_iterator it=ticker.begin();it!=ticker.end();++it)  {
+		h ^= static_cast<unsigned char>(*it);
+		h *= 16777619u;
+	}
+	return h;
+}
+
+template<class B, class G>
+inline typename blbshards<B,G>::CONSUMER
+blbshards<B,G>::add_consumer(size_type capacity)  {
+	CONSUMER c(new consumer_type);
+	for(typename std::vector<EVENT>::const_iterator it=m_shards.begin();it!=m_shards.end();++it)
+		c->add((*it)->add_consumer(capacity));
+	return c;
+}
+
+template<class B, class G>
+inline void blbshards<B,G>::start()  {
+	for(typename std::vector<EVENT>::const_iterator it=m_shards.begin();it!=m_shards.end();++it)
+		(*it)->start();
+}
+
+template<class B, class G>
+inline void blbshards<B,G>::stop()  {
+	for(typename std::vector<EVENT>::const_iterator it=m_shards.begin();it!=m_shards.end();++it)
+		(*it)->stop();
+}
+
+template<class B, class G>
+inline bool blbshards<B,G>::running() const  {
+	for(typename std::vector<EVENT>::const_iterator it=m_shards.begin();it!=m_shards.end();++it)
+		if(!(*it)->running()) return false;
+	return true;
+}
+
+template<class B, class G>
+inline typename blbshards<B,G>::size_type blbshards<B,G>::dropped() const  {
+	size_type n = 0;
+	for(typename std::vector<EVENT>::const_iterator it=m_shards.begin();it!=m_shards.end();++it)
+		n += (*it)->dropped();
+	return n;
+}
+
+template<class B, class G>
+inline std::string blbshards<B,G>::error() const  {
+	for(typename std::vector<EVENT>::const_iterator it=m_shards.begin();it!=m_shards.end();++it)  {
+		std::string e = (*it)->error();
+		if(!e.empty()) return e;
+	}
+	return std::string();
+}
+
+template<class B, class G>
+inline void blbshards<B,G>::release(blbtick* t)  {
+	using namespace jflib;
+	for(std::vector<BLBTICKPOOL>::const_iterator it=m_pools.begin();it!=m_pools.end();++it)
+		if((*it)->owns(t))  {
+			(*it)->release(t);
+			return;
+		}
+	QM_FAIL("The tick released is not a record of the shards");
+}
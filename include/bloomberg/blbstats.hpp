@@ -0,0 +1,97 @@
+
+
+
+/** \brief Latency histograms and message counters of a blb
+ * \ingroup bloomberg
+ *
+ * Stages are timed in nanoseconds on jflib::threads::latencyclock:
+ * - RECEIVE, socket readable to message read from the API, per message
+ * - DECODE, message read to message decoded, per message
+ * - HANDOFF, message read to tick taken by the consumer, per tick
+ * - TOTAL, socket readable to tick taken by the consumer, per tick
+ *
+ * The thread decoding the messages records the first two stages and the
+ * counters. The consumer of the tick sink records the last two by calling
+ * handoff for each tick it takes. Each histogram has a single writer and
+ * can be read from any thread. A blb without blbstats does not read the
+ * clock.
+ */
+class blbstats : boost::noncopyable {
+public:
+	typedef jflib::threads::latencyhistogram	histogram_type;
+	typedef boost::int64_t						time_type;
+
+	enum stage		{RECEIVE, DECODE, HANDOFF, TOTAL, STAGES};
+	enum counter	{WAKEUPS, MESSAGES, TICKMESSAGES, TICKS, HISTORY, STATIC, HEADERS, MONITORS, OTHER, ERRORS, COUNTERS};
+
+	blbstats() {this->reset();}
+
+	const histogram_type&	histogram(stage s)	const {return m_histograms[s];}
+	unsigned long			count(counter c)	const {return m_counters[c].load(boost::memory_order_relaxed);}
+
+	static const char*		name(stage s);
+	static const char*		name(counter c);
+
+	/// \brief Forget the latencies and counts, values recorded meanwhile may be lost
+	void					reset();
+
+	/// \brief Now on the clock of the stages
+	static time_type		now() {return jflib::threads::latencyclock::now();}
+
+	/// \brief Count n events. Called by the decoding thread
+	void	add(counter c, unsigned long n = 1)  {
+		m_counters[c].store(m_counters[c].load(boost::memory_order_relaxed) + n,boost::memory_order_relaxed);
+	}
+	/// \brief Count a message of service code, read at received and decoded now
+	void	decoded(int code, time_type readable, time_type received);
+	/// \brief Record the hand-off of a tick taken from the tick sink. Called by its consumer
+	void	handoff(const blbtick& t)  {
+		if(t.received)
+			this->handoff(t,now());
+	}
+	void	handoff(const blbtick& t, time_type taken)  {
+		m_histograms[HANDOFF].record(taken - t.received);
+		m_histograms[TOTAL].record(taken - t.readable);
+	}
+private:
+	histogram_type					m_histograms[STAGES];
+	boost::atomic<unsigned long>	m_counters[COUNTERS];
+};
+
+
+
+inline const char* blbstats::name(stage s)  {
+	static const char* names[STAGES] = {"receive","decode","handoff","total"};
+	return names[s];
+}
+
+inline const char* blbstats::name(counter c)  {
+	static const char* names[COUNTERS] = {"wakeups","messages","tick_messages","ticks","history",
+										  "static","headers","monitors","other","errors"};
+	return names[c];
+}
+
+inline void blbstats::reset()  {
+	for(int s=0;s<STAGES;++s)
+		m_histograms[s].reset();
+	for(int c=0;c<COUNTERS;++c)
+		m_counters[c].store(0,boost::memory_order_relaxed);
+}
+
+inline void blbstats::decoded(int code, time_type readable, time_type received)  {
+	m_histograms[RECEIVE].record(received - readable);
+	m_histograms[DECODE].record(now() - received);
+	this->add(MESSAGES);
+	switch(code)  {
+		case BB_SVC_TICKDATA:				this->add(TICKMESSAGES);	break;
+		case BB_SVC_MGETHISTORYX:			this->add(HISTORY);			break;
+		case BB_SVC_GETDATAX:				this->add(STATIC);			break;
+		case BB_SVC_GETHEADERX:				this->add(HEADERS);			break;
+		case BB_SVC_TICKMONITOR:
+		case BB_SVC_TICKMONITORX:
+		case BB_SVC_TICKMONITOR_TYPED:
+		case BB_SVC_TICKMONITOR_TYPEDX:
+		case BB_SVC_TICKMONITOR_ENHANCED:	this->add(MONITORS);		break;
+		default:							this->add(OTHER);			break;
+	}
+}
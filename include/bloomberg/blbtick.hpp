@@ -0,0 +1,71 @@
+
+
+
+/** \brief A decoded tick, the size of a cache line
+ * \ingroup bloomberg
+ *
+ * feed is valid as long as the live feed is monitored by the blb which
+ * decoded the tick. readable and received are on the clock of blbstats,
+ * 0 if the blb has no blbstats.
+ */
+struct blbtick  {
+	blbFeedBase*	feed;
+	qm_real			value;
+	long			mon_id;
+	/// \brief When the socket was readable
+	boost::int64_t	readable;
+	/// \brief When the message of the tick was read from the API
+	boost::int64_t	received;
+	int				action;
+	int				size;
+	int				time;
+private:
+	char			m_pad[QM_CACHE_LINE - sizeof(blbFeedBase*) - sizeof(qm_real) - sizeof(long) - 2*sizeof(boost::int64_t) - 3*sizeof(int)];
+};
+
+
+/** \brief Preallocated pool of tick records
+ * \ingroup bloomberg
+ *
+ * Records are cache line aligned and allocated once. The decoding thread
+ * acquires records and consumers release them from any thread, the free
+ * list is a multiple producers ring so neither side takes a lock or
+ * allocates.
+ */
+class blbtickpool : boost::noncopyable {
+public:
+	typedef std::size_t		size_type;
+
+	explicit blbtickpool(size_type capacity = 65536);
+	~blbtickpool() {delete [] m_memory;}
+
+	size_type	capacity() const {return m_capacity;}
+	/// \brief Free records, capacity once consumers have released every record. Called by the decoding thread only
+	size_type	available() const {return m_free.size();}
+
+	/// \brief A free record, 0 if all records are in use. Called by the decoding thread only
+	blbtick*	acquire()  {
+		blbtick* t = 0;
+		m_free.pop(t);
+		return t;
+	}
+	/// \brief Return a record to the pool, from any thread
+	void		release(blbtick* t)  {m_free.push(t);}
+	/// \brief True if t is a record of the pool
+	bool		owns(const blbtick* t) const {return t >= m_ticks && t < m_ticks + m_capacity;}
+private:
+	char*								m_memory;
+	blbtick*							m_ticks;
+	size_type							m_capacity;
+	jflib::threads::mpscring<blbtick*>	m_free;
+};
+
+
+inline blbtickpool::blbtickpool(size_type capacity):m_memory(new char[capacity*sizeof(blbtick) + QM_CACHE_LINE]),
+													m_capacity(capacity),m_free(capacity)  {
+	std::size_t offset = QM_CACHE_LINE - reinterpret_cast<std::size_t>(m_memory) % QM_CACHE_LINE;
+	m_ticks = reinterpret_cast<blbtick*>(m_memory + offset);
+	for(size_type i=0;i<m_capacity;++i)
+		m_free.push(m_ticks + i);
+}
+
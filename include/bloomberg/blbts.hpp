@@ -0,0 +1,216 @@
+//
+/// \file
+/// \brief Decode Bloomberg history into jflib timeseries
+/// \ingroup bloomberg
+///
+/// A blb whose history data type is a dated jflib timeseries decodes each
+/// history reply directly into it, without the generic holder:
+///
+/// \code
+/// typedef jflib::timeseries::traits::ts<jflib::qdate,double,jflib::timeseries::tsstore>::type	tstype;
+/// typedef bloomberg::blb<flist,bloomberg::LIVEDATA,tstype,int>						blbts;
+/// \endcode
+///
+/// A matrix timeseries (family 1) gets one series per field, a single
+/// series timeseries the values of the only field. Static data need a blb
+/// with a generic holder: static data requests are refused, and history
+/// requests of more than one field for a single series timeseries.
+///
+
+
+#ifndef   __BLOOMBERG_TS_QM_HPP__
+#define   __BLOOMBERG_TS_QM_HPP__
+
+#include <blb.hpp>
+#include <jflib/datetime/date.hpp>
+#include <jflib/timeseries/timeseries_map.hpp>
+#include <jflib/timeseries/timeseries_matrix.hpp>
+
+#include <limits>
+#include <algorithm>
+
+
+namespace bloomberg {
+
+
+/** \brief Dates of history points, converted in bulk
+ * \ingroup bloomberg
+ *
+ * Points are dated YYYYMMDD. Consecutive points mostly fall in the same
+ * month, the days from 1970-01-01 to the start of the month are computed
+ * once per month.
+ */
+class blbdates  {
+public:
+	blbdates():m_month(-1),m_days(0){}
+
+	/// \brief Days since 1970-01-01 of a YYYYMMDD date
+	long unixdays(long yyyymmdd)  {
+		long month = yyyymmdd/100;
+		if(month != m_month)  {
+			m_month = month;
+			m_days  = civil(int(month/100),int(month % 100),1);
+		}
+		return m_days + yyyymmdd % 100 - 1;
+	}
+
+	/// \brief Append the dates of n points to out
+	void convert(const bb_decode_history_t* points, std::size_t n, std::vector<jflib::qdate>& out)  {
+		out.reserve(out.size() + n);
+		for(std::size_t i=0;i<n;++i)
+			out.push_back(jflib::qdate::fromunixdays(this->unixdays(points[i].date)));
+	}
+
+	/// \brief Days since 1970-01-01 of a valid date (H. Hinnant, days_from_civil)
+	static long civil(int y, int m, int d)  {
+		y -= m <= 2;
+		long era = (y >= 0 ? y : y - 399)/400;
+		long yoe = y - era*400;
+		long doy = (153*(m + (m > 2 ? -3 : 9)) + 2)/5 + d - 1;
+		long doe = yoe*365 + yoe/4 - yoe/100 + doy;
+		return era*146097 + doe - 719468;
+	}
+private:
+	long	m_month;
+	long	m_days;
+};
+
+
+namespace {
+
+	inline double blbvalue(double v)  {
+		return v == BB_VAL_MISSING ? std::numeric_limits<double>::quiet_NaN() : v;
+	}
+
+	/// \brief True if every field has the dates of the first
+	inline bool blbaligned(const int4* counts, long numFields, const bb_decode_history_t* points)  {
+		long N = counts[0];
+		const bb_decode_history_t* p = points + N;
+		for(long f=1;f<numFields;++f)  {
+			if(counts[f] != N) return false;
+			for(long i=0;i<N;++i,++p)
+				if(p->date != points[i].date) return false;
+		}
+		return true;
+	}
+
+}
+
+
+/** \brief History decoded into a matrix timeseries, one series per field
+ * \ingroup bloomberg
+ *
+ * The matrix is allocated once at the size of the reply and filled
+ * column by column. Rows are the dates of the first field if all fields
+ * have the same dates, the union of the dates otherwise. Missing points
+ * are masked.
+ */
+template<class T, class Tag>
+struct blbhistory< jflib::timeseries::timeseries<jflib::qdate,T,Tag,1u,true> >  {
+	typedef jflib::timeseries::timeseries<jflib::qdate,T,Tag,1u,true>	tstype;
+	typedef typename tstype::matrix_type								matrix_type;
+	typedef typename tstype::matrix_type_ptr							matrix_type_ptr;
+	typedef typename tstype::index_type									index_type;
+	typedef typename tstype::range										range;
+
+	static const bool	static_data = false;
+	static bool			accepts(long) {return true;}
+
+	template<class FEED>
+	static const bb_decode_history_t* fill(FEED& qp, const int4* counts, long numFields,
+										   const bb_decode_history_t* points)  {
+		blbdates dates;
+		std::vector<jflib::qdate> keys;
+		std::vector<long> rows;
+		bool aligned = numFields == 0 || blbaligned(counts,numFields,points);
+		if(aligned)
+			dates.convert(points,numFields ? counts[0] : 0,keys);
+		else  {
+			const bb_decode_history_t* p = points;
+			for(long f=0;f<numFields;p+=counts[f],++f)
+				for(long i=0;i<counts[f];++i)
+					rows.push_back(p[i].date);
+			std::sort(rows.begin(),rows.end());
+			rows.erase(std::unique(rows.begin(),rows.end()),rows.end());
+			keys.reserve(rows.size());
+			for(std::vector<long>::const_iterator it=rows.begin();it!=rows.end();++it)
+				keys.push_back(jflib::qdate::fromunixdays(dates.unixdays(*it)));
+		}
+
+		std::size_t N = keys.size();
+		std::size_t S = numFields;
+		matrix_type_ptr data(new matrix_type);
+		data->data.resize(N,S,false);
+		data->mask.resize(N,S,false);
+		for(std::size_t c=0;c<S;++c)  {
+			std::size_t n = counts[c];
+			if(aligned)
+				for(std::size_t r=0;r<N;++r)  {
+					double v = blbvalue(points[r].value);
+					data->data(r,c) = v;
+					data->mask(r,c) = v == v ? 1 : 0;
+				}
+			else  {
+				// Both the points and the rows are sorted by date
+				std::size_t i = 0;
+				for(std::size_t r=0;r<N;++r)  {
+					double v = std::numeric_limits<double>::quiet_NaN();
+					if(i < n && points[i].date == rows[r])
+						v = blbvalue(points[i++].value);
+					data->data(r,c) = v;
+					data->mask(r,c) = v == v ? 1 : 0;
+				}
+			}
+			points += n;
+		}
+
+		index_type index(data,range(0,S));
+		index.reserve(N);
+		for(std::size_t r=0;r<N;++r)
+			index.push_back(keys[r]);
+		qp.set_data(tstype(qp.ticker(),data,index));
+		return points;
+	}
+};
+
+
+/** \brief History of a single field decoded into a single series timeseries
+ * \ingroup bloomberg
+ *
+ * Missing points are not inserted. Replies of more than one field are
+ * dropped by the blb.
+ */
+template<class T, class Tag>
+struct blbhistory< jflib::timeseries::timeseries<jflib::qdate,T,Tag,0u,false> >  {
+	typedef jflib::timeseries::timeseries<jflib::qdate,T,Tag,0u,false>	tstype;
+
+	static const bool	static_data = false;
+	static bool			accepts(long numFields) {return numFields == 1;}
+
+	template<class FEED>
+	static const bb_decode_history_t* fill(FEED& qp, const int4* counts, long,
+										   const bb_decode_history_t* points)  {
+		using namespace jflib;
+		blbdates dates;
+		std::vector<qdate> keys;
+		std::vector<T>     values;
+		std::size_t n = counts[0];
+		keys.reserve(n);
+		values.reserve(n);
+		for(std::size_t i=0;i<n;++i)
+			if(points[i].value != BB_VAL_MISSING)  {
+				keys.push_back(qdate::fromunixdays(dates.unixdays(points[i].date)));
+				values.push_back(points[i].value);
+			}
+		tstype ts(qp.ticker());
+		ts.load(keys.begin(),keys.end(),values.begin());
+		qp.set_data(ts);
+		return points + n;
+	}
+};
+
+
+}
+
+
+#endif	//	__BLOOMBERG_TS_QM_HPP__
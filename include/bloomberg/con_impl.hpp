@@ -6,8 +6,11 @@ inline qm_real livedata::get_mid() const  {
 }
 
 inline void blbcon::SecurityConnection()  {
+// bb_identify is not available on linux
+#ifndef BB_PLATFORM_LINUX_INTEL
     Display* disp = 0;
     bb_identify(disp,m_id);
+#endif
     bb_setuser(m_connection,m_id);
 }
 
@@ -13,6 +13,7 @@
 #define __BOOSTDATE_JFLIB_HPP__
 
 #include <jflib/datetime/juldate.hpp>
+#include <jflib/textwriter.hpp>
 #include <boost/date_time/gregorian/gregorian.hpp>
 #include <boost/date_time/posix_time/ptime.hpp>
 
@@ -36,6 +37,11 @@ public:
 	//Unrelated but handy function to calculate Unix timestamp from GMT
 	boost::int64_t  timegm()		  const;
 
+	/// \brief Date from the number of days since 1970-01-01 (numpy datetime64[D])
+	static qdate fromunixdays(long days) {return qdate(date_type(calendar_type::from_day_number(days + unix_epoch)));}
+	/// \brief Number of days since 1970-01-01
+	long unixdays() const {return m_date.day_number() - unix_epoch;}
+
 	qdate& operator = (qdate const& other) {m_date = other.m_date; return *this;}
 	qdate& operator = (date_type const& other) {m_date = other; return *this;}
 
@@ -70,15 +76,20 @@ public:
 	}
 protected:
 	date_type	m_date;
+	static const long unix_epoch = 2440588;
 };
 
 inline boost::int64_t qdate::timegm() const {
-	return 86400*(m_date.day_number() - 2440588);
+	return 86400*boost::int64_t(this->unixdays());
 }
 
 
 REGISTER2STRING(qdate);
 
+template<> struct textformat<qdate>  {
+	static void put(textwriter& w, const qdate& d) {w.putint(d.toyyyymmdd());}
+};
+
 
 
 }
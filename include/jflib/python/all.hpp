@@ -9,6 +9,7 @@ namespace jflib { namespace python {
 	void timeseries_wrap();
 	void tools_wrap();
 	void taplefunction_wrap();
+	void threads_wrap();
 
 }}
 
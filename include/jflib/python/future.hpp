@@ -0,0 +1,237 @@
+//
+/// \file
+/// \brief Python futures for computations running on the jflib thread pool
+//
+#ifndef   __PYTHON_FUTURE_JFLIB_HPP__
+#define   __PYTHON_FUTURE_JFLIB_HPP__
+
+#include <jflib/python/gil.hpp>
+#include <jflib/threads/threadpool.hpp>
+
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/thread/thread_time.hpp>
+
+
+namespace jflib { namespace python {
+
+
+/**
+ * \brief Result of a computation running on the jflib thread pool
+ *
+ * The computation runs without the GIL and its C++ result is converted
+ * into a python object by result(), in the calling thread.
+ * Callbacks added with add_done_callback are called with the future from
+ * the worker thread, as in concurrent.futures. asyncio code can use them
+ * with loop.call_soon_threadsafe to resolve an asyncio future.
+ */
+class pyfuture {
+	typedef boost::function<boost::python::object ()>	value_type;
+
+	struct state: boost::noncopyable {
+		state():done(false){}
+		boost::mutex						mutex;
+		boost::condition_variable			ready;
+		bool								done;
+		value_type							value;
+		std::string							error;
+		std::vector<boost::python::object>	callbacks;
+	};
+	typedef boost::shared_ptr<state>	state_ptr;
+public:
+	pyfuture():m_state(new state){}
+
+	bool done() const {
+		boost::mutex::scoped_lock lock(m_state->mutex);
+		return m_state->done;
+	}
+
+	/// \brief Wait for the result for timeout seconds, forever if timeout is negative
+	bool wait(double timeout) const {
+		release_gil g;
+		boost::mutex::scoped_lock lock(m_state->mutex);
+		if(timeout < 0) {
+			while(!m_state->done)
+				m_state->ready.wait(lock);
+			return true;
+		}
+		boost::system_time deadline = boost::get_system_time() +
+				boost::posix_time::microseconds(static_cast<long>(1000000*timeout));
+		while(!m_state->done)
+			if(!m_state->ready.timed_wait(lock,deadline))
+				return m_state->done;
+		return true;
+	}
+
+	boost::python::object result(double timeout) const {
+		QM_REQUIRE(this->wait(timeout),"Timed out waiting for the result");
+		if(!m_state->value)
+			throw std::runtime_error(m_state->error);
+		return m_state->value();
+	}
+
+	void add_done_callback(const boost::python::object& fn) const {
+		{
+			boost::mutex::scoped_lock lock(m_state->mutex);
+			if(!m_state->done) {
+				m_state->callbacks.push_back(fn);
+				return;
+			}
+		}
+		fn(*this);
+	}
+
+	/// \brief Set the result. Called by the worker thread without the GIL
+	template<class R>
+	void set_result(const R& r) const {this->finish(boost::bind(&pyfuture::topython<R>,r),std::string());}
+
+	/// \brief Set the error. Called by the worker thread without the GIL
+	void set_error(const std::string& error) const {this->finish(value_type(),error);}
+private:
+	state_ptr	m_state;
+
+	template<class R>
+	static boost::python::object topython(const R& r) {return boost::python::object(r);}
+
+	void finish(const value_type& value, const std::string& error) const {
+		std::vector<boost::python::object> callbacks;
+		{
+			boost::mutex::scoped_lock lock(m_state->mutex);
+			m_state->value = value;
+			m_state->error = error;
+			m_state->done  = true;
+			callbacks.swap(m_state->callbacks);
+		}
+		m_state->ready.notify_all();
+		if(callbacks.empty())
+			return;
+		acquire_gil g;
+		for(std::size_t i=0;i<callbacks.size();++i) {
+			try {
+				callbacks[i](*this);
+			}
+			catch(boost::python::error_already_set&) {
+				PyErr_Print();
+			}
+		}
+		callbacks.clear();
+	}
+};
+
+
+namespace {
+
+	/// \brief Run f on a worker and set its result or error on the future
+	template<class R, class F>
+	struct async_task {
+		async_task(const pyfuture& fu, const F& fn):future(fu),f(fn){}
+		void operator () () const {
+			try {
+				R r = f();
+				future.set_result(r);
+			}
+			catch(std::exception& e) {
+				future.set_error(e.what());
+			}
+			catch(...) {
+				future.set_error("Unknown error");
+			}
+		}
+		pyfuture	future;
+		F			f;
+	};
+
+	template<class R, class F>
+	pyfuture async_submit(const F& f) {
+		pyfuture future;
+		threads::threadpool::global()->submit(async_task<R,F>(future,f));
+		return future;
+	}
+
+	/**
+	 * \brief Submit a copy of the object and of the arguments to the
+	 * thread pool and return a future
+	 */
+	template<class F> struct async_call;
+
+	template<class R, class C>
+	struct async_call<R (C::*)() const> {
+		typedef R (C::*function_type)() const;
+		typedef boost::mpl::vector2<pyfuture,const C&>				signature;
+		async_call(function_type f):m_f(f){}
+		pyfuture operator () (const C& c) const {return async_submit<R>(boost::bind(m_f,c));}
+	private:
+		function_type	m_f;
+	};
+
+	template<class R, class C, class A1>
+	struct async_call<R (C::*)(A1) const> {
+		typedef R (C::*function_type)(A1) const;
+		typedef boost::mpl::vector3<pyfuture,const C&,A1>			signature;
+		async_call(function_type f):m_f(f){}
+		pyfuture operator () (const C& c, A1 a1) const {return async_submit<R>(boost::bind(m_f,c,a1));}
+	private:
+		function_type	m_f;
+	};
+
+	template<class R, class C, class A1, class A2>
+	struct async_call<R (C::*)(A1,A2) const> {
+		typedef R (C::*function_type)(A1,A2) const;
+		typedef boost::mpl::vector4<pyfuture,const C&,A1,A2>		signature;
+		async_call(function_type f):m_f(f){}
+		pyfuture operator () (const C& c, A1 a1, A2 a2) const {return async_submit<R>(boost::bind(m_f,c,a1,a2));}
+	private:
+		function_type	m_f;
+	};
+
+}
+
+
+/**
+ * \brief def visitor registering the asynchronous version of a const
+ * member function, if Enable is true
+ *
+ * The python method returns a future. The object and the arguments are
+ * copied, the object must not be modified until the future is done.
+ *
+ * \code
+ * .def("vol_async", async_if<true>(&econtype::vol), "Volatility")
+ * \endcode
+ */
+template<class F, bool Enable = true>
+class async_def: public boost::python::def_visitor<async_def<F,Enable> > {
+public:
+	async_def(F f):m_f(f){}
+private:
+	friend class boost::python::def_visitor_access;
+	typedef async_call<F>		call_type;
+
+	F	m_f;
+
+	template<class Class, class Options>
+	void visit(Class& cl, const char* name, const Options& options) const {
+		this->add(cl,name,options,boost::mpl::bool_<Enable>());
+	}
+
+	template<class Class, class Options>
+	void add(Class& cl, const char* name, const Options& options, boost::mpl::true_) const {
+		boost::python::objects::add_to_namespace(cl,name,
+				boost::python::make_function(call_type(m_f),options.policies(),options.keywords(),
+											 typename call_type::signature()),
+				options.doc());
+	}
+
+	template<class Class, class Options>
+	void add(Class& cl, const char* name, const Options& options, boost::mpl::false_) const {}
+};
+
+
+/// \brief Asynchronous version of f, registered only if Enable is true (see async_def)
+template<bool Enable, class F>
+async_def<F,Enable> async_if(F f) {return async_def<F,Enable>(f);}
+
+
+}}
+
+
+#endif	//	__PYTHON_FUTURE_JFLIB_HPP__
@@ -0,0 +1,168 @@
+//
+/// \file
+/// \brief Release and acquire the python global interpreter lock
+//
+#ifndef   __PYTHON_GIL_JFLIB_HPP__
+#define   __PYTHON_GIL_JFLIB_HPP__
+
+#include <jflib/python/pyconfig.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/mpl/bool.hpp>
+#include <boost/mpl/vector.hpp>
+#include <boost/python/def_visitor.hpp>
+#include <boost/python/make_function.hpp>
+#include <boost/python/object/add_to_namespace.hpp>
+
+
+namespace jflib { namespace python {
+
+
+/**
+ * \brief Release the GIL for the lifetime of the object
+ *
+ * No python object can be used while the GIL is released.
+ */
+class release_gil: boost::noncopyable {
+public:
+	release_gil():m_state(PyEval_SaveThread()){}
+	~release_gil() {PyEval_RestoreThread(m_state);}
+private:
+	PyThreadState*	m_state;
+};
+
+
+/**
+ * \brief Acquire the GIL for the lifetime of the object, from any thread
+ */
+class acquire_gil: boost::noncopyable {
+public:
+	acquire_gil():m_state(PyGILState_Ensure()){}
+	~acquire_gil() {PyGILState_Release(m_state);}
+private:
+	PyGILState_STATE	m_state;
+};
+
+
+/**
+ * \brief True if values of type T can be created, copied and destroyed
+ * without the GIL. Specialised to false for types holding python objects.
+ */
+template<class T>
+struct gilfree_type: boost::mpl::true_ {};
+
+template<>
+struct gilfree_type<boost::python::object>: boost::mpl::false_ {};
+
+
+namespace {
+
+	/**
+	 * \brief Call a C++ function with the GIL released
+	 *
+	 * Arguments are converted and results are converted back to python
+	 * by boost python while the GIL is held.
+	 */
+	template<class F> struct gilfree_call;
+
+	template<class R, class C>
+	struct gilfree_call<R (C::*)() const> {
+		typedef R (C::*function_type)() const;
+		typedef boost::mpl::vector2<R,const C&>				signature;
+		gilfree_call(function_type f):m_f(f){}
+		R operator () (const C& c) const {release_gil g; return (c.*m_f)();}
+	private:
+		function_type	m_f;
+	};
+
+	template<class R, class C, class A1>
+	struct gilfree_call<R (C::*)(A1) const> {
+		typedef R (C::*function_type)(A1) const;
+		typedef boost::mpl::vector3<R,const C&,A1>			signature;
+		gilfree_call(function_type f):m_f(f){}
+		R operator () (const C& c, A1 a1) const {release_gil g; return (c.*m_f)(a1);}
+	private:
+		function_type	m_f;
+	};
+
+	template<class R, class C, class A1, class A2>
+	struct gilfree_call<R (C::*)(A1,A2) const> {
+		typedef R (C::*function_type)(A1,A2) const;
+		typedef boost::mpl::vector4<R,const C&,A1,A2>		signature;
+		gilfree_call(function_type f):m_f(f){}
+		R operator () (const C& c, A1 a1, A2 a2) const {release_gil g; return (c.*m_f)(a1,a2);}
+	private:
+		function_type	m_f;
+	};
+
+	template<class R, class C, class A1, class A2>
+	struct gilfree_call<R (C::*)(A1,A2)> {
+		typedef R (C::*function_type)(A1,A2);
+		typedef boost::mpl::vector4<R,C&,A1,A2>				signature;
+		gilfree_call(function_type f):m_f(f){}
+		R operator () (C& c, A1 a1, A2 a2) const {release_gil g; return (c.*m_f)(a1,a2);}
+	private:
+		function_type	m_f;
+	};
+
+	template<class R, class A1, class A2>
+	struct gilfree_call<R (*)(A1,A2)> {
+		typedef R (*function_type)(A1,A2);
+		typedef boost::mpl::vector3<R,A1,A2>				signature;
+		gilfree_call(function_type f):m_f(f){}
+		R operator () (A1 a1, A2 a2) const {release_gil g; return m_f(a1,a2);}
+	private:
+		function_type	m_f;
+	};
+
+}
+
+
+/**
+ * \brief def visitor registering a function which releases the GIL
+ * while it runs, if Release is true
+ *
+ * \code
+ * .def("vol", gilfree(&econtype::vol), "Volatility")
+ * \endcode
+ */
+template<class F, bool Release = true>
+class gilfree_def: public boost::python::def_visitor<gilfree_def<F,Release> > {
+public:
+	gilfree_def(F f):m_f(f){}
+private:
+	friend class boost::python::def_visitor_access;
+	typedef gilfree_call<F>		call_type;
+
+	F	m_f;
+
+	template<class Class, class Options>
+	void visit(Class& cl, const char* name, const Options& options) const {
+		boost::python::objects::add_to_namespace(cl,name,
+				this->make(options,boost::mpl::bool_<Release>()),options.doc());
+	}
+
+	template<class Options>
+	boost::python::object make(const Options& options, boost::mpl::true_) const {
+		return boost::python::make_function(call_type(m_f),options.policies(),options.keywords(),
+											typename call_type::signature());
+	}
+
+	template<class Options>
+	boost::python::object make(const Options& options, boost::mpl::false_) const {
+		return boost::python::make_function(m_f,options.policies(),options.keywords());
+	}
+};
+
+
+template<class F>
+gilfree_def<F> gilfree(F f) {return gilfree_def<F>(f);}
+
+/// \brief Release the GIL only if Release is true (see gilfree)
+template<bool Release, class F>
+gilfree_def<F,Release> gilfree_if(F f) {return gilfree_def<F,Release>(f);}
+
+
+}}
+
+
+#endif	//	__PYTHON_GIL_JFLIB_HPP__
@@ -52,6 +52,10 @@ inline NPY_TYPES get_typenum(npy_uint)   { return NPY_UINT; }
 inline NPY_TYPES get_typenum(npy_long)   { return NPY_LONG; }
 inline NPY_TYPES get_typenum(npy_ulong)  { return NPY_ULONG; }
 //inline NPY_TYPES get_typenum(npy_longlong) { return NPY_LONGLONG; }
+#if NPY_BITSOF_LONG < 64
+// npy_int64 where long has 32 bits
+inline NPY_TYPES get_typenum(npy_longlong) { return NPY_LONGLONG; }
+#endif
 inline NPY_TYPES get_typenum(npy_ulonglong) { return NPY_ULONGLONG; }
 inline NPY_TYPES get_typenum(npy_float) { return NPY_FLOAT; }
 inline NPY_TYPES get_typenum(npy_double) { return NPY_DOUBLE; }
@@ -6,6 +6,7 @@
 
 #include <jflib/python/pyconfig.hpp>
 #include <jflib/python/timeseries/traits.hpp>
+#include <jflib/python/future.hpp>
 
 
 namespace jflib { namespace python {
@@ -19,32 +20,51 @@ struct pyeconometric {
 	typedef jflib::timeseries::econometric::analysis<tstype,vtag,matrix_type>	econtype;
 	typedef boost::python::class_<tstype>										tsptype;
 
+	/// \brief Release the GIL during calculations
+	static const bool nogil = gilfree_type<econtype>::value;
+
 	static void reg(const std::string& name, tsptype& tsp) {
 		namespace py   = boost::python;
 
 		std::string econame = name + "_econometric";
 
-		py::class_<econtype>(econame.c_str(),"econometric analysis handle",py::init<const tstype&>())
+		py::class_<econtype> eco(econame.c_str(),"econometric analysis handle",py::init<const tstype&>());
+		eco
 			.def(py::init<const econtype&>())
 			.add_property("size",	&econtype::size)
-			.def("delta",			&econtype::delta,"First order differentiation")
-			.def("logdelta",		&econtype::logdelta,"First order log-differentiation")
-			.def("sdelta",			&econtype::sdelta,"First order differentiation divided by the squared-root of delta-time")
-			.def("slogdelta",		&econtype::slogdelta,"First order log-differentiation divided by the squared-root of delta-time")
-			.def("vol",				&econtype::vol,"Standard deviation (volatility) of timeseries")
-			.def("roll_vol",		&econtype::roll_vol,py::arg("window"),"Rolling standard deviation (volatility) of timeseries")
+			.def("delta",			gilfree_if<nogil>(&econtype::delta),"First order differentiation")
+			.def("logdelta",		gilfree_if<nogil>(&econtype::logdelta),"First order log-differentiation")
+			.def("sdelta",			gilfree_if<nogil>(&econtype::sdelta),"First order differentiation divided by the squared-root of delta-time")
+			.def("slogdelta",		gilfree_if<nogil>(&econtype::slogdelta),"First order log-differentiation divided by the squared-root of delta-time")
+			.def("vol",				gilfree_if<nogil>(&econtype::vol),"Standard deviation (volatility) of timeseries")
+			.def("roll_vol",		gilfree_if<nogil>(&econtype::roll_vol),py::arg("window"),"Rolling standard deviation (volatility) of timeseries")
 			//.def("sharpe",			&econtype::sharpe,"Sharpe ratio of timeseries")
 			//.def("roll_sharpe",		&econtype::roll_sharpe,py::arg("window"),"Rolling sharpe ratio of timeseries")
-			.def("ar",				&econtype::ar,py::arg("order"),"Auto-regression coefficient")
-			.def("roll_ar",			&econtype::roll_ar,py::args("window","order"),"Rolling auto-regression coefficient")
+			.def("ar",				gilfree_if<nogil>(&econtype::ar),py::arg("order"),"Auto-regression coefficient")
+			.def("roll_ar",			gilfree_if<nogil>(&econtype::roll_ar),py::args("window","order"),"Rolling auto-regression coefficient")
 			.def("mdd",				&econtype::mdd,"The maximum drawdown as percentage of pick value")
 			.def("var",				&econtype::var,py::arg("order"),"Vector auto-regression for multivariate or auto-regression for univariate timeseries")
-			.def("covar",			&econtype::covar,"Covariance matrix evaluation")
-			.def("roll_covar",		&econtype::roll_covar,py::arg("window"),"Rolling covariance matrix evaluation")
-			.def("correl",			&econtype::correl,"Correlation matrix evaluation")
-			.def("roll_correl",		&econtype::roll_correl,py::arg("window"),"Rolling correlation matrix evaluation")
+			.def("covar",			gilfree_if<nogil>(&econtype::covar),"Covariance matrix evaluation")
+			.def("roll_covar",		gilfree_if<nogil>(&econtype::roll_covar),py::arg("window"),"Rolling covariance matrix evaluation")
+			.def("correl",			gilfree_if<nogil>(&econtype::correl),"Correlation matrix evaluation")
+			.def("roll_correl",		gilfree_if<nogil>(&econtype::roll_correl),py::arg("window"),"Rolling correlation matrix evaluation")
 			//.def("coint",			&econtype::coint,py::arg("order"),"Cointegration using Johansen methodology")
-			.def("ols",				&econtype::ols,"Ordinary Least Squares")
+			.def("ols",				gilfree_if<nogil>(&econtype::ols),"Ordinary Least Squares")
+			;
+
+		// Asynchronous versions returning a future, for timeseries which do not hold python objects
+		eco
+			.def("delta_async",			async_if<nogil>(&econtype::delta),"First order differentiation on the thread pool")
+			.def("logdelta_async",		async_if<nogil>(&econtype::logdelta),"First order log-differentiation on the thread pool")
+			.def("vol_async",			async_if<nogil>(&econtype::vol),"Volatility on the thread pool")
+			.def("roll_vol_async",		async_if<nogil>(&econtype::roll_vol),py::arg("window"),"Rolling volatility on the thread pool")
+			.def("ar_async",			async_if<nogil>(&econtype::ar),py::arg("order"),"Auto-regression coefficient on the thread pool")
+			.def("roll_ar_async",		async_if<nogil>(&econtype::roll_ar),py::args("window","order"),"Rolling auto-regression coefficient on the thread pool")
+			.def("covar_async",			async_if<nogil>(&econtype::covar),"Covariance matrix on the thread pool")
+			.def("roll_covar_async",	async_if<nogil>(&econtype::roll_covar),py::arg("window"),"Rolling covariance matrix on the thread pool")
+			.def("correl_async",		async_if<nogil>(&econtype::correl),"Correlation matrix on the thread pool")
+			.def("roll_correl_async",	async_if<nogil>(&econtype::roll_correl),py::arg("window"),"Rolling correlation matrix on the thread pool")
+			.def("ols_async",			async_if<nogil>(&econtype::ols),"Ordinary Least Squares on the thread pool")
 			;
 
 		tsp.add_property("econometric", py::make_function(&econtype::make),"Econometric handle for timeseries");
@@ -6,6 +6,7 @@
 
 #include <jflib/python/pyconfig.hpp>
 #include <jflib/timeseries/all.hpp>
+#include <jflib/python/timeseries/traits.hpp>
 
 
 
@@ -20,7 +21,8 @@ namespace {
 	struct MatrixConversion {
 		typedef boost::python::class_<TS>			tsptype;
 		static void reg(tsptype& tsp) {
-			tsp.def("tomatrix",		&TS::template tomatrix<Tag>,"Create a matrix timeseries structure");
+			static const bool nogil = gilfree_type<TS>::value && gilfree_type<Tag>::value;
+			tsp.def("tomatrix",		gilfree_if<nogil>(&TS::template tomatrix<Tag>),"Create a matrix timeseries structure");
 		}
 	};
 
@@ -31,6 +33,29 @@ namespace {
 	};
 
 
+	/**
+	 * \brief Zero-copy views, available for timeseries of family 1 only
+	 */
+	template<class TS, unsigned F = TS::family>
+	struct TimeseriesViews {
+		typedef boost::python::class_<TS>			tsptype;
+		static void reg(tsptype& tsp) {}
+	};
+
+	template<class TS>
+	struct TimeseriesViews<TS,1u> {
+		typedef boost::python::class_<TS>			tsptype;
+		static void reg(tsptype& tsp) {
+			namespace py = boost::python;
+			tsp
+				.def("view",		&TS::view,py::args("start","end"),"View of the timeseries from start to end sharing the same data")
+				.def("columns",		&TS::columns,py::args("start","end"),"View of series start to end sharing the same data")
+				.add_property("is_view",	&TS::is_view,"True if the timeseries is a window over a larger matrix")
+				;
+		}
+	};
+
+
 	/**
 	 * \brief mpl iteration class
 	 */
@@ -41,7 +66,8 @@ namespace {
 		static void regi(tsptype& tsp) {
 			typedef typename boost::mpl::next<iter>::type  next;
 			typedef typename boost::mpl::deref<iter>::type TS2;
-			tsp.def("addts",		&jflib::timeseries::traits::AddTs<TS,TS2>::apply,"merge an existing timeseries");
+			static const bool nogil = gilfree_type<TS>::value && gilfree_type<TS2>::value;
+			tsp.def("addts",		gilfree_if<nogil>(&jflib::timeseries::traits::AddTs<TS,TS2>::apply),"merge an existing timeseries");
 			addtsiter<TS,next,finished>::regi(tsp);
 		}
 	};
@@ -0,0 +1,104 @@
+//
+/// \file
+/// \brief Arrow PyCapsule interface of timeseries
+//
+#ifndef   __PYTHON_TIMESERIES_ARROW_JFLIB_HPP__
+#define   __PYTHON_TIMESERIES_ARROW_JFLIB_HPP__
+
+#include <jflib/python/pyconfig.hpp>
+#include <jflib/timeseries/arrow.hpp>
+#include <boost/type_traits/is_arithmetic.hpp>
+
+
+namespace jflib { namespace python {
+
+
+namespace {
+
+	inline void arrow_schema_destructor(PyObject* capsule) {
+		ArrowSchema* schema = static_cast<ArrowSchema*>(PyCapsule_GetPointer(capsule,"arrow_schema"));
+		if(schema->release)
+			schema->release(schema);
+		delete schema;
+	}
+
+	inline void arrow_array_destructor(PyObject* capsule) {
+		ArrowArray* array = static_cast<ArrowArray*>(PyCapsule_GetPointer(capsule,"arrow_array"));
+		if(array->release)
+			array->release(array);
+		delete array;
+	}
+
+}
+
+
+/**
+ * \brief Export of a timeseries to arrow, by default not available
+ */
+template<class TS, bool N = boost::is_arithmetic<typename TS::numtype>::value>
+struct ArrowExport {
+	typedef boost::python::class_<TS>	tsptype;
+	static void reg(tsptype&) {}
+};
+
+/**
+ * \brief Export of a numeric timeseries to arrow (see timeseries::arrow::exportts)
+ *
+ * Implements __arrow_c_array__, so that pyarrow.record_batch(ts) and
+ * other arrow consumers read the timeseries without serialisation.
+ */
+template<class TS>
+struct ArrowExport<TS,true> {
+	typedef boost::python::class_<TS>	tsptype;
+
+	static boost::python::object arrow_c_array(const TS& ts, const boost::python::object&) {
+		namespace py = boost::python;
+		std::auto_ptr<ArrowSchema> schema(new ArrowSchema);
+		std::auto_ptr<ArrowArray>  array(new ArrowArray);
+		schema->release = 0;
+		array->release  = 0;
+		jflib::timeseries::arrow::exportts(ts,schema.get(),array.get());
+		py::object s(py::handle<>(PyCapsule_New(schema.get(),"arrow_schema",arrow_schema_destructor)));
+		schema.release();
+		py::object a(py::handle<>(PyCapsule_New(array.get(),"arrow_array",arrow_array_destructor)));
+		array.release();
+		return py::make_tuple(s,a);
+	}
+
+	static void reg(tsptype& tsp) {
+		namespace py = boost::python;
+		tsp
+			.def("__arrow_c_array__",	arrow_c_array,(py::arg("requested_schema")=py::object()),
+				 "Arrow PyCapsules of a struct array with a date column and a float64 column per series")
+			;
+	}
+};
+
+
+/**
+ * \brief Import an arrow struct array of dates and float64 columns
+ *
+ * obj is an object implementing __arrow_c_array__ (a pyarrow RecordBatch
+ * for example) or the tuple of capsules it returns. Value buffers are
+ * aliased when possible (see timeseries::arrow::importts).
+ */
+template<class Key>
+typename jflib::timeseries::traits::ts<Key,double,jflib::timeseries::tsstore>::type
+fromarrow(const boost::python::object& obj) {
+	namespace py = boost::python;
+	py::object capsules = PyObject_HasAttrString(obj.ptr(),"__arrow_c_array__") ?
+						  obj.attr("__arrow_c_array__")() : obj;
+	py::object s = capsules[0];
+	py::object a = capsules[1];
+	ArrowSchema* schema = static_cast<ArrowSchema*>(PyCapsule_GetPointer(s.ptr(),"arrow_schema"));
+	ArrowArray*  array  = static_cast<ArrowArray*>(PyCapsule_GetPointer(a.ptr(),"arrow_array"));
+	if(!schema || !array)
+		py::throw_error_already_set();
+	return jflib::timeseries::arrow::importts<Key>(schema,array);
+}
+
+
+}}
+
+
+#endif	//	__PYTHON_TIMESERIES_ARROW_JFLIB_HPP__
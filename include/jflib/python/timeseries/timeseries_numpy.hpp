@@ -0,0 +1,541 @@
+
+
+#ifndef __TIMESERIES_WRAP_NUMPY_JFLIB_HPP__
+#define __TIMESERIES_WRAP_NUMPY_JFLIB_HPP__
+
+
+#include <jflib/python/pyconfig.hpp>
+#include <jflib/datetime/date.hpp>
+#include <jflib/timeseries/all.hpp>
+#include <jflib/ublas/const_array.hpp>
+
+#ifdef	__JFLIB_UBLAS_NUMPY_CONVERSION__
+#	include <jflib/python/numpy/numpy_vector.hpp>
+#	include <boost/python/make_constructor.hpp>
+#	include <jflib/python/numpy/numpy_matrix.hpp>
+#	include <boost/iterator/transform_iterator.hpp>
+#	include <boost/type_traits/is_arithmetic.hpp>
+#	include <limits>
+#endif
+
+
+
+namespace jflib { namespace python {
+
+
+/**
+ * \brief Convert an integer from a numpy array into a timeseries key
+ *
+ * Dates are numbers of days since 1970-01-01, the integer
+ * representation of a numpy datetime64[D] array.
+ */
+template<class K>
+struct numpykey {
+	typedef K	result_type;
+	template<class I>
+	result_type operator () (const I& v) const {return result_type(v);}
+	/// \brief numpy type of exported keys
+	static const char* dtype() {return "int64";}
+};
+
+template<>
+struct numpykey<qdate> {
+	typedef qdate	result_type;
+	template<class I>
+	result_type operator () (const I& v) const {return qdate::fromunixdays(long(v));}
+	static const char* dtype() {return "datetime64[D]";}
+};
+
+
+
+namespace {
+
+
+	/**
+	 * \brief Construction from numpy arrays, by default not available
+	 */
+	template<class TS, unsigned F = TS::family, bool M = TS::multipleseries>
+	struct NumpyConstructor {
+		typedef boost::python::class_<TS>			tsptype;
+		static void reg(tsptype&) {}
+	};
+
+	/**
+	 * \brief Zero-copy numpy arrays of data, mask and keys, by default not available
+	 */
+	template<class TS, unsigned F = TS::family>
+	struct NumpyViews {
+		typedef boost::python::class_<TS>			tsptype;
+		static void reg(tsptype&) {}
+	};
+
+	/**
+	 * \brief Export of keys and values into new numpy arrays, by default not available
+	 */
+	template<class TS, unsigned F = TS::family, bool M = TS::multipleseries>
+	struct NumpyExport {
+		typedef boost::python::class_<TS>			tsptype;
+		static void reg(tsptype&) {}
+	};
+
+#ifdef	__JFLIB_UBLAS_NUMPY_CONVERSION__
+
+	/// \brief First element and distance in elements between elements of a dense storage
+	template<class A>
+	const typename A::value_type* storage_data(const A& a) {return a.begin();}
+	template<class A>
+	npy_intp storage_step(const A&) {return 1;}
+
+	/// \brief A constant array is a numpy array with strides of 0
+	template<class T>
+	const T* storage_data(const jflib::ublas::const_array<T>& a) {return a.data();}
+	template<class T>
+	npy_intp storage_step(const jflib::ublas::const_array<T>& a) {return a.step();}
+
+	/**
+	 * \brief A numpy array over memory owned by a C++ object
+	 *
+	 * The python object owner is set as the base of the array, so that
+	 * the memory stays alive as long as the array does.
+	 * Strides are given in number of elements.
+	 */
+	template<class T>
+	boost::python::object numpy_alias(const boost::python::object& owner, const T* data, int ndim,
+									  const npy_intp* dims, const npy_intp* strides, bool writeable,
+									  int typenum = numpy::get_typenum(T())) {
+		npy_intp bstrides[2];
+		for(int i=0;i<ndim;++i)
+			bstrides[i] = strides[i]*sizeof(T);
+		int flags = writeable ? NPY_ARRAY_WRITEABLE : 0;
+		boost::python::handle<> result(PyArray_New(&PyArray_Type, ndim, const_cast<npy_intp*>(dims),
+												   typenum, bstrides,
+												   const_cast<T*>(data), 0, flags, NULL));
+		PyArray_SetBaseObject((PyArrayObject*)result.get(), boost::python::incref(owner.ptr()));
+		return boost::python::object(result);
+	}
+
+	/**
+	 * \brief Arrays aliasing the matrix and keys of a timeseries of family 1
+	 *
+	 * The arrays are views over the timeseries window. Each array holds a
+	 * pin of the timeseries index, which keeps the memory alive and stops
+	 * the timeseries and its copies from growing while the array exists,
+	 * as numpy arrays do not resize while they are referenced. They are
+	 * not writeable if the timeseries is read-only.
+	 */
+	template<class TS>
+	struct NumpyViews<TS,1u> {
+		typedef TS										tstype;
+		typedef typename tstype::matrix_data_type		matrix_data_type;
+		typedef typename tstype::matrix_mask_type		matrix_mask_type;
+		typedef typename tstype::range					range;
+		typedef typename tstype::index_type				index_type;
+		typedef typename index_type::ordinal_type		ordinal_type;
+		typedef typename index_type::pin				pin_type;
+		typedef boost::python::class_<tstype>			tsptype;
+
+		static boost::python::object data(const boost::python::object& self) {
+			const tstype& ts = boost::python::extract<const tstype&>(self);
+			return alias(ts,ts.support()->data);
+		}
+
+		static boost::python::object mask(const boost::python::object& self) {
+			const tstype& ts = boost::python::extract<const tstype&>(self);
+			return alias(ts,ts.support()->mask);
+		}
+
+		/// \brief keys as int64 (days since 1970-01-01 for dates)
+		static boost::python::object keys(const boost::python::object& self) {
+			const tstype& ts = boost::python::extract<const tstype&>(self);
+			npy_intp dims[]    = {npy_intp(ts.size())};
+			npy_intp strides[] = {1};
+			static const ordinal_type empty = 0;
+			const ordinal_type* ords = ts.size() ? ts.index().ordinals() : &empty;
+			return numpy_alias<ordinal_type>(owner(ts),ords,1,dims,strides,false,NPY_INT64);
+		}
+
+		static void reg(tsptype& tsp) {
+			tsp
+				.add_property("data",		data,"Timeseries data as a numpy array sharing memory with the timeseries")
+				.add_property("mask",		mask,"Mask as a numpy array sharing memory with the timeseries")
+				.add_property("keyarray",	keys,"Keys as a read-only int64 numpy array. Dates are days since 1970-01-01, view them with .view('M8[D]')")
+				;
+		}
+	private:
+		/// \brief A capsule holding a pin of ts, released with the last array it owns
+		static boost::python::object owner(const tstype& ts) {
+			std::auto_ptr<pin_type> p(new pin_type(ts.index()));
+			boost::python::handle<> capsule(PyCapsule_New(p.get(),NULL,release));
+			p.release();
+			return boost::python::object(capsule);
+		}
+
+		static void release(PyObject* capsule) {
+			delete static_cast<pin_type*>(PyCapsule_GetPointer(capsule,NULL));
+		}
+
+		template<class M>
+		static boost::python::object alias(const tstype& ts, const M& m) {
+			typedef boost::numeric::ublas::row_major_tag	row_major_tag;
+			typedef typename M::value_type					value_type;
+			range rows = ts.index().rows();
+			range cols = ts.index().cols();
+			npy_intp dims[] = {npy_intp(rows.size()), npy_intp(cols.size())};
+			npy_intp strides[2];
+			npy_intp step = storage_step(m.data());
+			if(boost::is_same<typename M::orientation_category,row_major_tag>::value) {
+				strides[0] = step*m.size2();
+				strides[1] = step;
+			}
+			else {
+				strides[0] = step;
+				strides[1] = step*m.size1();
+			}
+			const value_type* p = storage_data(m.data());
+			if(dims[0] && dims[1])
+				p += rows.start()*strides[0] + cols.start()*strides[1];
+			return numpy_alias<value_type>(owner(ts),p,2,dims,strides,!ts.is_readonly());
+		}
+	};
+
+	/**
+	 * \brief Keys as a contiguous int64 numpy array
+	 *
+	 * datetime64 arrays (of any unit) and sequences of dates are converted
+	 * to days since 1970-01-01, integer arrays are used as they are.
+	 */
+	inline numpy::numpy_vector<npy_int64> numpy_keys(const boost::python::object& keys) {
+		namespace py = boost::python;
+		py::object np  = py::import("numpy");
+		py::object arr = np.attr("asarray")(keys);
+		std::string kind = py::extract<std::string>(arr.attr("dtype").attr("kind"));
+		if(kind == "M" || kind == "O")
+			arr = arr.attr("astype")("datetime64[D]").attr("view")("int64");
+		arr = np.attr("ascontiguousarray")(arr,"int64");
+		return py::extract<numpy::numpy_vector<npy_int64> >(arr);
+	}
+
+	/// \brief Values as a contiguous float64 numpy array with ndim dimensions
+	inline boost::python::object numpy_values(const boost::python::object& values, int ndim) {
+		namespace py = boost::python;
+		py::object np  = py::import("numpy");
+		py::object arr = np.attr("ascontiguousarray")(values,"float64");
+		QM_REQUIRE(py::extract<int>(arr.attr("ndim"))() == ndim,"Values have the wrong number of dimensions");
+		return arr;
+	}
+
+
+	/**
+	 * \brief Bulk load of a single-series map timeseries from a sorted
+	 * array of keys and an array of values
+	 */
+	template<class TS>
+	struct NumpyConstructor<TS,0u,false> {
+		typedef TS										tstype;
+		typedef typename tstype::key_type				key_type;
+		typedef typename tstype::numtype				numtype;
+		typedef numpy::numpy_vector<npy_int64>			keys_type;
+		typedef numpy::numpy_vector<numtype>			values_type;
+		typedef numpykey<key_type>						key_transform;
+		typedef boost::python::class_<tstype>			tsptype;
+
+		static tstype* fromarrays(const std::string& name, const boost::python::object& keys,
+								  const boost::python::object& values) {
+			std::auto_ptr<tstype> ts(new tstype(name));
+			extend(*ts,keys,values);
+			return ts.release();
+		}
+
+		/// \brief Keys after the last key are loaded in bulk, others are added one by one
+		static void extend(tstype& ts, const boost::python::object& keys, const boost::python::object& values) {
+			keys_type	k = numpy_keys(keys);
+			values_type	v = boost::python::extract<values_type>(numpy_values(values,1));
+			QM_REQUIRE(k.size() == v.size(),"Keys and values must have the same size");
+			if(!k.size()) return;
+			key_transform kt;
+			if(ts.empty() || ts.back().first < kt(k[0]))
+				ts.load(boost::make_transform_iterator(k.begin(),kt),
+						boost::make_transform_iterator(k.end(),kt),
+						v.begin());
+			else
+				for(std::size_t i=0;i<k.size();++i)
+					ts.add(kt(k[i]),v[i]);
+		}
+
+		static void reg(tsptype& tsp) {
+			namespace py = boost::python;
+			tsp
+				.def("__init__", py::make_constructor(&fromarrays,py::default_call_policies(),
+													  py::args("name","keys","values")),
+					 "Create the timeseries from a sorted array of dates (datetime64 or int64 days since 1970-01-01) and an array of values")
+				.def("extend",	extend,py::args("keys","values"),"Add arrays of dates and values to the timeseries")
+				;
+		}
+	};
+
+
+	/**
+	 * \brief Bulk load of a multi-series map timeseries from a sorted
+	 * array of keys and a 2-D array of values, one row per key.
+	 * NaN values are masked.
+	 */
+	template<class TS>
+	struct NumpyConstructor<TS,0u,true> {
+		typedef TS										tstype;
+		typedef typename tstype::key_type				key_type;
+		typedef typename tstype::numtype				numtype;
+		typedef typename tstype::mapped_type			mapped_type;
+		typedef numpy::numpy_vector<npy_int64>			keys_type;
+		typedef numpy::numpy_matrix<numtype>			values_type;
+		typedef numpykey<key_type>						key_transform;
+		typedef boost::python::class_<tstype>			tsptype;
+
+		static tstype* fromarrays(const std::string& name, const boost::python::object& keys,
+								  const boost::python::object& values) {
+			std::auto_ptr<tstype> ts(new tstype(name));
+			extend(*ts,keys,values);
+			return ts.release();
+		}
+
+		static void extend(tstype& ts, const boost::python::object& keys, const boost::python::object& values) {
+			keys_type	k = numpy_keys(keys);
+			values_type	v = boost::python::extract<values_type>(numpy_values(values,2));
+			QM_REQUIRE(k.size() == v.size1(),"Keys and values must have the same number of rows");
+			std::size_t S = v.size2();
+			std::vector<mapped_type> rows;
+			rows.reserve(k.size());
+			for(std::size_t r=0;r<k.size();++r) {
+				mapped_type row(S);
+				for(std::size_t c=0;c<S;++c) {
+					numtype x = v(r,c);
+					row.data()[c] = x;
+					row.mask()[c] = x == x ? 1 : 0;
+				}
+				rows.push_back(row);
+			}
+			if(!k.size()) return;
+			key_transform kt;
+			if(ts.empty() || ts.back().first < kt(k[0]))
+				ts.load(boost::make_transform_iterator(k.begin(),kt),
+						boost::make_transform_iterator(k.end(),kt),
+						rows.begin());
+			else
+				for(std::size_t i=0;i<k.size();++i)
+					ts.add(kt(k[i]),rows[i]);
+		}
+
+		static void reg(tsptype& tsp) {
+			namespace py = boost::python;
+			tsp
+				.def("__init__", py::make_constructor(&fromarrays,py::default_call_policies(),
+													  py::args("name","keys","values")),
+					 "Create the timeseries from a sorted array of dates and a 2-D array of values")
+				.def("extend",	extend,py::args("keys","values"),"Add an array of dates and a 2-D array of values to the timeseries")
+				;
+		}
+	};
+
+
+	/**
+	 * \brief Bulk load of a matrix timeseries from a sorted array of keys
+	 * and a 2-D array of values. NaN values are masked.
+	 */
+	template<class TS>
+	struct NumpyConstructor<TS,1u,true> {
+		typedef TS										tstype;
+		typedef typename tstype::key_type				key_type;
+		typedef typename tstype::numtype				numtype;
+		typedef numpy::numpy_vector<npy_int64>			keys_type;
+		typedef numpy::numpy_matrix<numtype>			values_type;
+		typedef numpykey<key_type>						key_transform;
+		typedef boost::python::class_<tstype>			tsptype;
+
+		static tstype* fromarrays(const std::string& name, const boost::python::object& keys,
+								  const boost::python::object& values) {
+			std::auto_ptr<tstype> ts(new tstype(name));
+			extend(*ts,keys,values);
+			return ts.release();
+		}
+
+		/// \brief Dates must follow the last date of the timeseries
+		static void extend(tstype& ts, const boost::python::object& keys, const boost::python::object& values) {
+			keys_type	k = numpy_keys(keys);
+			values_type	v = boost::python::extract<values_type>(numpy_values(values,2));
+			QM_REQUIRE(k.size() == v.size1(),"Keys and values must have the same number of rows");
+			key_transform kt;
+			ts.load(boost::make_transform_iterator(k.begin(),kt),
+					boost::make_transform_iterator(k.end(),kt),
+					v.data().begin(), v.size2());
+		}
+
+		static void reg(tsptype& tsp) {
+			namespace py = boost::python;
+			tsp
+				.def("__init__", py::make_constructor(&fromarrays,py::default_call_policies(),
+													  py::args("name","keys","values")),
+					 "Create the timeseries from a sorted array of dates and a 2-D array of values")
+				.def("extend",	extend,py::args("keys","values"),"Append an array of dates and a 2-D array of values to the timeseries")
+				;
+		}
+	};
+
+	/**
+	 * \brief Element of an exported numpy array
+	 *
+	 * Numeric values are exported as float64 with NaN for masked values,
+	 * other values as objects with None for masked values.
+	 */
+	template<class T, bool = boost::is_arithmetic<T>::value>
+	struct numpy_cell {
+		static int typenum() {return NPY_DOUBLE;}
+		static void set(void* p, const T& v) {*static_cast<double*>(p) = double(v);}
+		static void missing(void* p) {*static_cast<double*>(p) = std::numeric_limits<double>::quiet_NaN();}
+	};
+
+	template<class T>
+	struct numpy_cell<T,false> {
+		static int typenum() {return NPY_OBJECT;}
+		static void set(void* p, const T& v) {assign(p,boost::python::object(v).ptr());}
+		static void missing(void* p) {assign(p,Py_None);}
+	private:
+		static void assign(void* p, PyObject* o) {
+			PyObject** c = static_cast<PyObject**>(p);
+			Py_INCREF(o);
+			Py_XDECREF(*c);
+			*c = o;
+		}
+	};
+
+	/// \brief A new numpy array of type typenum
+	inline boost::python::object numpy_empty(int ndim, const npy_intp* dims, int typenum) {
+		return boost::python::object(boost::python::handle<>(
+				PyArray_SimpleNew(ndim,const_cast<npy_intp*>(dims),typenum)));
+	}
+
+	/**
+	 * \brief Keys of a timeseries as a new contiguous numpy array
+	 *
+	 * Dates are exported as datetime64[D], other keys as int64 (see traits::keyordinal).
+	 */
+	template<class TS>
+	boost::python::object numpy_keyarray(const TS& ts) {
+		typedef typename TS::key_type					key_type;
+		typedef typename TS::const_key_iterator			const_key_iterator;
+		npy_intp dims[] = {npy_intp(ts.size())};
+		boost::python::object arr = numpy_empty(1,dims,NPY_INT64);
+		npy_int64* p = static_cast<npy_int64*>(PyArray_DATA((PyArrayObject*)arr.ptr()));
+		for(const_key_iterator k=ts.key_begin(); k!=ts.key_end(); ++k,++p)
+			*p = jflib::timeseries::traits::keyordinal<key_type>::apply(*k);
+		return arr.attr("view")(numpykey<key_type>::dtype());
+	}
+
+
+	/**
+	 * \brief Keys and values of a single-series timeseries as 1-D arrays
+	 */
+	template<class TS, unsigned F>
+	struct NumpyExport<TS,F,false> {
+		typedef TS										tstype;
+		typedef typename tstype::numtype				numtype;
+		typedef typename tstype::const_val_iterator		const_val_iterator;
+		typedef numpy_cell<numtype>						cell;
+		typedef boost::python::class_<tstype>			tsptype;
+
+		static boost::python::tuple to_numpy(const tstype& ts) {
+			npy_intp dims[] = {npy_intp(ts.size())};
+			boost::python::object values = numpy_empty(1,dims,cell::typenum());
+			PyArrayObject* arr = (PyArrayObject*)values.ptr();
+			npy_intp i = 0;
+			for(const_val_iterator v=ts.val_begin(); v!=ts.val_end(); ++v,++i)
+				cell::set(PyArray_GETPTR1(arr,i),*v);
+			return boost::python::make_tuple(numpy_keyarray(ts),values);
+		}
+
+		static void reg(tsptype& tsp) {
+			tsp.def("to_numpy",to_numpy,"Keys and values as a tuple of new numpy arrays. Dates are datetime64[D]");
+		}
+	};
+
+	/**
+	 * \brief Keys and values of a multi-series timeseries as 1-D and 2-D arrays
+	 *
+	 * One row per key, masked values and missing series are NaN.
+	 */
+	template<class TS, unsigned F>
+	struct NumpyExport<TS,F,true> {
+		typedef TS										tstype;
+		typedef typename tstype::numtype				numtype;
+		typedef typename tstype::mapped_type			mapped_type;
+		typedef typename tstype::const_val_iterator		const_val_iterator;
+		typedef numpy_cell<numtype>						cell;
+		typedef boost::python::class_<tstype>			tsptype;
+
+		static boost::python::tuple to_numpy(const tstype& ts) {
+			npy_intp S = ts.series();
+			npy_intp dims[] = {npy_intp(ts.size()), S};
+			boost::python::object values = numpy_empty(2,dims,cell::typenum());
+			PyArrayObject* arr = (PyArrayObject*)values.ptr();
+			npy_intp r = 0;
+			for(const_val_iterator v=ts.val_begin(); v!=ts.val_end(); ++v,++r) {
+				mapped_type row(*v);
+				npy_intp N = std::min(S,npy_intp(row.size()));
+				npy_intp c = 0;
+				for(;c<N;++c) {
+					if(row.mask()[c] == mapped_type::masked_value)
+						cell::missing(PyArray_GETPTR2(arr,r,c));
+					else
+						cell::set(PyArray_GETPTR2(arr,r,c),row.data()[c]);
+				}
+				for(;c<S;++c)
+					cell::missing(PyArray_GETPTR2(arr,r,c));
+			}
+			return boost::python::make_tuple(numpy_keyarray(ts),values);
+		}
+
+		static void reg(tsptype& tsp) {
+			tsp.def("to_numpy",to_numpy,"Keys and values as a tuple of a new 1-D and a new 2-D numpy array. Dates are datetime64[D]");
+		}
+	};
+
+	/**
+	 * \brief Keys and values of a matrix timeseries, copied from the matrix window
+	 */
+	template<class TS>
+	struct NumpyExport<TS,1u,true> {
+		typedef TS										tstype;
+		typedef typename tstype::numtype				numtype;
+		typedef typename tstype::matrix_data_range		matrix_data_range;
+		typedef typename tstype::matrix_mask_range		matrix_mask_range;
+		typedef numpy_cell<numtype>						cell;
+		typedef boost::python::class_<tstype>			tsptype;
+
+		static boost::python::tuple to_numpy(const tstype& ts) {
+			matrix_data_range d = ts.data_range();
+			matrix_mask_range m = ts.mask_range();
+			npy_intp dims[] = {npy_intp(d.size1()), npy_intp(d.size2())};
+			boost::python::object values = numpy_empty(2,dims,cell::typenum());
+			PyArrayObject* arr = (PyArrayObject*)values.ptr();
+			for(npy_intp r=0;r<dims[0];++r)
+				for(npy_intp c=0;c<dims[1];++c) {
+					if(m(r,c))
+						cell::set(PyArray_GETPTR2(arr,r,c),d(r,c));
+					else
+						cell::missing(PyArray_GETPTR2(arr,r,c));
+				}
+			return boost::python::make_tuple(numpy_keyarray(ts),values);
+		}
+
+		static void reg(tsptype& tsp) {
+			tsp.def("to_numpy",to_numpy,"Keys and values as a tuple of a new 1-D and a new 2-D numpy array. Dates are datetime64[D]");
+		}
+	};
+
+#endif
+
+}
+
+
+}}
+
+
+#endif	//	__TIMESERIES_WRAP_NUMPY_JFLIB_HPP__
@@ -6,9 +6,12 @@
 
 #include <jflib/python/pair_to_tuple.hpp>
 #include <jflib/python/timeseries/timeseries_add.hpp>
+#include <jflib/python/timeseries/timeseries_numpy.hpp>
+#include <jflib/python/timeseries/timeseries_arrow.hpp>
 #include <jflib/python/timeseries/econometric_wrap.hpp>
 #include <jflib/timeseries/traits/converters.hpp>
 #include <jflib/timeseries/expressions/all.hpp>
+#include <jflib/timeseries/writer.hpp>
 
 
 
@@ -119,7 +122,7 @@ namespace {
 				.add_property("data",		&tstype::data,"Internal timeseries data")
 				.add_property("mask",		&tstype::mask,"mask matrix")
 				.def("__setitem__",			&tstype::add)
-				.def("__getitem__",			py::make_function(&tstype::at,ccr))
+				.def("__getitem__",			pytsimpl::at)
 				.def("has_key",				&tstype::has_key,py::arg("key"),"Return true if key is available")
 				.def("items",				py::iterator<tstype>(),"Iterator over key-value pairs")
 				.def("values",				py::range(pytsimpl::vbegin, pytsimpl::vend),"Iterator over values")
@@ -127,9 +130,11 @@ namespace {
 				//.def("range",				&rangetype::make,py::arg("range"),"Iterator over ranges")
 				.def("daycounts",			jflib::timeseries::tsdcf<tstype,py::list>)
 				.def("__iter__",			py::range(pytsimpl::kbegin, pytsimpl::kend),"Iterator over keys")
-				.def("front",				py::make_function(&tstype::front,ccr))
-				.def("back",				py::make_function(&tstype::back,ccr))
+				.def("front",				pytsimpl::front)
+				.def("back",				pytsimpl::back)
 				//.def("json",				json<tstype>)
+				.def("tojson",				pytsimpl::tojson,"Flot-style JSON string [[timestamp, value, ...], ...] with timestamps in milliseconds, missing values are null")
+				.def("tocsv",				pytsimpl::tocsv,(py::arg("delimiter")=','),"CSV string with a date column, missing values are empty")
 				.def("apply",				py::make_function(&tstype::apply,ccr))
 				.def("copy",				&tstype::copy,py::args("start","end"),"Copy timeseries from start to end")
 				.def("clone",				&tstype::clone,"Clone the timeseries")
@@ -141,6 +146,11 @@ namespace {
 				;
 
 			MatrixConversion<tstype,CTag>::reg(tsp);
+			TimeseriesViews<tstype>::reg(tsp);
+			NumpyConstructor<tstype>::reg(tsp);
+			NumpyViews<tstype>::reg(tsp);
+			NumpyExport<tstype>::reg(tsp);
+			ArrowExport<tstype>::reg(tsp);
 			addts<tstype,V>::reg(tsp);
 			pyeconometric<tstype,vtag,MT>::reg(name,tsp);
 			pytsoperations<tstype,numtype>::reg(tsp);
@@ -157,6 +167,20 @@ namespace {
 		static key_iterator kend(tstype& x)   {return x.key_end();}
 		static val_iterator vbegin(tstype& x) {return x.val_begin();}
 		static val_iterator vend(tstype& x)   {return x.val_end();}
+		// Returned by value since family 1 timeseries build rows on demand
+		static mapped_type at(const tstype& x, const key_type& k) {return x.at(k);}
+		static value_type front(const tstype& x) {return x.front();}
+		static value_type back(const tstype& x)  {return x.back();}
+		static boost::python::str tojson(const tstype& x) {
+			textwriter w(24*x.size()*(x.series() + 1));
+			jflib::timeseries::writer::json(x,w);
+			return boost::python::str(w.data(),w.size());
+		}
+		static boost::python::str tocsv(const tstype& x, char delimiter) {
+			textwriter w(24*x.size()*(x.series() + 1));
+			jflib::timeseries::writer::csv(x,w,delimiter);
+			return boost::python::str(w.data(),w.size());
+		}
 	};
 
 
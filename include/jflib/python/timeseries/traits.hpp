@@ -6,6 +6,7 @@
 #include <jflib/timeseries/all.hpp>
 #include <jflib/datetime/daycount.hpp>
 #include <jflib/timeseries/tsoperators.hpp>
+#include <jflib/python/gil.hpp>
 #ifdef	__JFLIB_UBLAS_NUMPY_CONVERSION__
 #include <jflib/python/numpy/numpy_matrix.hpp>
 #endif
@@ -15,46 +16,6 @@
 
 namespace jflib { namespace timeseries {
 
-template<class Key>
-struct daycountertype {
-	typedef Act365<Key>	type;
-};
-
-
-
-/**
- * \brief Specialization of tsvmapbase
- * The masked vector is given by ublas vectors
- */
-struct ublas_tsvmap: tsvmapbase {
-	typedef ublas_tsvmap	self;
-
-	template<class Key, class T>
-	struct container {
-		typedef T													numtype;
-		typedef boost::numeric::ublas::vector<numtype>				data_type;
-		typedef boost::numeric::ublas::vector<int>					mask_type;
-		typedef maskedvector<data_type,mask_type,family>			vtype;
-		typedef jflib::templates::associative<Key,vtype,0>			super;
-		typedef	timeseries<Key,numtype,self,family,multipleseries>	type;
-	};
-};
-
-
-// ublas timeserie matrix tag based on boost::numeric::ublas matrix structure
-struct ublas_tsmatrix: tsmatrix_base {
-	typedef ublas_tsmatrix	self;
-
-	template<class Key, class T>
-	struct container {
-		typedef T														numtype;
-		typedef boost::numeric::ublas::matrix<numtype>					data_type;
-		typedef boost::numeric::ublas::matrix<int>						mask_type;
-		typedef Nil														super;
-		typedef timeseries<Key,numtype,self,family,multipleseries>		type;
-	};
-};
-
 
 #ifdef	__JFLIB_UBLAS_NUMPY_CONVERSION__
 
@@ -94,4 +55,27 @@ struct matrix_traits<jflib::python::numpy::numpy_matrix<T> > {
 }}
 
 
+
+namespace jflib { namespace python {
+
+/**
+ * \brief Timeseries can run without the GIL if their values and their
+ * storage do not hold python objects
+ */
+template<class Key, class T, class Tag, unsigned F, bool M>
+struct gilfree_type<jflib::timeseries::timeseries<Key,T,Tag,F,M> >:
+	boost::mpl::and_<gilfree_type<T>,gilfree_type<Tag> > {};
+
+template<class TS, class vtag, class MT>
+struct gilfree_type<jflib::timeseries::econometric::analysis<TS,vtag,MT> >: gilfree_type<TS> {};
+
+#ifdef	__JFLIB_UBLAS_NUMPY_CONVERSION__
+/// \brief Matrices of tsnumpy are numpy arrays
+template<>
+struct gilfree_type<jflib::timeseries::tsnumpy>: boost::mpl::false_ {};
+#endif
+
+}}
+
+
 #endif	//	__PYTHON_TIMESERIES_TRAITS_HPP__
@@ -127,7 +127,24 @@ public:
 	iterator 					insert(iterator position, const value_type& x)	{return m_ptr->insert(position,x);}
 
 	template <class InputIterator>
-	void	insert(InputIterator first, InputIterator last)	{return m_ptr>insert(first,last);}
+	void	insert(InputIterator first, InputIterator last)	{m_ptr->insert(first,last);}
+
+	/** \brief Bulk load of sorted keys and values
+	 *
+	 * Keys must be strictly increasing and greater than the last key
+	 * already in the container. Each element is inserted at the end of the
+	 * tree, so that loading N elements is linear in N.
+	 */
+	template <class KeyIterator, class ValIterator>
+	void	load(KeyIterator kfirst, KeyIterator klast, ValIterator vfirst) {
+		iterator io = m_ptr->end();
+		if(!m_ptr->empty()) --io;
+		for(;kfirst!=klast;++kfirst,++vfirst) {
+			key_type k(*kfirst);
+			QM_REQUIRE(io == m_ptr->end() || io->first < k,"Keys must be sorted in increasing order");
+			io = m_ptr->insert(m_ptr->end(),value_type(k,*vfirst));
+		}
+	}
 
 	// New methods
 	void add(const key_type& key, const mapped_type& value) {
@@ -2,6 +2,8 @@
 #ifndef		__JFLIB_PYTHON_TESTS_ALL_HPP_
 #define		__JFLIB_PYTHON_TESTS_ALL_HPP_
 
+#include <string>
+
 namespace jflib {
 
 namespace python {
@@ -20,6 +22,13 @@ public:
 
 	int ublasmatrix();
 	int eigenvectors(int size);
+	int tsmatrixroll();
+	int tsshared(const std::string& path);
+	int tsstore(const std::string& path);
+	int tscodec();
+	int tscsv(const std::string& path);
+	int tsarrow();
+	int tswriter();
 };
 
 }
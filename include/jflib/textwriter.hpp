@@ -0,0 +1,162 @@
+/**
+ * \brief Text formatting into a growable buffer
+ */
+#ifndef __TEXTWRITER_JFLIB_HPP__
+#define __TEXTWRITER_JFLIB_HPP__
+
+#include <jflib/obj2str.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <locale>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+
+namespace jflib {
+
+
+/**
+ * \brief Growable character buffer with number formatting
+ *
+ * Text is appended in place, without temporary strings. Doubles are
+ * written with the fewest significant digits which read back to the
+ * same value. Numbers are formatted in the classic locale, whatever the
+ * global C or C++ locale, so that the decimal point is always a dot.
+ */
+class textwriter {
+public:
+	typedef std::size_t		size_type;
+
+	textwriter(size_type capacity = 0) {
+		m_buf.reserve(capacity);
+		this->imbue();
+	}
+	textwriter(const textwriter& w):m_buf(w.m_buf) {this->imbue();}
+	textwriter& operator = (const textwriter& w) {
+		m_buf = w.m_buf;
+		return *this;
+	}
+
+	void put(char c)							{m_buf.push_back(c);}
+	void put(const char* s, size_type n)		{m_buf.insert(m_buf.end(),s,s + n);}
+	void put(const char* s)						{this->put(s,std::strlen(s));}
+	void put(const std::string& s)				{this->put(s.data(),s.size());}
+
+	void putint(boost::int64_t v) {
+		char buf[24];
+		char* e = buf + sizeof(buf);
+		char* p = e;
+		boost::uint64_t u = v < 0 ? boost::uint64_t(0) - boost::uint64_t(v) : boost::uint64_t(v);
+		do {
+			*--p = char('0' + u % 10);
+			u /= 10;
+		} while(u);
+		if(v < 0)
+			*--p = '-';
+		this->put(p,e - p);
+	}
+
+	/// \brief Shortest round-trip representation, nan and inf for non finite values
+	void putdouble(double v) {
+		if(v != v) {
+			this->put("nan",3);
+			return;
+		}
+		if(std::fabs(v) > 1.7976931348623157e308) {
+			this->put(v < 0 ? "-inf" : "inf");
+			return;
+		}
+		if(v == std::floor(v) && std::fabs(v) < 1e15 && (v != 0 || 1/v > 0)) {
+			this->putint(boost::int64_t(v));
+			return;
+		}
+		for(int precision=15;precision<=17;++precision)
+			if(this->format(v,precision) == v || precision == 17)
+				break;
+		this->put(m_num);
+	}
+
+	/// \brief Shortest round-trip representation of a single precision value
+	void putfloat(float v) {
+		if(v != v || v == std::floor(v)) {
+			this->putdouble(v);
+			return;
+		}
+		for(int precision=6;precision<=9;++precision)
+			if(float(this->format(v,precision)) == v || precision == 9)
+				break;
+		this->put(m_num);
+	}
+
+	/// \brief Date as YYYY-MM-DD
+	void putdate(int y, int m, int d) {
+		char buf[10] = {char('0' + y/1000 % 10),char('0' + y/100 % 10),char('0' + y/10 % 10),char('0' + y % 10),'-',
+						char('0' + m/10),char('0' + m % 10),'-',char('0' + d/10),char('0' + d % 10)};
+		this->put(buf,10);
+	}
+
+	const char*	data()	const {return m_buf.empty() ? "" : &m_buf[0];}
+	size_type	size()	const {return m_buf.size();}
+	bool		empty()	const {return m_buf.empty();}
+	void		clear()		  {m_buf.clear();}
+	std::string	str()	const {return std::string(this->data(),this->size());}
+private:
+	std::vector<char>	m_buf;
+	std::ostringstream	m_out;
+	std::istringstream	m_in;
+	std::string			m_num;
+
+	void imbue() {
+		m_out.imbue(std::locale::classic());
+		m_in.imbue(std::locale::classic());
+	}
+
+	/// \brief Write v with precision significant digits into m_num and return the value read back
+	double format(double v, int precision) {
+		m_out.str(std::string());
+		m_out.precision(precision);
+		m_out << v;
+		m_num = m_out.str();
+		double r = 0;
+		m_in.clear();
+		m_in.str(m_num);
+		m_in >> r;
+		return m_in.fail() ? v + 1 : r;
+	}
+};
+
+
+/**
+ * \brief Write an object into a textwriter, by default its obj2str representation
+ */
+template<class T>
+struct textformat {
+	static void put(textwriter& w, const T& x) {w.put(obj2str(x));}
+};
+
+#define QM_TEXTFORMAT_INTEGER(name)												\
+template<> struct textformat<name>  {											\
+	static void put(textwriter& w, name x) {w.putint(boost::int64_t(x));}		\
+};
+
+QM_TEXTFORMAT_INTEGER(int)
+QM_TEXTFORMAT_INTEGER(short)
+QM_TEXTFORMAT_INTEGER(long)
+QM_TEXTFORMAT_INTEGER(unsigned short)
+QM_TEXTFORMAT_INTEGER(unsigned)
+
+template<> struct textformat<double>  {
+	static void put(textwriter& w, double x) {w.putdouble(x);}
+};
+
+template<> struct textformat<float>  {
+	static void put(textwriter& w, float x) {w.putfloat(x);}
+};
+
+
+}
+
+
+#endif	//	__TEXTWRITER_JFLIB_HPP__
@@ -0,0 +1,200 @@
+/**
+ * \brief Latency histograms cheap enough to record in production
+ */
+
+#ifndef __THREADS_LATENCY_JFLIB_HPP__
+#define __THREADS_LATENCY_JFLIB_HPP__
+
+#include <jflib/error.hpp>
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#ifdef _WIN32
+#	ifndef NOMINMAX
+#		define NOMINMAX
+#	endif
+#	include <windows.h>
+#else
+#	include <time.h>
+#endif
+
+
+namespace jflib { namespace threads {
+
+
+/**
+ * \brief Monotonic clock in nanoseconds
+ *
+ * clock_gettime(CLOCK_MONOTONIC), served without a system call on Linux,
+ * and QueryPerformanceCounter on Windows. Times from different threads
+ * can be compared.
+ */
+struct latencyclock {
+	/// \brief Nanoseconds since an arbitrary origin
+	static boost::int64_t now();
+};
+
+inline boost::int64_t latencyclock::now() {
+#ifdef _WIN32
+	static LARGE_INTEGER frequency = {0};
+	if(!frequency.QuadPart)
+		QueryPerformanceFrequency(&frequency);
+	LARGE_INTEGER c;
+	QueryPerformanceCounter(&c);
+	return boost::int64_t(c.QuadPart/frequency.QuadPart)*1000000000 +
+		   boost::int64_t(c.QuadPart % frequency.QuadPart)*1000000000/frequency.QuadPart;
+#else
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return boost::int64_t(ts.tv_sec)*1000000000 + ts.tv_nsec;
+#endif
+}
+
+
+/**
+ * \brief Histogram of latencies in nanoseconds with a bounded relative error
+ *
+ * Values are counted in buckets of the HDR histogram layout: each power
+ * of two is split into 16 sub-buckets, so that a value is known within
+ * 1/16 of itself from a nanosecond to centuries, in a fixed array of
+ * counters. Recording a value is a few integer operations and relaxed
+ * atomic stores, nothing is allocated or locked.
+ *
+ * A single thread records values, any thread can read the statistics
+ * while it does.
+ */
+class latencyhistogram: boost::noncopyable {
+public:
+	typedef boost::uint64_t		value_type;
+	typedef std::size_t			size_type;
+
+	/// \brief Bits of the sub-buckets of a power of two
+	static const unsigned	subbits		= 4;
+	static const unsigned	subbuckets	= 1 << subbits;
+	static const unsigned	buckets		= (64 - subbits + 1)*subbuckets;
+
+	latencyhistogram() {this->reset();}
+
+	/// \brief Count a latency, negative latencies are counted as 0. Called by the writer only
+	void record(boost::int64_t v) {
+		value_type u = v > 0 ? value_type(v) : 0;
+		increment(m_counts[index(u)],1);
+		increment(m_count,1);
+		increment(m_sum,u);
+		if(u > m_max.load(boost::memory_order_relaxed))
+			m_max.store(u,boost::memory_order_relaxed);
+		if(u < m_min.load(boost::memory_order_relaxed))
+			m_min.store(u,boost::memory_order_relaxed);
+	}
+
+	value_type	count()	const {return m_count.load(boost::memory_order_relaxed);}
+	value_type	max()	const {return m_max.load(boost::memory_order_relaxed);}
+	value_type	min()	const {return this->count() ? m_min.load(boost::memory_order_relaxed) : 0;}
+	double		mean()	const {
+		value_type n = this->count();
+		return n ? double(m_sum.load(boost::memory_order_relaxed))/n : 0.;
+	}
+
+	/// \brief Latency not exceeded by p percent of the values, within the bucket precision
+	value_type	percentile(double p) const;
+
+	/// \brief Append the upper bound and the count of the non empty buckets, return their number
+	size_type	values(std::vector<value_type>& bounds, std::vector<value_type>& counts) const;
+
+	/// \brief Forget the values recorded, values recorded meanwhile may be lost
+	void		reset();
+
+	/// \brief Bucket of value u
+	static unsigned		index(value_type u) {
+		if(u < subbuckets)
+			return unsigned(u);
+		unsigned m = log2(u);
+		return (m - subbits + 1)*subbuckets + unsigned(u >> (m - subbits)) - subbuckets;
+	}
+	/// \brief Smallest value of bucket i
+	static value_type	lower(unsigned i) {
+		if(i < subbuckets)
+			return i;
+		unsigned k = i/subbuckets;
+		return value_type(subbuckets + i % subbuckets) << (k - 1);
+	}
+	/// \brief Largest value of bucket i
+	static value_type	upper(unsigned i) {
+		return i + 1 < buckets ? lower(i + 1) - 1 : std::numeric_limits<value_type>::max();
+	}
+private:
+	typedef boost::atomic<value_type>	counter_type;
+
+	counter_type	m_counts[buckets];
+	counter_type	m_count;
+	counter_type	m_sum;
+	counter_type	m_min;
+	counter_type	m_max;
+
+	// Single writer, a load and a store are enough and do not lock the bus
+	static void increment(counter_type& c, value_type n) {
+		c.store(c.load(boost::memory_order_relaxed) + n,boost::memory_order_relaxed);
+	}
+
+	static unsigned log2(value_type u) {
+#ifdef __GNUC__
+		return 63 - __builtin_clzll(u);
+#else
+		unsigned m = 0;
+		while(u >>= 1)
+			++m;
+		return m;
+#endif
+	}
+};
+
+
+inline latencyhistogram::value_type latencyhistogram::percentile(double p) const {
+	QM_REQUIRE(p >= 0 && p <= 100,"Percentile must be between 0 and 100");
+	value_type total = 0;
+	for(unsigned i=0;i<buckets;++i)
+		total += m_counts[i].load(boost::memory_order_relaxed);
+	if(!total)
+		return 0;
+	value_type target = std::max(value_type(1),value_type(p*total/100 + 0.5));
+	value_type seen   = 0;
+	for(unsigned i=0;i<buckets;++i) {
+		seen += m_counts[i].load(boost::memory_order_relaxed);
+		if(seen >= target)
+			return std::min(upper(i),this->max());
+	}
+	return this->max();
+}
+
+inline latencyhistogram::size_type
+latencyhistogram::values(std::vector<value_type>& bounds, std::vector<value_type>& counts) const {
+	size_type n = 0;
+	for(unsigned i=0;i<buckets;++i) {
+		value_type c = m_counts[i].load(boost::memory_order_relaxed);
+		if(!c)
+			continue;
+		bounds.push_back(upper(i));
+		counts.push_back(c);
+		++n;
+	}
+	return n;
+}
+
+inline void latencyhistogram::reset() {
+	for(unsigned i=0;i<buckets;++i)
+		m_counts[i].store(0,boost::memory_order_relaxed);
+	m_count.store(0,boost::memory_order_relaxed);
+	m_sum.store(0,boost::memory_order_relaxed);
+	m_min.store(std::numeric_limits<value_type>::max(),boost::memory_order_relaxed);
+	m_max.store(0,boost::memory_order_relaxed);
+}
+
+
+}}
+
+
+#endif	//	__THREADS_LATENCY_JFLIB_HPP__
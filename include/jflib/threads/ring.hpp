@@ -0,0 +1,170 @@
+/**
+ * \brief Bounded lock-free ring buffers for handing values between threads
+ */
+
+#ifndef __THREADS_RING_JFLIB_HPP__
+#define __THREADS_RING_JFLIB_HPP__
+
+#include <jflib/error.hpp>
+
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+
+
+namespace jflib { namespace threads {
+
+
+namespace {
+
+	/// \brief Smallest power of two not less than n
+	inline std::size_t ringcapacity(std::size_t n) {
+		QM_REQUIRE(n > 0,"Ring capacity must be positive");
+		std::size_t c = 1;
+		while(c < n)
+			c <<= 1;
+		return c;
+	}
+
+}
+
+/// \brief Size of a cache line, the producer and consumer positions are kept apart
+#ifndef QM_CACHE_LINE
+#define QM_CACHE_LINE 64
+#endif
+
+
+/**
+ * \brief Single producer single consumer ring
+ *
+ * push is called by one thread and pop by another, neither blocks nor
+ * takes a lock. The capacity is rounded up to a power of two.
+ */
+template<class T>
+class spscring: boost::noncopyable {
+public:
+	typedef T				value_type;
+	typedef std::size_t		size_type;
+
+	explicit spscring(size_type capacity):m_mask(ringcapacity(capacity) - 1),
+				m_values(m_mask + 1),m_head(0),m_tail(0){}
+
+	size_type capacity() const {return m_mask + 1;}
+	/// \brief Number of values in the ring, exact only when called by the producer or consumer
+	size_type size() const {
+		return m_tail.load(boost::memory_order_acquire) - m_head.load(boost::memory_order_acquire);
+	}
+	bool empty() const {return this->size() == 0;}
+
+	/// \brief Append a value, return false if the ring is full
+	bool push(const value_type& v) {
+		size_type t = m_tail.load(boost::memory_order_relaxed);
+		if(t - m_head.load(boost::memory_order_acquire) > m_mask)
+			return false;
+		m_values[t & m_mask] = v;
+		m_tail.store(t + 1,boost::memory_order_release);
+		return true;
+	}
+
+	/// \brief Take the oldest value, return false if the ring is empty
+	bool pop(value_type& v) {
+		size_type h = m_head.load(boost::memory_order_relaxed);
+		if(h == m_tail.load(boost::memory_order_acquire))
+			return false;
+		v = m_values[h & m_mask];
+		m_values[h & m_mask] = value_type();
+		m_head.store(h + 1,boost::memory_order_release);
+		return true;
+	}
+private:
+	const size_type				m_mask;
+	std::vector<value_type>		m_values;
+	char						m_pad0[QM_CACHE_LINE];
+	boost::atomic<size_type>	m_head;
+	char						m_pad1[QM_CACHE_LINE];
+	boost::atomic<size_type>	m_tail;
+	char						m_pad2[QM_CACHE_LINE];
+};
+
+
+/**
+ * \brief Multiple producers single consumer ring
+ *
+ * Any thread can push, a single thread pops. Each slot carries a sequence
+ * number so that producers claim slots with a compare and swap and the
+ * consumer sees a value only once it is fully written.
+ */
+template<class T>
+class mpscring: boost::noncopyable {
+public:
+	typedef T				value_type;
+	typedef std::size_t		size_type;
+
+	explicit mpscring(size_type capacity):m_mask(ringcapacity(capacity) - 1),
+				m_slots(new slot[m_mask + 1]),m_head(0),m_tail(0) {
+		for(size_type i=0;i<=m_mask;++i)
+			m_slots[i].sequence.store(i,boost::memory_order_relaxed);
+	}
+	~mpscring() {delete [] m_slots;}
+
+	size_type capacity() const {return m_mask + 1;}
+	/// \brief Values pushed, or being pushed, and not taken yet, exact only when called by the consumer
+	size_type size() const {
+		return m_tail.load(boost::memory_order_acquire) - m_head.load(boost::memory_order_relaxed);
+	}
+	bool empty() const {
+		size_type h = m_head.load(boost::memory_order_relaxed);
+		return m_slots[h & m_mask].sequence.load(boost::memory_order_acquire) != h + 1;
+	}
+
+	/// \brief Append a value, return false if the ring is full
+	bool push(const value_type& v) {
+		size_type t = m_tail.load(boost::memory_order_relaxed);
+		for(;;) {
+			slot& s = m_slots[t & m_mask];
+			size_type seq = s.sequence.load(boost::memory_order_acquire);
+			if(seq == t) {
+				if(m_tail.compare_exchange_weak(t,t + 1,boost::memory_order_relaxed)) {
+					s.value = v;
+					s.sequence.store(t + 1,boost::memory_order_release);
+					return true;
+				}
+			}
+			else if(seq < t)
+				return false;
+			else
+				t = m_tail.load(boost::memory_order_relaxed);
+		}
+	}
+
+	/// \brief Take the oldest value, return false if the ring is empty
+	bool pop(value_type& v) {
+		size_type h = m_head.load(boost::memory_order_relaxed);
+		slot& s = m_slots[h & m_mask];
+		if(s.sequence.load(boost::memory_order_acquire) != h + 1)
+			return false;
+		v = s.value;
+		s.value = value_type();
+		s.sequence.store(h + m_mask + 1,boost::memory_order_release);
+		m_head.store(h + 1,boost::memory_order_relaxed);
+		return true;
+	}
+private:
+	struct slot {
+		boost::atomic<size_type>	sequence;
+		value_type					value;
+	};
+	const size_type				m_mask;
+	slot*						m_slots;
+	char						m_pad0[QM_CACHE_LINE];
+	boost::atomic<size_type>	m_head;
+	char						m_pad1[QM_CACHE_LINE];
+	boost::atomic<size_type>	m_tail;
+	char						m_pad2[QM_CACHE_LINE];
+};
+
+
+}}
+
+
+#endif	//	__THREADS_RING_JFLIB_HPP__
@@ -0,0 +1,70 @@
+/**
+ * \brief Pool of native worker threads
+ */
+
+#ifndef __THREADS_THREADPOOL_JFLIB_HPP__
+#define __THREADS_THREADPOOL_JFLIB_HPP__
+
+#include <jflib/error.hpp>
+
+#include <deque>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+
+namespace jflib { namespace threads {
+
+
+/**
+ * \brief Fixed size pool of native worker threads
+ *
+ * Tasks are run in submission order by the first available worker.
+ * Exceptions thrown by a task are swallowed, tasks which need to report
+ * errors should catch them. The destructor runs the tasks already queued
+ * and joins the workers.
+ */
+class threadpool: boost::noncopyable {
+public:
+	typedef boost::function<void ()>		task_type;
+	typedef boost::shared_ptr<threadpool>	threadpool_ptr;
+	typedef std::size_t						size_type;
+
+	/// \brief Pool with workers threads, one per hardware thread if workers is 0
+	explicit threadpool(size_type workers = 0);
+	~threadpool();
+
+	void		submit(const task_type& task);
+
+	size_type	size()		const {return m_size;}
+	/// \brief Number of tasks waiting for a worker
+	size_type	pending()	const;
+
+	/// \brief The pool shared by the library, created on first use
+	static threadpool_ptr global();
+
+	/**
+	 * \brief Replace the shared pool with a pool of workers threads
+	 *
+	 * Tasks already submitted complete on the previous pool.
+	 */
+	static void resize(size_type workers);
+private:
+	mutable boost::mutex		m_mutex;
+	boost::condition_variable	m_ready;
+	std::deque<task_type>		m_tasks;
+	boost::thread_group			m_workers;
+	size_type					m_size;
+	bool						m_stop;
+
+	void run();
+};
+
+
+}}
+
+
+#endif	//	__THREADS_THREADPOOL_JFLIB_HPP__
@@ -0,0 +1,224 @@
+/**
+ * \brief Bulk alignment of several timeseries on the union of their keys
+ */
+
+#ifndef __TIMESERIES_ALIGN_HPP__
+#define __TIMESERIES_ALIGN_HPP__
+
+#include <jflib/jflib.hpp>
+#include <jflib/timeseries/structures.hpp>
+#include <jflib/timeseries/traits/base.hpp>
+
+#include <queue>
+#include <vector>
+#include <algorithm>
+
+
+namespace jflib { namespace timeseries {
+
+
+namespace traits {
+
+template<bool> struct AlignRow;
+
+/**
+ * \brief Write a single-series value at column c of row r of a sink
+ */
+template<>
+struct AlignRow<false> {
+	template<class V, class S>
+	static void copy(const V& v, S& sink, std::size_t r, std::size_t c) {
+		sink.data(r,c) = v;
+		sink.mask(r,c) = 1;
+	}
+};
+
+/**
+ * \brief Write a multi-series row starting at column c of row r of a sink
+ */
+template<>
+struct AlignRow<true> {
+	template<class V, class S>
+	static void copy(const V& v, S& sink, std::size_t r, std::size_t c) {
+		typename V::const_mask_iterator m = v.mask_begin();
+		for(typename V::const_iterator d=v.begin();d!=v.end();++d) {
+			sink.data(r,c) = *d;
+			sink.mask(r,c) = *m;
+			++m;
+			++c;
+		}
+	}
+};
+
+}
+
+
+namespace {
+
+	template<class M>
+	struct alignmatrixsink {
+		alignmatrixsink(M& m):m_support(m){}
+		typename M::matrix_data_type::reference data(std::size_t r, std::size_t c) {return m_support.data(r,c);}
+		typename M::matrix_mask_type::reference mask(std::size_t r, std::size_t c) {return m_support.mask(r,c);}
+	private:
+		M&	m_support;
+	};
+
+	template<class R>
+	struct alignrowsink {
+		typedef typename R::value_type					row_type;
+		alignrowsink(R& rows):m_rows(rows){}
+		typename row_type::value_type& data(std::size_t r, std::size_t c) {return m_rows[r].data()[c];}
+		typename row_type::value_mask_type& mask(std::size_t r, std::size_t c) {return m_rows[r].mask()[c];}
+	private:
+		R&	m_rows;
+	};
+
+}
+
+
+/**
+ * \brief Align N sorted timeseries on the union of their keys
+ *
+ * The union of keys is obtained with a k-way heap merge of the input series,
+ * the output is then allocated once and filled column by column with a linear
+ * walk of each input. Missing values are masked.
+ * Adding N series of length T costs O(N T log N) rather than the
+ * O(N T log T) of repeated AddTs calls.
+ */
+template<class TS>
+class tsalign {
+public:
+	typedef TS												tstype;
+	typedef typename tstype::key_type						key_type;
+	typedef typename tstype::numtype						numtype;
+	typedef typename tstype::const_iterator					const_iterator;
+	typedef std::size_t										size_type;
+	typedef std::vector<key_type>							keys_type;
+
+	static const bool multipleseries = tstype::multipleseries;
+
+	tsalign():m_series(0){}
+
+	/// \brief Add a series to the alignment
+	void add(const tstype& ts) {
+		m_ts.push_back(ts);
+		m_series += ts.series();
+		m_keys.clear();
+	}
+
+	size_type inputs() const {return m_ts.size();}
+	size_type series() const {return m_series;}
+	size_type size()   const {this->merge(); return m_keys.size();}
+
+	/// \brief The sorted union of keys
+	const keys_type& keys() const {this->merge(); return m_keys;}
+
+	/// \brief Build a timeseries of family 1 with one column per series
+	template<class MTag>
+	typename traits::ts<key_type,numtype,MTag>::type
+	tomatrix() const {
+		typedef typename traits::ts<key_type,numtype,MTag>::type	tsmat;
+		typedef typename tsmat::iterator							iterator;
+		typedef typename tsmat::matrix_type							support_type;
+		BOOST_STATIC_ASSERT(MTag::family == 1u);
+		this->merge();
+		size_type R = m_keys.size();
+		if(!R || !m_series) {
+			tsmat t;
+			return t;
+		}
+		tsmat ts(R,m_series);
+		support_type& su = *ts.support();
+		std::fill(su.data.data().begin(),su.data.data().end(),maskedvalue<numtype>::value());
+		std::fill(su.mask.data().begin(),su.mask.data().end(),0);
+		iterator it = ts.begin();
+		for(size_type r=0;r<R;++r)
+			it = ts.insertrow(it,r,m_keys[r]);
+		alignmatrixsink<support_type> sink(su);
+		this->fill(sink);
+		return ts;
+	}
+
+	/// \brief Build a timeseries vector map with one entry per series in each row
+	template<class VTag>
+	typename traits::ts<key_type,numtype,VTag>::type
+	tovector() const {
+		typedef typename traits::ts<key_type,numtype,VTag>::type	tsvec;
+		typedef typename tsvec::mapped_type							row_type;
+		typedef typename tsvec::value_type							value_type;
+		typedef std::vector<row_type>								rows_type;
+		BOOST_STATIC_ASSERT(VTag::family == 0u && VTag::multipleseries);
+		this->merge();
+		size_type R = m_keys.size();
+		tsvec ts;
+		if(!R || !m_series)
+			return ts;
+		rows_type rows;
+		rows.reserve(R);
+		for(size_type r=0;r<R;++r)
+			rows.push_back(row_type(m_series));
+		alignrowsink<rows_type> sink(rows);
+		this->fill(sink);
+		for(size_type r=0;r<R;++r)
+			ts.insert(ts.end(),value_type(m_keys[r],rows[r]));
+		return ts;
+	}
+
+private:
+	typedef std::pair<key_type,size_type>					heap_item;
+
+	struct heap_compare {
+		bool operator () (const heap_item& a, const heap_item& b) const {return b.first < a.first;}
+	};
+
+	typedef std::priority_queue<heap_item,std::vector<heap_item>,heap_compare>	heap_type;
+
+	std::vector<tstype>		m_ts;
+	size_type				m_series;
+	mutable keys_type		m_keys;
+
+	void merge() const {
+		if(!m_keys.empty() || m_ts.empty()) return;
+		size_type N = m_ts.size();
+		size_type T = 0;
+		std::vector<const_iterator> cur;
+		cur.reserve(N);
+		heap_type heap;
+		for(size_type i=0;i<N;++i) {
+			cur.push_back(m_ts[i].begin());
+			T = std::max(T,size_type(m_ts[i].size()));
+			if(cur[i] != m_ts[i].end())
+				heap.push(heap_item(cur[i]->first,i));
+		}
+		m_keys.reserve(T);
+		while(!heap.empty()) {
+			heap_item top = heap.top();
+			heap.pop();
+			if(m_keys.empty() || m_keys.back() < top.first)
+				m_keys.push_back(top.first);
+			size_type i = top.second;
+			if(++cur[i] != m_ts[i].end())
+				heap.push(heap_item(cur[i]->first,i));
+		}
+	}
+
+	template<class S>
+	void fill(S& sink) const {
+		size_type c = 0;
+		for(typename std::vector<tstype>::const_iterator ts=m_ts.begin();ts!=m_ts.end();++ts) {
+			size_type r = 0;
+			for(const_iterator it=ts->begin();it!=ts->end();++it) {
+				while(m_keys[r] < it->first) ++r;
+				traits::AlignRow<multipleseries>::copy(it->second,sink,r,c);
+			}
+			c += ts->series();
+		}
+	}
+};
+
+
+}}
+
+
+#endif	//	__TIMESERIES_ALIGN_HPP__
@@ -9,6 +9,7 @@
 #include <jflib/timeseries/masked/oper.hpp>
 #include <jflib/timeseries/dateselectors.hpp>
 #include <jflib/timeseries/traits/addts.hpp>
+#include <jflib/timeseries/align.hpp>
 #include <jflib/timeseries/econometric/base.hpp>
 #include <jflib/timeseries/expr.hpp>
 
@@ -0,0 +1,443 @@
+/**
+ * \brief Arrow C Data Interface for timeseries
+ *
+ * Timeseries are exported as a struct array with a key column and a
+ * float64 column per series, with validity bitmaps taken from the mask.
+ * Dates are date32, other keys int64 (see traits::keyordinal).
+ *
+ * Matrix timeseries are imported into a tsstore timeseries aliasing the
+ * foreign value buffers, which are released with the timeseries.
+ *
+ * See https://arrow.apache.org/docs/format/CDataInterface.html
+ */
+
+#ifndef __TIMESERIES_ARROW_HPP__
+#define __TIMESERIES_ARROW_HPP__
+
+#include <jflib/timeseries/store.hpp>
+#include <jflib/datetime/date.hpp>
+
+#include <boost/lexical_cast.hpp>
+
+
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+extern "C" {
+
+struct ArrowSchema {
+	// Array type description
+	const char* format;
+	const char* name;
+	const char* metadata;
+	int64_t flags;
+	int64_t n_children;
+	struct ArrowSchema** children;
+	struct ArrowSchema* dictionary;
+
+	// Release callback
+	void (*release)(struct ArrowSchema*);
+	// Opaque producer-specific data
+	void* private_data;
+};
+
+struct ArrowArray {
+	// Array data description
+	int64_t length;
+	int64_t null_count;
+	int64_t offset;
+	int64_t n_buffers;
+	int64_t n_children;
+	const void** buffers;
+	struct ArrowArray** children;
+	struct ArrowArray* dictionary;
+
+	// Release callback
+	void (*release)(struct ArrowArray*);
+	// Opaque producer-specific data
+	void* private_data;
+};
+
+}
+
+#endif	//	ARROW_C_DATA_INTERFACE
+
+
+namespace jflib { namespace timeseries { namespace arrow {
+
+
+	typedef std::size_t		size_type;
+
+	/// \brief Arrow type of a key
+	template<class Key>
+	struct arrowkey {
+		typedef boost::int64_t	type;
+		static const char* format() {return "l";}
+		static type apply(const Key& k) {return traits::keyordinal<Key>::apply(k);}
+		static Key  key(type v)			{return traits::keyordinal<Key>::key(v);}
+	};
+
+	template<>
+	struct arrowkey<qdate> {
+		typedef boost::int32_t	type;
+		static const char* format() {return "tdD";}
+		static type  apply(const qdate& k) {return k.unixdays();}
+		static qdate key(type v)			{return qdate::fromunixdays(v);}
+	};
+
+
+namespace {
+
+	/**
+	 * \brief Buffers and descriptions of an exported array
+	 *
+	 * Shared by the parent and the children, each holding a reference,
+	 * since consumers can move children out of the parent.
+	 */
+	struct exportstate {
+		typedef boost::shared_ptr<exportstate>	pointer;
+
+		std::vector<std::string>				names;
+		std::vector<std::vector<char> >			buffers;
+		std::vector<std::vector<const void*> >	pointers;
+		std::vector<ArrowSchema*>				schemas;
+		std::vector<ArrowArray*>				arrays;
+		std::vector<ArrowSchema>				schemastore;
+		std::vector<ArrowArray>					arraystore;
+		boost::shared_ptr<void>					keepalive;
+	};
+
+	template<class A>
+	void releasestruct(A* a) {
+		delete static_cast<exportstate::pointer*>(a->private_data);
+		a->release = 0;
+	}
+
+	template<class A>
+	void releaseparent(A* a) {
+		for(int64_t i=0;i<a->n_children;++i)
+			if(a->children[i]->release)
+				a->children[i]->release(a->children[i]);
+		releasestruct(a);
+	}
+
+	inline void packbits(const std::vector<unsigned char>& valid, std::vector<char>& bits) {
+		bits.assign((valid.size() + 7)/8,0);
+		for(size_type i=0;i<valid.size();++i)
+			if(valid[i])
+				bits[i/8] |= char(1 << (i % 8));
+	}
+
+	/// \brief Collect keys, values and masks column by column
+	template<class TS, unsigned F, bool M>
+	struct columns;
+
+	template<class TS, bool M>
+	struct columns<TS,1u,M> {
+		typedef typename TS::matrix_data_type	matrix_data_type;
+		static size_type series(const TS& ts) {return ts.series();}
+		static bool contiguous(const TS&) {
+			return boost::is_same<typename matrix_data_type::orientation_category,
+								  boost::numeric::ublas::column_major_tag>::value;
+		}
+		template<class K>
+		static void keys(const TS& ts, K* k) {
+			for(typename TS::const_key_iterator it=ts.key_begin(); it!=ts.key_end(); ++it)
+				*k++ = arrowkey<typename TS::key_type>::apply(*it);
+		}
+		static const double* column(const TS& ts, size_type c) {
+			range rows = ts.index().rows();
+			return &ts.support()->data(rows.start(),ts.index().cols().start() + c);
+		}
+		static void values(const TS& ts, size_type c, double* v, unsigned char* m) {
+			typename TS::matrix_data_range d = ts.data_range();
+			typename TS::matrix_mask_range k = ts.mask_range();
+			for(size_type r=0;r<ts.size();++r) {
+				v[r] = d(r,c);
+				m[r] = k(r,c) ? 1 : 0;
+			}
+		}
+	private:
+		typedef traits::range	range;
+	};
+
+	template<class TS>
+	struct columns<TS,0u,true> {
+		static size_type series(const TS& ts) {return ts.series();}
+		static bool contiguous(const TS&) {return false;}
+		template<class K>
+		static void keys(const TS& ts, K* k) {
+			for(typename TS::const_iterator it=ts.begin(); it!=ts.end(); ++it)
+				*k++ = arrowkey<typename TS::key_type>::apply(it->first);
+		}
+		static const double* column(const TS&, size_type) {return 0;}
+		static void values(const TS& ts, size_type c, double* v, unsigned char* m) {
+			for(typename TS::const_iterator it=ts.begin(); it!=ts.end(); ++it) {
+				*v++ = it->second.data()[c];
+				*m++ = it->second.mask()[c] ? 1 : 0;
+			}
+		}
+	};
+
+	template<class TS>
+	struct columns<TS,0u,false> {
+		static size_type series(const TS&) {return 1;}
+		static bool contiguous(const TS&) {return false;}
+		template<class K>
+		static void keys(const TS& ts, K* k) {
+			for(typename TS::const_iterator it=ts.begin(); it!=ts.end(); ++it)
+				*k++ = arrowkey<typename TS::key_type>::apply(it->first);
+		}
+		static const double* column(const TS&, size_type) {return 0;}
+		static void values(const TS& ts, size_type, double* v, unsigned char* m) {
+			for(typename TS::const_iterator it=ts.begin(); it!=ts.end(); ++it) {
+				*v++ = it->second;
+				*m++ = 1;
+			}
+		}
+	};
+
+	template<class TS>
+	struct keepalive {
+		template<class T>
+		static boost::shared_ptr<void> apply(const T& ts, boost::mpl::true_)  {return ts.support();}
+		template<class T>
+		static boost::shared_ptr<void> apply(const T&, boost::mpl::false_) {return boost::shared_ptr<void>();}
+	};
+
+	template<class TS>
+	boost::shared_ptr<void> support(const TS& ts) {
+		return keepalive<TS>::apply(ts,boost::mpl::bool_<TS::family == 1u>());
+	}
+
+}
+
+
+	/**
+	 * \brief Export a timeseries into schema and array, which the caller
+	 * must release
+	 *
+	 * Column-major value matrices (see tsstore) are exported without
+	 * copying and stay alive until the array is released, other values
+	 * are copied.
+	 */
+	template<class TS>
+	void exportts(const TS& ts, ArrowSchema* schema, ArrowArray* array) {
+		typedef columns<TS,TS::family,TS::multipleseries>		columns_type;
+		typedef arrowkey<typename TS::key_type>					key_traits;
+		typedef typename key_traits::type						key_type;
+
+		size_type N = ts.size();
+		size_type S = columns_type::series(ts);
+		size_type C = S + 1;
+		bool contiguous = columns_type::contiguous(ts);
+		exportstate::pointer state(new exportstate);
+		exportstate& st = *state;
+		st.names.push_back("date");
+		for(size_type c=0;c<S;++c)
+			st.names.push_back(boost::lexical_cast<std::string>(c));
+		st.names.push_back(ts.name());
+		st.schemastore.resize(C + 1);
+		st.arraystore.resize(C + 1);
+		st.pointers.resize(C + 1);
+		st.buffers.resize(2*C);
+		if(contiguous)
+			st.keepalive = support(ts);
+
+		// key column
+		st.buffers[1].resize(N*sizeof(key_type));
+		if(N)
+			columns_type::keys(ts,reinterpret_cast<key_type*>(&st.buffers[1][0]));
+		std::vector<unsigned char> valid(N);
+		std::vector<int64_t> nulls(C,0);
+		for(size_type c=0;c<S;++c) {
+			std::vector<char>& values = st.buffers[2*(c+1) + 1];
+			values.resize(contiguous ? 0 : N*sizeof(double));
+			double* v = contiguous || !N ? 0 : reinterpret_cast<double*>(&values[0]);
+			std::vector<double> tmp(contiguous ? N : 0);
+			columns_type::values(ts,c,contiguous ? (N ? &tmp[0] : 0) : v,N ? &valid[0] : 0);
+			for(size_type r=0;r<N;++r)
+				nulls[c+1] += valid[r] ? 0 : 1;
+			if(nulls[c+1])
+				packbits(valid,st.buffers[2*(c+1)]);
+		}
+
+		for(size_type c=0;c<C;++c) {
+			ArrowSchema& cs = st.schemastore[c];
+			ArrowArray&  ca = st.arraystore[c];
+			std::vector<const void*>& p = st.pointers[c];
+			p.resize(2);
+			p[0] = nulls[c] ? &st.buffers[2*c][0] : 0;
+			if(c == 0 || !contiguous)
+				p[1] = N ? &st.buffers[2*c+1][0] : 0;
+			else
+				p[1] = N ? columns_type::column(ts,c-1) : 0;
+			cs.format		= c ? "g" : key_traits::format();
+			cs.name			= st.names[c].c_str();
+			cs.metadata		= 0;
+			cs.flags		= c ? ARROW_FLAG_NULLABLE : 0;
+			cs.n_children	= 0;
+			cs.children		= 0;
+			cs.dictionary	= 0;
+			cs.release		= releasestruct<ArrowSchema>;
+			cs.private_data	= new exportstate::pointer(state);
+			ca.length		= N;
+			ca.null_count	= nulls[c];
+			ca.offset		= 0;
+			ca.n_buffers	= 2;
+			ca.n_children	= 0;
+			ca.buffers		= &p[0];
+			ca.children		= 0;
+			ca.dictionary	= 0;
+			ca.release		= releasestruct<ArrowArray>;
+			ca.private_data	= new exportstate::pointer(state);
+			st.schemas.push_back(&cs);
+			st.arrays.push_back(&ca);
+		}
+
+		st.pointers[C].assign(1,static_cast<const void*>(0));
+		schema->format			= "+s";
+		schema->name			= st.names[C].c_str();
+		schema->metadata		= 0;
+		schema->flags			= 0;
+		schema->n_children		= C;
+		schema->children		= &st.schemas[0];
+		schema->dictionary		= 0;
+		schema->release			= releaseparent<ArrowSchema>;
+		schema->private_data	= new exportstate::pointer(state);
+		array->length			= N;
+		array->null_count		= 0;
+		array->offset			= 0;
+		array->n_buffers		= 1;
+		array->n_children		= C;
+		array->buffers			= &st.pointers[C][0];
+		array->children			= &st.arrays[0];
+		array->dictionary		= 0;
+		array->release			= releaseparent<ArrowArray>;
+		array->private_data		= new exportstate::pointer(state);
+	}
+
+
+namespace {
+
+	/// \brief Imported schema and array, released with the last timeseries using them
+	struct importstate: boost::noncopyable {
+		importstate(ArrowSchema* s, ArrowArray* a):schema(*s),array(*a) {
+			s->release = 0;
+			a->release = 0;
+		}
+		~importstate() {
+			if(array.release)
+				array.release(&array);
+			if(schema.release)
+				schema.release(&schema);
+		}
+		ArrowSchema	schema;
+		ArrowArray	array;
+	};
+
+	/// \brief Keeps the imported arrays and the converted keys alive with the matrix
+	template<class M, class Key>
+	struct import_deleter {
+		import_deleter(boost::shared_ptr<importstate> s, boost::shared_ptr<std::vector<Key> > k):state(s),keys(k){}
+		void operator () (M* m) const {delete m;}
+		boost::shared_ptr<importstate>			state;
+		boost::shared_ptr<std::vector<Key> >	keys;
+	};
+
+	inline bool validbit(const void* bits, int64_t i) {
+		return !bits || (static_cast<const unsigned char*>(bits)[i/8] >> (i % 8)) & 1;
+	}
+
+}
+
+
+	/**
+	 * \brief Import a struct array of keys and float64 columns
+	 *
+	 * The schema and the array are moved into the result, their release
+	 * callbacks are called with the last timeseries using them. Value
+	 * buffers are aliased when all columns are adjacent in memory (always
+	 * the case for a single series), otherwise they are copied. Keys and
+	 * validity bitmaps are converted.
+	 *
+	 * The result is read-only, as its values may be foreign memory: it is
+	 * built over external keys, so that no row can be added and its numpy
+	 * views are not writeable.
+	 */
+	template<class Key>
+	typename traits::ts<Key,double,tsstore>::type importts(ArrowSchema* schema, ArrowArray* array) {
+		typedef typename traits::ts<Key,double,tsstore>::type	tstype;
+		typedef typename tstype::matrix_type					matrix_type;
+		typedef typename tstype::matrix_type_ptr				matrix_type_ptr;
+		typedef typename tstype::index_type						index_type;
+		typedef typename tstype::range							range;
+		typedef arrowkey<Key>									key_traits;
+		typedef typename key_traits::type						key_type;
+
+		QM_REQUIRE(schema->release && array->release,"Arrow schema or array already released");
+		boost::shared_ptr<importstate> state(new importstate(schema,array));
+		const ArrowSchema& s = state->schema;
+		const ArrowArray&  a = state->array;
+		QM_REQUIRE(std::string(s.format) == "+s","Expected an arrow struct array, got format " << s.format);
+		QM_REQUIRE(s.n_children >= 1 && a.n_children == s.n_children,"Arrow struct array has no key column");
+		QM_REQUIRE(std::string(s.children[0]->format) == key_traits::format(),
+				   "Expected keys of arrow format " << key_traits::format() << ", got " << s.children[0]->format);
+		QM_REQUIRE(a.length >= 0 && a.offset >= 0,"Invalid arrow array length " << a.length << " and offset " << a.offset);
+		const ArrowArray& ka = *a.children[0];
+		QM_REQUIRE(ka.null_count == 0,"Arrow keys cannot be null");
+
+		size_type N = a.length;
+		size_type S = s.n_children - 1;
+		size_type first = a.offset;
+		QM_REQUIRE(ka.length >= 0 && ka.offset >= 0 && size_type(ka.length) >= first + N,
+				   "Arrow key column shorter than the array");
+		QM_REQUIRE(N == 0 || ka.buffers[1],"Arrow key column has no data");
+		std::vector<const double*> cols(S);
+		for(size_type c=0;c<S;++c) {
+			const ArrowArray& ca = *a.children[c+1];
+			QM_REQUIRE(std::string(s.children[c+1]->format) == "g",
+					   "Expected float64 values, got arrow format " << s.children[c+1]->format);
+			QM_REQUIRE(ca.length >= 0 && ca.offset >= 0 && size_type(ca.length) >= first + N,
+					   "Arrow column shorter than the array");
+			QM_REQUIRE(N == 0 || ca.buffers[1],"Arrow column has no data");
+			cols[c] = static_cast<const double*>(ca.buffers[1]) + ca.offset + first;
+		}
+		bool adjacent = true;
+		for(size_type c=1;c<S && adjacent;++c)
+			adjacent = cols[c] == cols[0] + c*N;
+
+		// one key at least, so that the index is over external keys when N is 0
+		boost::shared_ptr<std::vector<Key> > keys(new std::vector<Key>(std::max<size_type>(N,1)));
+		const key_type* k = static_cast<const key_type*>(ka.buffers[1]) + ka.offset + first;
+		for(size_type r=0;r<N;++r)
+			(*keys)[r] = key_traits::key(k[r]);
+
+		matrix_type_ptr data(new matrix_type,import_deleter<matrix_type,Key>(state,keys));
+		data->data.resize(N,S,false);
+		data->mask.resize(N,S,false);
+		if(adjacent && S && N)
+			data->data.data().resize(N*S,const_cast<double*>(cols[0]));
+		for(size_type c=0;c<S;++c) {
+			const ArrowArray& ca = *a.children[c+1];
+			const void* bits = ca.null_count ? ca.buffers[0] : 0;
+			for(size_type r=0;r<N;++r) {
+				if(!adjacent)
+					data->data(r,c) = cols[c][r];
+				data->mask(r,c) = validbit(bits,ca.offset + first + r) ? 1 : 0;
+			}
+		}
+
+		index_type index(data,range(0,S),&(*keys)[0],N);
+		return tstype(std::string(s.name ? s.name : ""),data,index);
+	}
+
+
+}}}
+
+
+#endif	//	__TIMESERIES_ARROW_HPP__
@@ -0,0 +1,512 @@
+/**
+ * \brief Block codec for matrix timeseries
+ *
+ * Rows are grouped into blocks which are compressed independently:
+ *
+ * - keys, as integers (see traits::keyordinal), are encoded with
+ *   zig-zag varints of their delta-of-delta
+ * - each series is encoded with the XOR scheme of Gorilla (Pelkonen et
+ *   al., VLDB 2015). Masked values are encoded as NaN and are masked
+ *   again when decoded.
+ *
+ * A directory with the first key, first row and offset of each block
+ * follows the blocks, so that any block can be decoded on its own.
+ * The same bytes are used in memory and on disk.
+ */
+
+#ifndef __TIMESERIES_CODEC_HPP__
+#define __TIMESERIES_CODEC_HPP__
+
+#include <jflib/timeseries/shared.hpp>
+
+#include <limits>
+#include <vector>
+
+
+namespace jflib { namespace timeseries { namespace codec {
+
+
+	typedef boost::uint64_t		word_type;
+
+
+namespace {
+
+	inline word_type zigzag(boost::int64_t v)	{return (word_type(v) << 1) ^ word_type(v >> 63);}
+	inline boost::int64_t unzigzag(word_type v)	{return boost::int64_t(v >> 1) ^ -boost::int64_t(v & 1);}
+
+	inline word_type dbits(double v)			{word_type w; std::memcpy(&w,&v,sizeof(w)); return w;}
+	inline double    dvalue(word_type w)		{double v; std::memcpy(&v,&w,sizeof(v)); return v;}
+
+#ifdef __GNUC__
+	inline unsigned clz(word_type w)			{return w ? __builtin_clzll(w) : 64;}
+	inline unsigned ctz(word_type w)			{return w ? __builtin_ctzll(w) : 64;}
+#else
+	inline unsigned clz(word_type w) {
+		unsigned n = 64;
+		for(;w;w>>=1)
+			--n;
+		return n;
+	}
+	inline unsigned ctz(word_type w) {
+		if(!w)
+			return 64;
+		unsigned n = 0;
+		for(;!(w & 1);w>>=1)
+			++n;
+		return n;
+	}
+#endif
+
+	inline void putvarint(std::vector<unsigned char>& out, word_type v) {
+		while(v >= 0x80) {
+			out.push_back(static_cast<unsigned char>(v | 0x80));
+			v >>= 7;
+		}
+		out.push_back(static_cast<unsigned char>(v));
+	}
+
+	inline word_type getvarint(const unsigned char*& p) {
+		word_type v = 0;
+		for(unsigned s=0;;s+=7) {
+			unsigned char b = *p++;
+			v |= word_type(b & 0x7f) << s;
+			if(!(b & 0x80))
+				return v;
+		}
+	}
+
+	/// \brief Most significant bit first writer
+	class bitwriter {
+	public:
+		bitwriter(std::vector<unsigned char>& out):m_out(out),m_acc(0),m_bits(0){}
+		void write(word_type v, unsigned n) {
+			for(;n;) {
+				unsigned k = std::min(n,8u - m_bits);
+				n -= k;
+				m_acc = (m_acc << k) | ((v >> n) & ((1u << k) - 1));
+				m_bits += k;
+				if(m_bits == 8) {
+					m_out.push_back(static_cast<unsigned char>(m_acc));
+					m_acc  = 0;
+					m_bits = 0;
+				}
+			}
+		}
+		/// \brief Pad the last byte with zeros
+		void flush() {
+			if(m_bits)
+				this->write(0,8 - m_bits);
+		}
+	private:
+		std::vector<unsigned char>&	m_out;
+		unsigned					m_acc;
+		unsigned					m_bits;
+	};
+
+	class bitreader {
+	public:
+		bitreader(const unsigned char* p):m_p(p),m_acc(0),m_bits(0){}
+		word_type read(unsigned n) {
+			word_type v = 0;
+			for(;n;) {
+				if(!m_bits) {
+					m_acc  = *m_p++;
+					m_bits = 8;
+				}
+				unsigned k = std::min(n,m_bits);
+				m_bits -= k;
+				n -= k;
+				v = (v << k) | ((m_acc >> m_bits) & ((1u << k) - 1));
+			}
+			return v;
+		}
+		bool bit() {return this->read(1) != 0;}
+		/// \brief Position after the last byte read
+		const unsigned char* position() const {return m_p;}
+	private:
+		const unsigned char*	m_p;
+		unsigned				m_acc;
+		unsigned				m_bits;
+	};
+
+	/// \brief XOR encoding of a sequence of doubles
+	class xorencoder {
+	public:
+		xorencoder(bitwriter& out):m_out(out),m_first(true),m_prev(0),m_lead(65),m_trail(0){}
+		void put(double v) {
+			word_type w = dbits(v);
+			if(m_first) {
+				m_out.write(w,64);
+				m_first = false;
+			}
+			else {
+				word_type x = w ^ m_prev;
+				if(!x)
+					m_out.write(0,1);
+				else {
+					unsigned lead  = std::min(clz(x),31u);
+					unsigned trail = ctz(x);
+					if(m_lead <= lead && m_trail <= trail) {
+						// fits in the previous window of meaningful bits
+						m_out.write(2,2);
+						m_out.write(x >> m_trail,64 - m_lead - m_trail);
+					}
+					else {
+						unsigned n = 64 - lead - trail;
+						m_out.write(3,2);
+						m_out.write(lead,5);
+						m_out.write(n & 63,6);
+						m_out.write(x >> trail,n);
+						m_lead  = lead;
+						m_trail = trail;
+					}
+				}
+			}
+			m_prev = w;
+		}
+	private:
+		bitwriter&	m_out;
+		bool		m_first;
+		word_type	m_prev;
+		unsigned	m_lead;
+		unsigned	m_trail;
+	};
+
+	class xordecoder {
+	public:
+		xordecoder(bitreader& in):m_in(in),m_first(true),m_prev(0),m_lead(0),m_trail(0){}
+		double get() {
+			if(m_first) {
+				m_prev  = m_in.read(64);
+				m_first = false;
+			}
+			else if(m_in.bit()) {
+				if(m_in.bit()) {
+					m_lead = m_in.read(5);
+					unsigned n = m_in.read(6);
+					m_trail = 64 - m_lead - (n ? n : 64);
+				}
+				m_prev ^= m_in.read(64 - m_lead - m_trail) << m_trail;
+			}
+			return dvalue(m_prev);
+		}
+	private:
+		bitreader&	m_in;
+		bool		m_first;
+		word_type	m_prev;
+		unsigned	m_lead;
+		unsigned	m_trail;
+	};
+
+}
+
+
+	/**
+	 * \brief Header of a compressed buffer
+	 *
+	 * The directory holds a blockentry for each block, offsets are from the
+	 * start of the buffer.
+	 */
+	struct header {
+		char				magic[8];
+		boost::uint32_t		version;
+		boost::uint32_t		endian;
+		boost::uint64_t		blocksize;
+		boost::uint64_t		rows;
+		boost::uint64_t		cols;
+		boost::uint64_t		blocks;
+		boost::uint64_t		directory;
+		boost::uint64_t		size;
+		char				name[64];
+	};
+
+	struct blockentry {
+		boost::int64_t		first;		///< ordinal of the first key
+		boost::uint64_t		row;		///< first row
+		boost::uint64_t		offset;		///< offset of the block
+	};
+
+	static const char			 magic[8]	= {'J','F','L','I','B','T','S','C'};
+	static const boost::uint32_t version	= 1;
+	static const boost::uint32_t endian		= 0x01020304;
+	static const std::size_t	 blocksize	= 1024;
+
+
+	/**
+	 * \brief Compressed matrix timeseries
+	 *
+	 * The bytes are held in memory (see encoder) or in a read-only mapped
+	 * file (see open). Copies share the bytes.
+	 */
+	template<class Key>
+	class compressed {
+	public:
+		typedef Key												key_type;
+		typedef std::size_t										size_type;
+		typedef traits::keyordinal<key_type>					ordinal;
+		typedef boost::shared_ptr<std::vector<unsigned char> >	buffer_type_ptr;
+
+		compressed(buffer_type_ptr buffer):m_buffer(buffer),m_base(&(*buffer)[0]) {this->check(buffer->size());}
+		compressed(shared::region_type_ptr region):
+			m_region(region),m_base(static_cast<const unsigned char*>(region->get_address())) {this->check(region->get_size());}
+
+		const header&		info()		const {return *reinterpret_cast<const header*>(m_base);}
+		std::string			name()		const {return std::string(this->info().name);}
+		size_type			size()		const {return this->info().rows;}
+		size_type			series()	const {return this->info().cols;}
+		size_type			blocks()	const {return this->info().blocks;}
+		/// \brief Number of compressed bytes
+		size_type			bytes()		const {return this->info().size;}
+		const unsigned char* data()		const {return m_base;}
+
+		const blockentry&	entry(size_type b) const {
+			return reinterpret_cast<const blockentry*>(m_base + this->info().directory)[b];
+		}
+
+		/**
+		 * \brief Decode block b into keys and row-major values
+		 *
+		 * keys and values are resized to the rows of the block.
+		 */
+		void decode(size_type b, std::vector<key_type>& keys, std::vector<double>& values) const {
+			QM_REQUIRE(b < this->blocks(),"Block out of bound");
+			const blockentry& e = this->entry(b);
+			size_type R = std::min<size_type>(this->info().blocksize,this->size() - e.row);
+			size_type C = this->series();
+			keys.resize(R);
+			values.resize(R*C);
+			const unsigned char* p = m_base + e.offset;
+			boost::int64_t k = e.first, delta = 0;
+			for(size_type r=0;r<R;++r) {
+				if(r) {
+					delta += unzigzag(getvarint(p));
+					k += delta;
+				}
+				keys[r] = ordinal::key(k);
+			}
+			for(size_type c=0;c<C;++c) {
+				bitreader in(p);
+				xordecoder dec(in);
+				for(size_type r=0;r<R;++r)
+					values[r*C + c] = dec.get();
+				p = in.position();
+			}
+		}
+
+		/// \brief Append all rows to a matrix timeseries, which is resized once
+		template<class TS>
+		void decode(TS& ts) const {
+			std::vector<key_type> keys;
+			std::vector<double>   values;
+			ts.reserve(ts.nextrow() + this->size(),this->series());
+			for(size_type b=0;b<this->blocks();++b) {
+				this->decode(b,keys,values);
+				ts.load(keys.begin(),keys.end(),values.begin(),this->series());
+			}
+		}
+
+		/// \brief Append the rows of dates in (start, end] to a matrix timeseries, decoding only their blocks
+		template<class TS>
+		void decode(const key_type& start, const key_type& end, TS& ts) const {
+			std::vector<key_type> keys;
+			std::vector<double>   values;
+			size_type C  = this->series();
+			size_type b0 = this->block(start);
+			size_type b1 = std::min(this->block(end) + 1,this->blocks());
+			if(b0 < b1) {
+				size_type last = b1 < this->blocks() ? this->entry(b1).row : this->size();
+				ts.reserve(ts.nextrow() + last - this->entry(b0).row,C);
+			}
+			for(size_type b=b0;b<this->blocks();++b) {
+				if(end < ordinal::key(this->entry(b).first))
+					break;
+				this->decode(b,keys,values);
+				typename std::vector<key_type>::iterator k0 = std::upper_bound(keys.begin(),keys.end(),start);
+				typename std::vector<key_type>::iterator k1 = std::upper_bound(k0,keys.end(),end);
+				ts.load(k0,k1,values.begin() + (k0 - keys.begin())*C,C);
+			}
+		}
+
+		/// \brief Write the bytes into a file which can be read with open
+		void save(const std::string& path) const {
+			std::ofstream out(path.c_str(),std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+			QM_REQUIRE(out,"Cannot create file " << path);
+			out.write(reinterpret_cast<const char*>(m_base),this->bytes());
+			QM_REQUIRE(out,"Cannot write file " << path);
+		}
+	private:
+		buffer_type_ptr				m_buffer;
+		shared::region_type_ptr		m_region;
+		const unsigned char*		m_base;
+
+		void check(size_type n) const {
+			QM_REQUIRE(n >= sizeof(header),"Not a compressed timeseries");
+			const header& h = this->info();
+			QM_REQUIRE(std::memcmp(h.magic,magic,sizeof(magic)) == 0,"Not a compressed timeseries");
+			QM_REQUIRE(h.version == version,"Unsupported compressed timeseries version " << h.version);
+			QM_REQUIRE(h.endian == endian,"Compressed timeseries written with a different byte order");
+			QM_REQUIRE(n >= h.size,"Compressed timeseries is truncated");
+		}
+
+		/// \brief Block of the first key greater than x
+		size_type block(const key_type& x) const {
+			size_type lo = 0, hi = this->blocks();
+			while(lo < hi) {
+				size_type mid = (lo + hi)/2;
+				if(x < ordinal::key(this->entry(mid).first))
+					hi = mid;
+				else
+					lo = mid + 1;
+			}
+			return lo ? lo - 1 : 0;
+		}
+	};
+
+
+	/**
+	 * \brief Streaming encoder
+	 *
+	 * Rows are buffered until a block is full and the block is then
+	 * compressed, so that memory holds a single uncompressed block.
+	 *
+	 * \code
+	 * codec::encoder<qdate> enc("prices",ts.series());
+	 * enc.append(ts);
+	 * codec::compressed<qdate> c = enc.finish();
+	 * \endcode
+	 */
+	template<class Key>
+	class encoder {
+	public:
+		typedef Key									key_type;
+		typedef std::size_t							size_type;
+		typedef traits::keyordinal<key_type>		ordinal;
+		typedef compressed<key_type>				compressed_type;
+
+		encoder(const std::string& name, size_type series, size_type bsize = blocksize):
+			m_name(name),m_series(series),m_blocksize(bsize),m_rows(0),
+			m_buffer(new std::vector<unsigned char>(sizeof(header))) {
+			QM_REQUIRE(bsize > 0,"Block size must be positive");
+			m_values.reserve(bsize*series);
+		}
+
+		size_type	size()	 const {return m_rows;}
+		size_type	series() const {return m_series;}
+
+		/// \brief Append a row, keys must be increasing
+		template<class ValIterator>
+		void push_back(const key_type& key, ValIterator values) {
+			QM_REQUIRE(m_keys.empty() ? (!m_rows || m_last < key) : m_keys.back() < key,
+					   "Keys must be appended in increasing order");
+			m_keys.push_back(key);
+			for(size_type c=0;c<m_series;++c,++values)
+				m_values.push_back(*values);
+			if(m_keys.size() == m_blocksize)
+				this->encodeblock();
+		}
+
+		/// \brief Append the rows of a matrix timeseries
+		template<class TS>
+		void append(const TS& ts) {
+			QM_REQUIRE(ts.series() == m_series,"Number of series does not match");
+			typename TS::matrix_data_range d = ts.data_range();
+			typename TS::matrix_mask_range m = ts.mask_range();
+			std::vector<double> row(m_series);
+			size_type r = 0;
+			for(typename TS::const_key_iterator k=ts.key_begin(); k!=ts.key_end(); ++k,++r) {
+				for(size_type c=0;c<m_series;++c)
+					row[c] = m(r,c) ? double(d(r,c)) : std::numeric_limits<double>::quiet_NaN();
+				this->push_back(*k,row.begin());
+			}
+		}
+
+		/// \brief Encode the last block and the directory. The encoder is then empty
+		compressed_type finish() {
+			if(!m_keys.empty())
+				this->encodeblock();
+			std::vector<unsigned char>& out = *m_buffer;
+			out.resize(shared::align(out.size()));
+			header h;
+			std::memset(&h,0,sizeof(header));
+			std::memcpy(h.magic,magic,sizeof(magic));
+			h.version	= version;
+			h.endian	= endian;
+			h.blocksize	= m_blocksize;
+			h.rows		= m_rows;
+			h.cols		= m_series;
+			h.blocks	= m_directory.size();
+			h.directory	= out.size();
+			h.size		= h.directory + h.blocks*sizeof(blockentry);
+			std::strncpy(h.name,m_name.c_str(),sizeof(h.name)-1);
+			out.resize(h.size);
+			std::memcpy(&out[0],&h,sizeof(header));
+			if(h.blocks)
+				std::memcpy(&out[h.directory],&m_directory[0],h.blocks*sizeof(blockentry));
+			compressed_type result(m_buffer);
+			m_buffer.reset(new std::vector<unsigned char>(sizeof(header)));
+			m_directory.clear();
+			m_rows = 0;
+			return result;
+		}
+	private:
+		std::string					m_name;
+		size_type					m_series;
+		size_type					m_blocksize;
+		size_type					m_rows;
+		key_type					m_last;
+		std::vector<key_type>		m_keys;
+		std::vector<double>			m_values;
+		std::vector<blockentry>		m_directory;
+		typename compressed_type::buffer_type_ptr	m_buffer;
+
+		void encodeblock() {
+			std::vector<unsigned char>& out = *m_buffer;
+			size_type R = m_keys.size();
+			blockentry e;
+			e.first  = ordinal::apply(m_keys.front());
+			e.row    = m_rows;
+			e.offset = out.size();
+			m_directory.push_back(e);
+			boost::int64_t prev = e.first, delta = 0;
+			for(size_type r=1;r<R;++r) {
+				boost::int64_t k = ordinal::apply(m_keys[r]);
+				putvarint(out,zigzag(k - prev - delta));
+				delta = k - prev;
+				prev  = k;
+			}
+			for(size_type c=0;c<m_series;++c) {
+				bitwriter bits(out);
+				xorencoder enc(bits);
+				for(size_type r=0;r<R;++r)
+					enc.put(m_values[r*m_series + c]);
+				bits.flush();
+			}
+			m_rows += R;
+			m_last  = m_keys.back();
+			m_keys.clear();
+			m_values.clear();
+		}
+	};
+
+
+	/// \brief Compress a matrix timeseries
+	template<class TS>
+	compressed<typename TS::key_type> encode(const TS& ts, std::size_t bsize = blocksize) {
+		encoder<typename TS::key_type> enc(ts.name(),ts.series(),bsize);
+		enc.append(ts);
+		return enc.finish();
+	}
+
+	/// \brief Map a file written by compressed::save, read-only
+	template<class Key>
+	compressed<Key> open(const std::string& path) {
+		namespace ip = boost::interprocess;
+		ip::file_mapping file(path.c_str(),ip::read_only);
+		return compressed<Key>(shared::region_type_ptr(new shared::region_type(file,ip::read_only)));
+	}
+
+
+}}}
+
+
+#endif	//	__TIMESERIES_CODEC_HPP__
@@ -0,0 +1,180 @@
+/**
+ * \brief Native CSV ingestion of dated series
+ *
+ * The file is memory-mapped and split into chunks on line boundaries,
+ * chunks are parsed in parallel on the jflib thread pool. Dates are
+ * YYYYMMDD or ISO (YYYY-MM-DD, a time after the date is ignored) and
+ * numbers are parsed without locale. Empty cells and NA, NaN, N/A,
+ * null are missing values.
+ */
+
+#ifndef __TIMESERIES_CSV_HPP__
+#define __TIMESERIES_CSV_HPP__
+
+#include <jflib/datetime/date.hpp>
+#include <jflib/error.hpp>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <boost/mpl/bool.hpp>
+#include <boost/iterator/counting_iterator.hpp>
+#include <boost/iterator/filter_iterator.hpp>
+#include <boost/iterator/transform_iterator.hpp>
+
+
+namespace jflib { namespace timeseries { namespace csv {
+
+
+	typedef std::size_t		size_type;
+
+	struct options {
+		options():delimiter(','),header(true),datecolumn(0),chunks(0){}
+
+		char		delimiter;
+		/// \brief The first line holds the series names
+		bool		header;
+		/// \brief Column of the dates, the other columns are series
+		size_type	datecolumn;
+		/// \brief Number of chunks parsed in parallel, 4 per worker if 0
+		size_type	chunks;
+	};
+
+	/**
+	 * \brief Dates and row-major values of a file, sorted by date
+	 *
+	 * Missing values are NaN.
+	 */
+	struct table {
+		table():series(0){}
+
+		size_type size() const {return keys.size();}
+
+		std::vector<std::string>	names;
+		std::vector<qdate>			keys;
+		std::vector<double>			values;
+		size_type					series;
+	};
+
+
+	/**
+	 * \brief Read a file
+	 *
+	 * Rows are sorted by date if the file is not, duplicate dates are an
+	 * error. Must not be called from a task of the thread pool.
+	 */
+	table read(const std::string& path, const options& opts = options());
+
+	/// \brief Parse a date at p, advancing p. Return false if there is no valid date
+	bool parsedate(const char*& p, const char* end, qdate& d);
+
+	/// \brief Parse a number at p, advancing p. Missing values are NaN. Return false if there is no number
+	bool parsedouble(const char*& p, const char* end, double& v);
+
+
+namespace {
+
+	typedef boost::counting_iterator<size_type>		rowiterator;
+
+	/// \brief Row r of a table as a masked row of a map timeseries. NaN values are masked
+	template<class V>
+	struct tablerow {
+		typedef V			result_type;
+		tablerow(const table& t):m_table(t){}
+		result_type operator () (size_type r) const {
+			size_type S = m_table.series;
+			result_type row(S);
+			for(size_type c=0;c<S;++c) {
+				double x = m_table.values[r*S + c];
+				row.data()[c] = x;
+				row.mask()[c] = x == x ? 1 : 0;
+			}
+			return row;
+		}
+	private:
+		const table&	m_table;
+	};
+
+	/// \brief Key of row r of a table
+	struct tablekey {
+		typedef const qdate&	result_type;
+		tablekey(const table& t):m_table(t){}
+		result_type operator () (size_type r) const {return m_table.keys[r];}
+	private:
+		const table&	m_table;
+	};
+
+	/// \brief Value of row r in a column of a table
+	struct tablevalue {
+		typedef double			result_type;
+		tablevalue(const table& t, size_type c):m_table(t),m_column(c){}
+		result_type operator () (size_type r) const {return m_table.values[r*m_table.series + m_column];}
+	private:
+		const table&	m_table;
+		size_type		m_column;
+	};
+
+	/// \brief Rows with a value in a column of a table
+	struct notmissing {
+		notmissing(const table& t, size_type c):m_value(t,c){}
+		bool operator () (size_type r) const {double x = m_value(r); return x == x;}
+	private:
+		tablevalue		m_value;
+	};
+
+	template<class TS, unsigned F, bool M>
+	struct builder;
+
+	/// \brief Matrix timeseries, loaded in bulk. NaN values are masked
+	template<class TS, bool M>
+	struct builder<TS,1u,M> {
+		static void apply(const table& t, TS& ts, size_type) {
+			ts.load(t.keys.begin(),t.keys.end(),t.values.begin(),t.series);
+		}
+	};
+
+	/// \brief Map timeseries with multiple series, rows are built while they are loaded
+	template<class TS>
+	struct builder<TS,0u,true> {
+		typedef typename TS::mapped_type	mapped_type;
+		static void apply(const table& t, TS& ts, size_type) {
+			QM_REQUIRE(ts.empty() || ts.back().first < t.keys.front(),"Dates must be after the last date of the timeseries");
+			ts.load(t.keys.begin(),t.keys.end(),boost::make_transform_iterator(rowiterator(0),tablerow<mapped_type>(t)));
+		}
+	};
+
+	/// \brief Map timeseries of a single column. Missing values are not inserted
+	template<class TS>
+	struct builder<TS,0u,false> {
+		static void apply(const table& t, TS& ts, size_type column) {
+			QM_REQUIRE(column < t.series,"Column " << column << " out of bound");
+			QM_REQUIRE(ts.empty() || ts.back().first < t.keys.front(),"Dates must be after the last date of the timeseries");
+			notmissing valid(t,column);
+			boost::filter_iterator<notmissing,rowiterator> first(valid,rowiterator(0),rowiterator(t.size()));
+			boost::filter_iterator<notmissing,rowiterator> last(valid,rowiterator(t.size()),rowiterator(t.size()));
+			ts.load(boost::make_transform_iterator(first,tablekey(t)),
+					boost::make_transform_iterator(last,tablekey(t)),
+					boost::make_transform_iterator(first,tablevalue(t,column)));
+		}
+	};
+
+}
+
+
+	/**
+	 * \brief Append a table to a timeseries
+	 *
+	 * The values go from the table into the timeseries without another
+	 * copy. Single series timeseries take the values of series column.
+	 */
+	template<class TS>
+	void load(const table& t, TS& ts, size_type column = 0) {
+		if(t.size())
+			builder<TS,TS::family,TS::multipleseries>::apply(t,ts,column);
+	}
+
+
+}}}
+
+
+#endif	//	__TIMESERIES_CSV_HPP__
@@ -44,7 +44,7 @@ public:
 	size_type series() const {return this->ts_series() - 1;}
 
 	BOOST_UBLAS_INLINE
-	ols(const tstype& ts):super(ts),m_mat(ts.internal_data()) {
+	ols(const tstype& ts):super(ts),m_mat(ts.data_range()) {
 		QM_REQUIRE(this->ts_series() > 1,"OLS calculation can be performed on multiple timeseries only");
 		QM_REQUIRE(this->ts_series() - 1 < this->ts_size(),"OLS Calculation cannot be performed");
 		QM_REQUIRE(!this->masked(),"OLS calculation not possible. Timeseries have missing data");
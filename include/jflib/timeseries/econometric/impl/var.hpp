@@ -29,7 +29,7 @@ private:
 	const_iterator	m_it1, m_it2;
 	size_type		m_n;
 
-	const key_type& date() const {return m_it2->first;}
+	const key_type& date() const {return iterator_key(m_it2);}
 
 	temp_type eval() const {
 		temp_type tv(2);
@@ -4,6 +4,7 @@
 
 #include <jflib/timeseries/traits/oper.hpp>
 #include <jflib/timeseries/masked/oper.hpp>
+#include <jflib/timeseries/impl/rowindex.hpp>
 
 
 namespace jflib { namespace timeseries { namespace econometric {
@@ -37,7 +38,7 @@ public:
 
 	// Virtual functions
 	virtual void iter_init()			 {m_iter = this->begin();}
-	virtual const key_type& date() const {return m_iter->first;}
+	virtual const key_type& date() const {return iterator_key(m_iter);}
 	virtual bool alive() const			 {return m_iter != this->end();}
 	virtual void advance()				 {++m_iter;}
 protected:
@@ -118,7 +119,7 @@ public:
 		op.init();
 		while(op.alive()) {
 			op.eval(op.tp);
-			io = tsp.insertexpression(io,0,op.date(),op.tp);
+			io = tsp.insertexpression(io,tsp.size(),op.date(),op.tp);
 			op.advance();
 		}
 		size_type rollsize = op.size() - window + 1;
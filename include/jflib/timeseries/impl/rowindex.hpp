@@ -0,0 +1,316 @@
+/**
+ * \brief Dense row index for timeseries of family 1
+ */
+
+#ifndef __TIMESERIES_ROWINDEX_HPP__
+#define __TIMESERIES_ROWINDEX_HPP__
+
+#include <jflib/jflib.hpp>
+#include <jflib/datetime/date.hpp>
+#include <jflib/timeseries/traits/matrix.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/iterator/transform_iterator.hpp>
+
+
+namespace jflib { namespace timeseries {
+
+
+namespace traits {
+
+	/**
+	 * \brief Integer representation of a key
+	 *
+	 * Used to export the keys of a timeseries as a flat array of 64-bit
+	 * integers, key is the inverse of apply.
+	 */
+	template<class K>
+	struct keyordinal {
+		static boost::int64_t	apply(const K& k)		{return static_cast<boost::int64_t>(k);}
+		static K				key(boost::int64_t o)	{return static_cast<K>(o);}
+	};
+
+	/// \brief Dates are exported as days since 1970-01-01 (numpy datetime64[D])
+	template<>
+	struct keyordinal<qdate> {
+		static boost::int64_t	apply(const qdate& k)		{return k.unixdays();}
+		static qdate			key(boost::int64_t d)	{return qdate::fromunixdays(long(d));}
+	};
+
+}
+
+
+namespace {
+
+	/**
+	 * \brief Keys and matrix shared by a timeseries, its copies and its views
+	 *
+	 * The position of a key in the keys array is the row of the matrix
+	 * holding its values. Keys are either owned or an external read-only
+	 * array (for example in shared memory) which outlives the state.
+	 * pins counts the objects aliasing the memory, which cannot grow
+	 * while there are any. The ordinals are built lazily by const readers,
+	 * possibly on several threads, under the mutex.
+	 */
+	template<class Key, class M>
+	struct rowindexstate: boost::noncopyable {
+		typedef typename M::traits_type_ptr				matrix_type_ptr;
+		typedef std::vector<Key>						keys_type;
+
+		rowindexstate(matrix_type_ptr d):data(d),external(0),nexternal(0),pins(0){}
+		rowindexstate(matrix_type_ptr d, const Key* k, std::size_t n):data(d),external(k),nexternal(n),pins(0){}
+
+		const Key*	kbegin() const {return external ? external : (keys.empty() ? 0 : &keys[0]);}
+		std::size_t	ksize()  const {return external ? nexternal : keys.size();}
+
+		keys_type			keys;
+		matrix_type_ptr		data;
+		const Key*					external;
+		std::size_t					nexternal;
+		std::vector<boost::int64_t>	ordinals;
+		boost::mutex				ordinals_mutex;
+		boost::atomic<std::size_t>	pins;
+	};
+
+
+	/**
+	 * \brief Random access iterator over (key, row) pairs
+	 *
+	 * The row proxy is created when the iterator is dereferenced,
+	 * so that the index does not store one object per row.
+	 */
+	template<class Key, class M>
+	class rowindexiterator: public boost::iterator_facade<rowindexiterator<Key,M>,
+														  std::pair<const Key,M>,
+														  boost::random_access_traversal_tag,
+														  std::pair<const Key,M> > {
+		typedef rowindexstate<Key,M>					state_type;
+	public:
+		typedef std::pair<const Key,M>					value_type;
+		typedef std::size_t								size_type;
+		typedef std::ptrdiff_t							difference_type;
+
+		rowindexiterator():m_state(0),m_pos(0){}
+		rowindexiterator(const state_type* state, size_type pos, const traits::range& cols):
+			m_state(state),m_pos(pos),m_cols(cols){}
+
+		/// \brief Row of the matrix the iterator is pointing at
+		size_type row() const {return m_pos;}
+		/// \brief Reference to the key the iterator is pointing at
+		const Key& key() const {return m_state->kbegin()[m_pos];}
+	private:
+		friend class boost::iterator_core_access;
+
+		const state_type*	m_state;
+		size_type			m_pos;
+		traits::range		m_cols;
+
+		value_type dereference() const {
+			return value_type(m_state->kbegin()[m_pos],M(m_state->data,m_pos,m_cols));
+		}
+		bool equal(const rowindexiterator& rhs) const {return m_pos == rhs.m_pos && m_state == rhs.m_state;}
+		void increment() {++m_pos;}
+		void decrement() {--m_pos;}
+		void advance(difference_type n) {m_pos += n;}
+		difference_type distance_to(const rowindexiterator& rhs) const {
+			return difference_type(rhs.m_pos) - difference_type(m_pos);
+		}
+	};
+
+	template<class Key, class M>
+	struct take_row {
+		typedef std::pair<const Key,M>		argument_type;
+		typedef M							result_type;
+		result_type operator () (const argument_type& p) const {
+			return p.second;
+		}
+	};
+
+}
+
+
+/// \brief Reference to the key of an iterator over (key, value) pairs
+template<class Iterator>
+inline const typename Iterator::value_type::first_type& iterator_key(const Iterator& it) {return it->first;}
+
+template<class Key, class M>
+inline const Key& iterator_key(const rowindexiterator<Key,M>& it) {return it.key();}
+
+
+/**
+ * \brief Dense row index for timeseries of family 1
+ *
+ * The index stores a sorted array of keys only. Row numbers are implicit,
+ * the key at position i is associated with row i of the matrix, and row
+ * proxies are created on demand during iteration. A window [first, last)
+ * over the keys and a column range allow views to share the keys and the data.
+ * The interface mirrors the one of templates::associative.
+ *
+ * Copies share the keys, as copies of a timeseries share its matrix: a
+ * copy is another handle on the same series and follows the end of the
+ * keys, so that keys appended through any copy are seen by all of them.
+ * Windows are fixed and only grow when keys are appended through them.
+ */
+template<class Key, class M>
+class rowindex {
+	typedef rowindexstate<Key,M>										state_type;
+	typedef boost::shared_ptr<state_type>								state_type_ptr;
+	typedef take_row<Key,M>												val_transform;
+public:
+	typedef Key															key_type;
+	typedef M															mapped_type;
+	typedef std::pair<const Key,M>										value_type;
+	typedef std::size_t													size_type;
+	typedef typename mapped_type::traits_type_ptr						matrix_type_ptr;
+	typedef typename state_type::keys_type								keys_type;
+	typedef traits::range												range;
+	typedef boost::int64_t												ordinal_type;
+
+	typedef rowindexiterator<Key,M>										const_iterator;
+	typedef const_iterator												iterator;
+	typedef const Key*													const_key_iterator;
+	typedef const_key_iterator											key_iterator;
+	typedef boost::transform_iterator<val_transform, const_iterator>	const_val_iterator;
+	typedef const_val_iterator											val_iterator;
+
+	rowindex(matrix_type_ptr data, const range& cols):
+		m_state(new state_type(data)),m_first(0),m_last(0),m_tail(true),m_cols(cols){}
+	/// \brief Index over n external keys, read-only
+	rowindex(matrix_type_ptr data, const range& cols, const key_type* keys, size_type n):
+		m_state(new state_type(data,keys,n)),m_first(0),m_last(n),m_tail(true),m_cols(cols){}
+	rowindex(const rowindex& rhs):
+		m_state(rhs.m_state),m_first(rhs.m_first),m_last(rhs.m_last),m_tail(rhs.m_tail),m_cols(rhs.m_cols){}
+
+	/// \brief A window over the same keys and data
+	rowindex(const rowindex& rhs, size_type first, size_type last, const range& cols):
+		m_state(rhs.m_state),m_first(first),m_last(last),m_tail(false),m_cols(cols){}
+
+	size_type		size()		const {return this->last() - m_first;}
+	bool			empty()		const {return this->last() == m_first;}
+
+	/// \brief Rows of the matrix covered by the index
+	range			rows()		const {return range(m_first,this->last());}
+	const range&	cols()		const {return m_cols;}
+	void			cols(const range& c) {m_cols = c;}
+	matrix_type_ptr	data()		const {return m_state->data;}
+
+	/// \brief True if the keys array extends beyond the index window
+	bool			is_window()	const {return m_first != 0 || this->last() != m_state->ksize();}
+
+	/// \brief True if the keys are external and no key can be added
+	bool			is_readonly() const {return m_state->external != 0;}
+
+	/// \brief True if a pin aliases the keys or the data, which cannot grow
+	bool			is_pinned()	const {return m_state->pins != 0;}
+
+	const_iterator		begin()		const {return const_iterator(m_state.get(),m_first,m_cols);}
+	const_iterator		end()		const {return const_iterator(m_state.get(),this->last(),m_cols);}
+
+	const_key_iterator	key_begin()	const {return m_state->kbegin() + m_first;}
+	const_key_iterator	key_end()	const {return m_state->kbegin() + this->last();}
+
+	const_val_iterator	val_begin()	const {return boost::make_transform_iterator(this->begin(),val_transform());}
+	const_val_iterator	val_end()	const {return boost::make_transform_iterator(this->end(),  val_transform());}
+
+	value_type		front()		const {return *this->begin();}
+	value_type		back()		const {return *(this->end() - 1);}
+
+	const_iterator	lower_bound(const key_type& x) const {
+		return this->begin() + (std::lower_bound(this->key_begin(),this->key_end(),x) - this->key_begin());
+	}
+	const_iterator	upper_bound(const key_type& x) const {
+		return this->begin() + (std::upper_bound(this->key_begin(),this->key_end(),x) - this->key_begin());
+	}
+	const_iterator	find(const key_type& x) const {
+		const_key_iterator k = std::lower_bound(this->key_begin(),this->key_end(),x);
+		if(k == this->key_end() || x < *k)
+			return this->end();
+		return this->begin() + (k - this->key_begin());
+	}
+
+	size_type		count(const key_type& x)	const {return this->find(x) == this->end() ? 0 : 1;}
+	bool			has_key(const key_type& x)	const {return this->count(x) == 1;}
+
+	mapped_type		at(const key_type& x) const {
+		const_iterator it = this->find(x);
+		QM_REQUIRE(it != this->end(),"Key not available");
+		return it->second;
+	}
+
+	void	reserve(size_type n) {m_state->keys.reserve(n);}
+
+	/**
+	 * \brief The keys of the index as integers (see traits::keyordinal)
+	 *
+	 * The integers are computed once, shared by copies and views and
+	 * extended when new keys are appended. Concurrent calls are safe.
+	 */
+	const ordinal_type* ordinals() const {
+		boost::mutex::scoped_lock lock(m_state->ordinals_mutex);
+		const key_type* keys = m_state->kbegin();
+		size_type n = m_state->ksize();
+		std::vector<ordinal_type>& ords = m_state->ordinals;
+		if(ords.size() < n) {
+			ords.reserve(m_state->external ? n : m_state->keys.capacity());
+			for(size_type i=ords.size();i<n;++i)
+				ords.push_back(traits::keyordinal<key_type>::apply(keys[i]));
+		}
+		return ords.empty() ? 0 : &ords[0] + m_first;
+	}
+
+	/**
+	 * \brief Append a key at the end of the index and return its iterator.
+	 *
+	 * The key is associated with the next row of the matrix and must be
+	 * greater than the last key.
+	 */
+	const_iterator push_back(const key_type& key) {
+		keys_type& keys = m_state->keys;
+		QM_REQUIRE(!this->is_readonly(),"Cannot insert keys into a read-only timeseries");
+		QM_REQUIRE(!this->is_pinned(),"Cannot insert keys while arrays share the timeseries memory");
+		QM_REQUIRE(this->last() == keys.size(),"Cannot insert keys into a timeseries view");
+		QM_REQUIRE(keys.empty() || keys.back() < key,"Keys must be inserted in increasing order");
+		keys.push_back(key);
+		if(!m_tail)
+			++m_last;
+		return const_iterator(m_state.get(),keys.size()-1,m_cols);
+	}
+
+	bool is_valid() const {return true;}
+
+	/**
+	 * \brief Keeps the keys, their ordinals and the data of an index alive and fixed
+	 *
+	 * Taken by arrays aliasing the memory of a timeseries. While a pin
+	 * exists, keys cannot be appended and the matrix cannot be resized.
+	 */
+	class pin: boost::noncopyable {
+	public:
+		pin(const rowindex& index):m_state(index.m_state) {++m_state->pins;}
+		~pin() {--m_state->pins;}
+	private:
+		state_type_ptr	m_state;
+	};
+private:
+	state_type_ptr		m_state;
+	size_type			m_first;
+	size_type			m_last;
+	bool				m_tail;
+	range				m_cols;
+
+	// A copy ends with the keys, a window at m_last
+	size_type	last() const {return m_tail ? m_state->ksize() : m_last;}
+};
+
+
+}}
+
+
+#endif	//	__TIMESERIES_ROWINDEX_HPP__
@@ -8,6 +8,7 @@
 #include <jflib/timeseries/timeseries_base.hpp>
 #include <jflib/ublas/base.hpp>
 #include <jflib/ublas/oper.hpp>
+#include <boost/make_shared.hpp>
 
 
 
@@ -34,6 +35,16 @@ struct mvtraits<T,M,0u> {
 		mask[s] = m;
 	}
 
+	static void add(data_type& data, mask_type& mask, size_type n, const value_type& d, const value_mask_type& m) {
+		size_type s = data.size();
+		data.resize(s+n);
+		mask.resize(s+n);
+		for(size_type i=s;i<s+n;++i) {
+			data[i] = d;
+			mask[i] = m;
+		}
+	}
+
 	template<class T2, class M2>
 	static void add(data_type& data, mask_type& mask, const T2& d, const M2& m) {
 		size_type s2 = d.size();
@@ -57,13 +68,20 @@ struct mvtraits<T,M,1u> {
 	typedef typename matrix_data_type::value_type					value_type;
 	typedef typename matrix_mask_type::value_type					value_mask_type;
 	typedef typename matrix_data_type::size_type					size_type;
-	typedef boost::numeric::ublas::matrix_row<matrix_data_type>		data_type;
-	typedef boost::numeric::ublas::matrix_row<matrix_mask_type>		mask_type;
+	typedef boost::numeric::ublas::range							range_type;
+	typedef boost::numeric::ublas::matrix_range<matrix_data_type>	data_range_type;
+	typedef boost::numeric::ublas::matrix_range<matrix_mask_type>	mask_range_type;
+	typedef boost::numeric::ublas::matrix_row<data_range_type>		data_type;
+	typedef boost::numeric::ublas::matrix_row<mask_range_type>		mask_type;
 
 	static void add(data_type& data, mask_type& mask, const value_type& d, const value_mask_type& m) {
 		QM_FAIL("Cannot add series to this masked vector");
 	}
 
+	static void add(data_type& data, mask_type& mask, size_type n, const value_type& d, const value_mask_type& m) {
+		QM_FAIL("Cannot add series to this masked vector");
+	}
+
 	template<class T2, class M2>
 	static void add(data_type& data, mask_type& mask, const T2& d, const M2& m) {
 		QM_FAIL("Cannot add series to this masked vector");
@@ -75,6 +93,16 @@ struct mvtraits<T,M,1u> {
 	size_type rows() const {return data.size1();}
 	size_type cols() const {return data.size2();}
 
+	// Row proxies restricted to the columns in cols
+	data_type row_data(size_type row, const range_type& cols) {
+		data_range_type r(data,range_type(row,row+1),cols);
+		return data_type(r,0);
+	}
+	mask_type row_mask(size_type row, const range_type& cols) {
+		mask_range_type r(mask,range_type(row,row+1),cols);
+		return mask_type(r,0);
+	}
+
 	matrix_data_type data;
 	matrix_mask_type mask;
 };
@@ -87,6 +115,22 @@ protected:
 };
 
 
+/**
+ * \brief Data and mask of a masked vector
+ *
+ * Both are held in a single block so that a row costs one allocation
+ * and one reference count.
+ */
+template<class D, class M>
+struct maskedstorage {
+	maskedstorage(){}
+	template<class D2, class M2>
+	maskedstorage(const D2& d, const M2& m):data(d),mask(m){}
+
+	D	data;
+	M	mask;
+};
+
 }
 
 
@@ -115,49 +159,52 @@ public:
 	typedef value_type										numtype;
 
 	typedef boost::shared_ptr<traits_type>					traits_type_ptr;
-	typedef boost::shared_ptr<data_type>					data_type_ptr;
-	typedef boost::shared_ptr<mask_type>					mask_type_ptr;
+	typedef maskedstorage<data_type,mask_type>				storage_type;
+	typedef boost::shared_ptr<storage_type>					storage_type_ptr;
 
 
 	static const value_mask_type masked_value     = 0;
 	static const value_mask_type not_masked_value = 1;
 
-	maskedvector():m_data(new data_type),m_mask(new mask_type){}
+	maskedvector():m_row(boost::make_shared<storage_type>()){}
 
 	maskedvector(const value_type& v):
-		m_data(new data_type(1, v)),m_mask(new mask_type(1, 1)) {}
+		m_row(boost::make_shared<storage_type>(data_type(1, v),mask_type(1, 1))) {}
 
 	maskedvector(size_type S):
-		m_data(new data_type(S, masked_elem())),m_mask(new mask_type(S, 0)) {}
+		m_row(boost::make_shared<storage_type>(data_type(S, maskedvalue<value_type>::value()),mask_type(S, 0))) {}
 
 	maskedvector(size_type S, const value_type& v):
-		m_data(new data_type(S, v)),m_mask(new mask_type(S, 1)) {}
+		m_row(boost::make_shared<storage_type>(data_type(S, v),mask_type(S, 1))) {}
 
 	maskedvector(traits_type_ptr data, size_type row):
-		super(row),m_data(new data_type(data->data,row)), m_mask(new mask_type(data->mask,row)) {}
+		super(row),m_row(boost::make_shared<storage_type>(
+				data->row_data(row,boost::numeric::ublas::range(0,data->cols())),
+				data->row_mask(row,boost::numeric::ublas::range(0,data->cols())))) {}
+
+	maskedvector(traits_type_ptr data, size_type row, const boost::numeric::ublas::range& cols):
+		super(row),m_row(boost::make_shared<storage_type>(data->row_data(row,cols),data->row_mask(row,cols))) {}
 
 	template<class T2, class M2, unsigned F2>
 	maskedvector(const maskedvector<T2,M2,F2>& mv):
-		m_data(new data_type(mv.data())),m_mask(new mask_type(mv.mask())) {}
+		m_row(boost::make_shared<storage_type>(mv.data(),mv.mask())) {}
 
 
 	template<class AE>
 	maskedvector(const boost::numeric::ublas::vector_expression<AE>& ae):
-		super(1),m_data(new data_type(ae)) {
-		m_mask = mask_type_ptr(new mask_type(m_data->size(), 1));
-	}
+		super(1),m_row(boost::make_shared<storage_type>(data_type(ae),mask_type(ae().size(), 1))) {}
 
 	/*
 	 * \brief the extended copy costructor
 	 */
 	template<class AE>
 	maskedvector& operator = (const boost::numeric::ublas::vector_expression<AE>& ae) {
-		(*m_data) = ae;
+		m_row->data = ae;
 		return *this;
 	}
 
 
-	size_type	size() const {return m_data->size();}
+	size_type	size() const {return m_row->data.size();}
 	size_type   index() const {QM_FAIL("Index not available");}
 	size_type	masked() const {
 		size_type m = 0;
@@ -166,48 +213,46 @@ public:
 	}
 	value_type   masked_elem() const {return maskedvalue<value_type>::value();}
 
-	value_type& operator [] (size_type i) {return (*m_data)[i];}
-	const value_type& operator [] (size_type i) const {return (*m_data)[i];}
+	value_type& operator [] (size_type i) {return m_row->data[i];}
+	const value_type& operator [] (size_type i) const {return m_row->data[i];}
 
-	value_type& operator () (size_type i) {return (*m_data)[i];}
-	const value_type& operator () (size_type i) const {return (*m_data)[i];}
+	value_type& operator () (size_type i) {return m_row->data[i];}
+	const value_type& operator () (size_type i) const {return m_row->data[i];}
 
 	// Iterators
-	iterator				begin()			  	  {return m_data->begin();}
-	iterator				end()				  {return m_data->end();}
+	iterator				begin()			  	  {return m_row->data.begin();}
+	iterator				end()				  {return m_row->data.end();}
 
-	const_iterator			begin()			const {return m_data->begin();}
-	const_iterator			end()			const {return m_data->end();}
+	const_iterator			begin()			const {return m_row->data.begin();}
+	const_iterator			end()			const {return m_row->data.end();}
 
-	mask_iterator			mask_begin()		  {return m_mask->begin();}
-	mask_iterator			mask_end()			  {return m_mask->end();}
+	mask_iterator			mask_begin()		  {return m_row->mask.begin();}
+	mask_iterator			mask_end()			  {return m_row->mask.end();}
 
-	const_mask_iterator		mask_begin()	const {return m_mask->begin();}
-	const_mask_iterator		mask_end()		const {return m_mask->end();}
+	const_mask_iterator		mask_begin()	const {return m_row->mask.begin();}
+	const_mask_iterator		mask_end()		const {return m_row->mask.end();}
 
-	void	push_back(const value_type& v) {traits_type::add(*m_data,*m_mask,v,1);}
+	void	push_back(const value_type& v) {traits_type::add(m_row->data,m_row->mask,v,1);}
 
 	template<class T2, class M2, unsigned F2>
-	void	push_back(const maskedvector<T2,M2,F2>& v) {traits_type::add(*m_data,*m_mask,v.data(),v.mask());}
+	void	push_back(const maskedvector<T2,M2,F2>& v) {traits_type::add(m_row->data,m_row->mask,v.data(),v.mask());}
 
 	void	push_empty() {
-		traits_type::add(*m_data,*m_mask,masked_elem(),0);
+		traits_type::add(m_row->data,m_row->mask,masked_elem(),0);
 	}
 
 	void	push_empty(size_type n) {
-		for(size_type i=0;i<n;++i)
-			traits_type::add(*m_data,*m_mask,masked_elem(),0);
+		traits_type::add(m_row->data,m_row->mask,n,masked_elem(),0);
 	}
 
-	data_type& data() {return *m_data;}
-	const data_type& data() const {return *m_data;}
+	data_type& data() {return m_row->data;}
+	const data_type& data() const {return m_row->data;}
 
-	mask_type& mask() {return *m_mask;}
-	const mask_type& mask() const {return *m_mask;}
+	mask_type& mask() {return m_row->mask;}
+	const mask_type& mask() const {return m_row->mask;}
 
 private:
-	data_type_ptr	m_data;
-	mask_type_ptr	m_mask;
+	storage_type_ptr	m_row;
 };
 
 
@@ -0,0 +1,248 @@
+/**
+ * \brief Matrix timeseries in shared memory or in memory-mapped files
+ */
+
+#ifndef __TIMESERIES_SHARED_HPP__
+#define __TIMESERIES_SHARED_HPP__
+
+#include <jflib/timeseries/timeseries_matrix.hpp>
+#include <jflib/timeseries/traits/base.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/has_trivial_copy.hpp>
+#include <boost/numeric/ublas/matrix.hpp>
+#include <boost/numeric/ublas/storage.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+
+namespace jflib { namespace timeseries {
+
+
+/**
+ * \brief Timeseries matrix tag whose matrices can alias external memory
+ *
+ * Matrices are row-major ublas matrices over an array_adaptor. They own
+ * their storage when created by the library, and alias a shared memory
+ * segment or a mapped file when attached with shared::attach.
+ */
+struct tsshared: tsmatrix_base {
+	typedef tsshared	self;
+
+	template<class Key, class T>
+	struct container {
+		typedef T																numtype;
+		typedef boost::numeric::ublas::matrix<numtype,
+						boost::numeric::ublas::row_major,
+						boost::numeric::ublas::array_adaptor<numtype> >					data_type;
+		typedef boost::numeric::ublas::matrix<int,
+						boost::numeric::ublas::row_major,
+						boost::numeric::ublas::array_adaptor<int> >						mask_type;
+		typedef Nil																super;
+		typedef timeseries<Key,numtype,self,family,multipleseries>				type;
+	};
+};
+
+
+namespace shared {
+
+	/**
+	 * \brief Header at the start of a segment
+	 *
+	 * Keys, data and mask follow at the given offsets from the start of
+	 * the segment. Data and mask are row-major. Keys are stored as their
+	 * 64-bit ordinals (see traits::keyordinal), keysize is their size, and
+	 * are converted back to keys when a process attaches.
+	 */
+	struct header {
+		char				magic[8];
+		boost::uint32_t		version;
+		boost::uint32_t		keysize;
+		boost::uint32_t		valuesize;
+		boost::uint32_t		masksize;
+		boost::uint64_t		rows;
+		boost::uint64_t		cols;
+		boost::uint64_t		keys;
+		boost::uint64_t		data;
+		boost::uint64_t		mask;
+		boost::uint64_t		size;
+		char				name[64];
+	};
+
+	static const char			magic[8]	= {'J','F','L','I','B','S','H','M'};
+	static const boost::uint32_t version	= 2;
+	static const std::size_t	alignment	= 64;
+
+	typedef boost::interprocess::mapped_region		region_type;
+	typedef boost::shared_ptr<region_type>			region_type_ptr;
+
+
+namespace {
+
+	inline boost::uint64_t align(boost::uint64_t n) {return (n + alignment - 1)/alignment*alignment;}
+
+	/// \brief Keeps the mapped region and the keys read from it alive as long as the matrices using them
+	template<class M, class Key>
+	struct region_deleter {
+		region_deleter(region_type_ptr r, boost::shared_ptr<std::vector<Key> > k):region(r),keys(k){}
+		void operator () (M* m) const {delete m;}
+		region_type_ptr							region;
+		boost::shared_ptr<std::vector<Key> >	keys;
+	};
+
+	/// \brief Write the ordinals of the keys in [begin, end)
+	template<class Iterator>
+	void write_keys(Iterator begin, Iterator end, boost::int64_t* out) {
+		typedef typename std::iterator_traits<Iterator>::value_type		key_type;
+		for(Iterator it=begin; it!=end; ++it)
+			*out++ = traits::keyordinal<key_type>::apply(*it);
+	}
+
+	/// \brief The keys of n ordinals, with one key at least so that an index can be built over them
+	template<class Key>
+	boost::shared_ptr<std::vector<Key> > read_keys(const boost::int64_t* ords, std::size_t n) {
+		boost::shared_ptr<std::vector<Key> > keys(new std::vector<Key>(std::max<std::size_t>(n,1)));
+		for(std::size_t i=0;i<n;++i)
+			(*keys)[i] = traits::keyordinal<Key>::key(ords[i]);
+		return keys;
+	}
+
+	template<class Key, class T>
+	header make_header(const std::string& name, std::size_t rows, std::size_t cols) {
+		// values are written as they are in memory
+		BOOST_STATIC_ASSERT(boost::has_trivial_copy<T>::value);
+		header h;
+		std::memset(&h,0,sizeof(header));
+		std::memcpy(h.magic,magic,sizeof(magic));
+		h.version	= version;
+		h.keysize	= sizeof(boost::int64_t);
+		h.valuesize	= sizeof(T);
+		h.masksize	= sizeof(int);
+		h.rows		= rows;
+		h.cols		= cols;
+		h.keys		= align(sizeof(header));
+		h.data		= align(h.keys + rows*sizeof(boost::int64_t));
+		h.mask		= align(h.data + rows*cols*sizeof(T));
+		h.size		= h.mask + rows*cols*sizeof(int);
+		std::strncpy(h.name,name.c_str(),sizeof(h.name)-1);
+		return h;
+	}
+
+	/// \brief Copy keys, data and mask of a matrix timeseries into a segment
+	template<class TS>
+	void write(char* base, const header& h, const TS& ts) {
+		typedef typename TS::numtype				numtype;
+		std::memcpy(base,&h,sizeof(header));
+		write_keys(ts.key_begin(),ts.key_end(),reinterpret_cast<boost::int64_t*>(base + h.keys));
+		typename TS::matrix_data_range d = ts.data_range();
+		typename TS::matrix_mask_range m = ts.mask_range();
+		numtype* pd = reinterpret_cast<numtype*>(base + h.data);
+		int*     pm = reinterpret_cast<int*>(base + h.mask);
+		for(std::size_t r=0;r<h.rows;++r)
+			for(std::size_t c=0;c<h.cols;++c) {
+				*pd++ = d(r,c);
+				*pm++ = m(r,c);
+			}
+	}
+
+	/// \brief Read-only timeseries over a mapped segment
+	template<class Key, class T>
+	typename traits::ts<Key,T,tsshared>::type attach(region_type_ptr region) {
+		typedef typename traits::ts<Key,T,tsshared>::type		tstype;
+		typedef typename tstype::matrix_type					matrix_type;
+		typedef typename tstype::matrix_type_ptr				matrix_type_ptr;
+		typedef typename tstype::index_type						index_type;
+		typedef typename tstype::range							range;
+
+		const char* base = static_cast<const char*>(region->get_address());
+		QM_REQUIRE(region->get_size() >= sizeof(header),"Not a timeseries segment");
+		const header& h = *reinterpret_cast<const header*>(base);
+		QM_REQUIRE(std::memcmp(h.magic,magic,sizeof(magic)) == 0,"Not a timeseries segment");
+		QM_REQUIRE(h.version == version,"Unsupported timeseries segment version " << h.version);
+		QM_REQUIRE(h.keysize == sizeof(boost::int64_t) && h.valuesize == sizeof(T) && h.masksize == sizeof(int),
+				   "Timeseries segment has different key or value types");
+		QM_REQUIRE(region->get_size() >= h.size,"Timeseries segment is truncated");
+
+		// The storage aliases the segment before the matrices take their
+		// size, which then is the size of the storage and allocates nothing
+		std::size_t N = h.rows*h.cols;
+		boost::shared_ptr<std::vector<Key> > keys = read_keys<Key>(reinterpret_cast<const boost::int64_t*>(base + h.keys),h.rows);
+		matrix_type_ptr data(new matrix_type,region_deleter<matrix_type,Key>(region,keys));
+		data->data.data().resize(N,reinterpret_cast<T*>(const_cast<char*>(base + h.data)));
+		data->data.resize(h.rows,h.cols,false);
+		data->mask.data().resize(N,reinterpret_cast<int*>(const_cast<char*>(base + h.mask)));
+		data->mask.resize(h.rows,h.cols,false);
+		index_type index(data,range(0,h.cols),&(*keys)[0],h.rows);
+		return tstype(std::string(h.name),data,index);
+	}
+
+}
+
+
+	/**
+	 * \brief Publish a matrix timeseries into the named shared memory segment
+	 *
+	 * The segment lives until removed with unpublish, also after the
+	 * publishing process exits.
+	 */
+	template<class TS>
+	void publish(const std::string& name, const TS& ts) {
+		namespace ip = boost::interprocess;
+		header h = make_header<typename TS::key_type,typename TS::numtype>(ts.name(),ts.size(),ts.series());
+		ip::shared_memory_object shm(ip::create_only,name.c_str(),ip::read_write);
+		shm.truncate(h.size);
+		ip::mapped_region region(shm,ip::read_write);
+		write(static_cast<char*>(region.get_address()),h,ts);
+	}
+
+	/// \brief Remove a shared memory segment. Attached timeseries remain valid
+	inline bool unpublish(const std::string& name) {
+		return boost::interprocess::shared_memory_object::remove(name.c_str());
+	}
+
+	/// \brief Attach read-only to a segment created by publish
+	template<class Key, class T>
+	typename traits::ts<Key,T,tsshared>::type attach(const std::string& name) {
+		namespace ip = boost::interprocess;
+		ip::shared_memory_object shm(ip::open_only,name.c_str(),ip::read_only);
+		return attach<Key,T>(region_type_ptr(new region_type(shm,ip::read_only)));
+	}
+
+	/// \brief Write a matrix timeseries into a file which can be attached with attach_file
+	template<class TS>
+	void publish_file(const std::string& path, const TS& ts) {
+		namespace ip = boost::interprocess;
+		header h = make_header<typename TS::key_type,typename TS::numtype>(ts.name(),ts.size(),ts.series());
+		{
+			std::filebuf fbuf;
+			QM_REQUIRE(fbuf.open(path.c_str(),std::ios_base::in | std::ios_base::out |
+								 std::ios_base::trunc | std::ios_base::binary),"Cannot create file " << path);
+			fbuf.pubseekoff(h.size-1,std::ios_base::beg);
+			fbuf.sputc(0);
+		}
+		ip::file_mapping file(path.c_str(),ip::read_write);
+		ip::mapped_region region(file,ip::read_write);
+		write(static_cast<char*>(region.get_address()),h,ts);
+		region.flush();
+	}
+
+	/// \brief Attach read-only to a file written by publish_file
+	template<class Key, class T>
+	typename traits::ts<Key,T,tsshared>::type attach_file(const std::string& path) {
+		namespace ip = boost::interprocess;
+		ip::file_mapping file(path.c_str(),ip::read_only);
+		return attach<Key,T>(region_type_ptr(new region_type(file,ip::read_only)));
+	}
+
+}
+
+}}
+
+
+#endif	//	__TIMESERIES_SHARED_HPP__
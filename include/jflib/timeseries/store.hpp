@@ -0,0 +1,249 @@
+/**
+ * \brief Binary on-disk format for matrix timeseries
+ *
+ * A file holds a single matrix timeseries:
+ *
+ * - a versioned header
+ * - the sorted key column, as 64-bit ordinals (see traits::keyordinal)
+ * - the value columns, one contiguous column per series
+ * - optional mask columns, one byte per value, written only if some
+ *   values are missing
+ * - a block index with the ordinal of the first key of every block of rows
+ *
+ * The reader memory-maps the file read-only and converts the key column
+ * back to keys. Values and masks are not copied, the operating system
+ * pages in the blocks which are used.
+ */
+
+#ifndef __TIMESERIES_STORE_HPP__
+#define __TIMESERIES_STORE_HPP__
+
+#include <jflib/timeseries/shared.hpp>
+#include <jflib/ublas/const_array.hpp>
+
+
+namespace jflib { namespace timeseries {
+
+
+/**
+ * \brief Timeseries matrix tag of the on-disk format
+ *
+ * Matrices are column-major, so that each series is contiguous, and the
+ * mask holds one byte per value. The mask of a file without mask columns
+ * is a constant array of valid values.
+ */
+struct tsstore: tsmatrix_base {
+	typedef tsstore		self;
+
+	template<class Key, class T>
+	struct container {
+		typedef T																numtype;
+		typedef boost::numeric::ublas::matrix<numtype,
+						boost::numeric::ublas::column_major,
+						boost::numeric::ublas::array_adaptor<numtype> >					data_type;
+		typedef boost::numeric::ublas::matrix<unsigned char,
+						boost::numeric::ublas::column_major,
+						jflib::ublas::const_array<unsigned char> >						mask_type;
+		typedef Nil																super;
+		typedef timeseries<Key,numtype,self,family,multipleseries>				type;
+	};
+};
+
+
+namespace store {
+
+	/**
+	 * \brief File header
+	 *
+	 * Offsets are from the start of the file, mask is 0 if the file has
+	 * no mask columns. Keys are stored as their 64-bit ordinals, keysize
+	 * is their size, endian records the byte order of the writer.
+	 */
+	struct header {
+		char				magic[8];
+		boost::uint32_t		version;
+		boost::uint32_t		endian;
+		boost::uint32_t		keysize;
+		boost::uint32_t		valuesize;
+		boost::uint64_t		blocksize;
+		boost::uint64_t		rows;
+		boost::uint64_t		cols;
+		boost::uint64_t		blocks;
+		boost::uint64_t		keys;
+		boost::uint64_t		data;
+		boost::uint64_t		mask;
+		boost::uint64_t		index;
+		boost::uint64_t		size;
+		char				name[64];
+	};
+
+	static const char			 magic[8]	= {'J','F','L','I','B','T','S','F'};
+	static const boost::uint32_t version	= 2;
+	static const boost::uint32_t endian		= 0x01020304;
+	static const std::size_t	 blocksize	= 4096;
+
+
+	/**
+	 * \brief Write a matrix timeseries into a file
+	 *
+	 * Rows are grouped into blocks of blocksize rows in the block index.
+	 */
+	template<class TS>
+	void write(const std::string& path, const TS& ts, std::size_t bsize = blocksize) {
+		namespace ip = boost::interprocess;
+		typedef typename TS::numtype				numtype;
+		// values are written as they are in memory
+		BOOST_STATIC_ASSERT(boost::has_trivial_copy<numtype>::value);
+		QM_REQUIRE(bsize > 0,"Block size must be positive");
+
+		typename TS::matrix_data_range d = ts.data_range();
+		typename TS::matrix_mask_range m = ts.mask_range();
+		std::size_t R = ts.size();
+		std::size_t C = ts.series();
+		bool masked = false;
+		for(std::size_t c=0;c<C && !masked;++c)
+			for(std::size_t r=0;r<R && !masked;++r)
+				masked = !m(r,c);
+
+		header h;
+		std::memset(&h,0,sizeof(header));
+		std::memcpy(h.magic,magic,sizeof(magic));
+		h.version	= version;
+		h.endian	= endian;
+		h.keysize	= sizeof(boost::int64_t);
+		h.valuesize	= sizeof(numtype);
+		h.blocksize	= bsize;
+		h.rows		= R;
+		h.cols		= C;
+		h.blocks	= (R + bsize - 1)/bsize;
+		h.keys		= shared::align(sizeof(header));
+		h.data		= shared::align(h.keys + R*sizeof(boost::int64_t));
+		h.mask		= masked ? shared::align(h.data + R*C*sizeof(numtype)) : 0;
+		h.index		= shared::align(masked ? h.mask + R*C : h.data + R*C*sizeof(numtype));
+		h.size		= h.index + h.blocks*sizeof(boost::int64_t);
+		std::strncpy(h.name,ts.name().c_str(),sizeof(h.name)-1);
+
+		{
+			std::filebuf fbuf;
+			QM_REQUIRE(fbuf.open(path.c_str(),std::ios_base::in | std::ios_base::out |
+								 std::ios_base::trunc | std::ios_base::binary),"Cannot create file " << path);
+			fbuf.pubseekoff(h.size-1,std::ios_base::beg);
+			fbuf.sputc(0);
+		}
+		ip::file_mapping file(path.c_str(),ip::read_write);
+		ip::mapped_region region(file,ip::read_write);
+		char* base = static_cast<char*>(region.get_address());
+
+		std::memcpy(base,&h,sizeof(header));
+		boost::int64_t* k = reinterpret_cast<boost::int64_t*>(base + h.keys);
+		boost::int64_t* b = reinterpret_cast<boost::int64_t*>(base + h.index);
+		shared::write_keys(ts.key_begin(),ts.key_end(),k);
+		for(std::size_t r=0;r<R;r+=bsize)
+			*b++ = k[r];
+		numtype* pd = reinterpret_cast<numtype*>(base + h.data);
+		unsigned char* pm = reinterpret_cast<unsigned char*>(base + h.mask);
+		for(std::size_t c=0;c<C;++c)
+			for(std::size_t r=0;r<R;++r) {
+				*pd++ = d(r,c);
+				if(masked)
+					*pm++ = m(r,c) ? 1 : 0;
+			}
+		region.flush();
+	}
+
+
+	/**
+	 * \brief Read-only access to a file written by write
+	 *
+	 * Timeseries returned by the reader alias the mapped file and keep it
+	 * mapped, also after the reader is destroyed. Opening a file converts
+	 * the key column only.
+	 */
+	template<class Key, class T>
+	class reader {
+	public:
+		typedef typename traits::ts<Key,T,tsstore>::type	tstype;
+		typedef typename tstype::size_type					size_type;
+		typedef typename tstype::matrix_type				matrix_type;
+		typedef typename tstype::matrix_type_ptr			matrix_type_ptr;
+		typedef typename tstype::index_type					index_type;
+		typedef typename tstype::range						range;
+
+		reader(const std::string& path) {
+			namespace ip = boost::interprocess;
+			ip::file_mapping file(path.c_str(),ip::read_only);
+			m_region.reset(new shared::region_type(file,ip::read_only));
+			m_region->advise(shared::region_type::advice_random);
+			const char* base = static_cast<const char*>(m_region->get_address());
+			QM_REQUIRE(m_region->get_size() >= sizeof(header),"Not a timeseries file: " << path);
+			m_header = reinterpret_cast<const header*>(base);
+			const header& h = *m_header;
+			QM_REQUIRE(std::memcmp(h.magic,magic,sizeof(magic)) == 0,"Not a timeseries file: " << path);
+			QM_REQUIRE(h.version == version,"Unsupported timeseries file version " << h.version);
+			QM_REQUIRE(h.endian == endian,"Timeseries file written with a different byte order");
+			QM_REQUIRE(h.keysize == sizeof(boost::int64_t) && h.valuesize == sizeof(T),
+					   "Timeseries file has different key or value types");
+			QM_REQUIRE(m_region->get_size() >= h.size,"Timeseries file is truncated");
+
+			// The storage aliases the file, or is constant, before the
+			// matrices take their size, which then allocates nothing
+			std::size_t N = h.rows*h.cols;
+			boost::shared_ptr<std::vector<Key> > keys = shared::read_keys<Key>(reinterpret_cast<const boost::int64_t*>(base + h.keys),h.rows);
+			matrix_type_ptr data(new matrix_type,shared::region_deleter<matrix_type,Key>(m_region,keys));
+			data->data.data().resize(N,reinterpret_cast<T*>(const_cast<char*>(base + h.data)));
+			data->data.resize(h.rows,h.cols,false);
+			if(h.mask)
+				data->mask.data().resize(N,reinterpret_cast<unsigned char*>(const_cast<char*>(base + h.mask)));
+			else
+				data->mask.data().constant(N,1);
+			data->mask.resize(h.rows,h.cols,false);
+			m_keys  = &(*keys)[0];
+			m_index = reinterpret_cast<const boost::int64_t*>(base + h.index);
+			m_series.reset(new tstype(std::string(h.name),data,index_type(data,range(0,h.cols),m_keys,h.rows)));
+		}
+
+		const header&	info()		const {return *m_header;}
+		size_type		size()		const {return m_header->rows;}
+		size_type		series()	const {return m_header->cols;}
+		size_type		blocks()	const {return m_header->blocks;}
+
+		/// \brief The whole file as a read-only timeseries
+		const tstype&	all()		const {return *m_series;}
+
+		/**
+		 * \brief Read-only view of the dates in (start, end]
+		 *
+		 * The block index locates the rows, so that only the key blocks at
+		 * the boundaries are paged in.
+		 */
+		tstype view(const Key& start, const Key& end) const {
+			size_type first = this->upper_bound(start);
+			size_type last  = std::max(first,this->upper_bound(end));
+			const index_type& idx = m_series->index();
+			return tstype(m_series->name(),idx.data(),index_type(idx,first,last,idx.cols()));
+		}
+	private:
+		shared::region_type_ptr		m_region;
+		const header*				m_header;
+		const Key*					m_keys;
+		const boost::int64_t*		m_index;
+		boost::shared_ptr<tstype>	m_series;
+
+		/// \brief Row of the first key greater than x
+		size_type upper_bound(const Key& x) const {
+			const header& h = *m_header;
+			size_type b = std::upper_bound(m_index,m_index + h.blocks,traits::keyordinal<Key>::apply(x)) - m_index;
+			if(b == 0)
+				return 0;
+			size_type lo = (b - 1)*h.blocksize;
+			size_type hi = std::min<size_type>(b*h.blocksize,h.rows);
+			return std::upper_bound(m_keys + lo,m_keys + hi,x) - m_keys;
+		}
+	};
+
+}
+
+}}
+
+
+#endif	//	__TIMESERIES_STORE_HPP__
@@ -3,13 +3,26 @@
 #define __TIMESERIES_STRUCTURES_HPP__
 
 
+#include <jflib/error.hpp>
 #include <jflib/templates/map.hpp>
+#include <jflib/datetime/date.hpp>
+#include <jflib/datetime/daycount.hpp>
 #include <jflib/timeseries/timeseries_base.hpp>
+#include <jflib/ublas/small_array.hpp>
+
+#include <boost/numeric/ublas/matrix.hpp>
 
 
 namespace jflib { namespace timeseries {
 
 
+/// \brief Day counter of the timeseries with keys of type Key
+template<class Key>
+struct daycountertype {
+	typedef Act365<Key>	type;
+};
+
+
 /** \brief Tag struct for a timeseries map
  *
  * A Map-Timeseries is a timeseries based on a map structure
@@ -37,6 +50,32 @@ struct tsvmapbase {
 };
 
 
+/**
+ * \brief Specialization of tsvmapbase
+ * The masked vector is given by ublas vectors with N inline elements,
+ * so that rows with up to N series do not allocate their values
+ * and rows with more series grow geometrically.
+ */
+template<std::size_t N>
+struct ublas_small_tsvmap: tsvmapbase {
+	typedef ublas_small_tsvmap<N>	self;
+
+	template<class Key, class T>
+	struct container {
+		typedef T																numtype;
+		typedef boost::numeric::ublas::vector<numtype,
+						jflib::ublas::small_array<numtype,N> >					data_type;
+		typedef boost::numeric::ublas::vector<int,
+						jflib::ublas::small_array<int,N> >						mask_type;
+		typedef maskedvector<data_type,mask_type,family>						vtype;
+		typedef jflib::templates::associative<Key,vtype,0>						super;
+		typedef	timeseries<Key,numtype,self,family,multipleseries>				type;
+	};
+};
+
+typedef ublas_small_tsvmap<8>	ublas_tsvmap;
+
+
 
 // ublas timeserie matrix tag based on boost::numeric::ublas matrix structure
 struct tsmatrix_base {
@@ -45,7 +84,26 @@ struct tsmatrix_base {
 };
 
 
-// \brief matrixmap structure
+// ublas timeserie matrix tag based on boost::numeric::ublas matrix structure
+struct ublas_tsmatrix: tsmatrix_base {
+	typedef ublas_tsmatrix	self;
+
+	template<class Key, class T>
+	struct container {
+		typedef T														numtype;
+		typedef boost::numeric::ublas::matrix<numtype>					data_type;
+		typedef boost::numeric::ublas::matrix<int>						mask_type;
+		typedef Nil														super;
+		typedef timeseries<Key,numtype,self,family,multipleseries>		type;
+	};
+};
+
+
+/** \brief matrixmap structure
+ *
+ * \deprecated Family 1 timeseries index their rows with rowindex and no
+ * longer use it. Kept for code which builds a map of rows itself.
+ */
 template<class M>
 struct matrixmap {
 	typedef matrixmap<M>	self_type;
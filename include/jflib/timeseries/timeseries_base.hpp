@@ -8,6 +8,7 @@
 #define __TIMESERIES_BASE_HPP_
 
 #include <jflib/jflib.hpp>
+#include <jflib/textwriter.hpp>
 
 
 namespace jflib { namespace timeseries {
@@ -109,15 +110,18 @@ template<class K, class T, class Tag, unsigned F, bool M>
 struct obj2string<jflib::timeseries::timeseries<K,T,Tag,F,M> > {
 	typedef jflib::timeseries::timeseries<K,T,Tag,F,M> tstype;
 	static std::string get(const tstype& ts) {
-		bool first = true;
-		std::string d;
+		textwriter w(32*ts.size());
+		put(w,ts);
+		return w.str();
+	}
+	static void put(textwriter& w, const tstype& ts) {
 		for(typename tstype::const_iterator it=ts.begin();it!=ts.end();++it) {
-			if(!first)
-				d += "\n";
-			first = false;
-			d += obj2str(it->first) + ": " + obj2str(it->second);
+			if(it!=ts.begin())
+				w.put('\n');
+			textformat<K>::put(w,it->first);
+			w.put(": ",2);
+			textformat<typename tstype::mapped_type>::put(w,it->second);
 		}
-		return d;
 	}
 };
 
@@ -128,16 +132,9 @@ template<class T, class M, unsigned F>
 struct obj2string<jflib::timeseries::maskedvector<T,M,F> > {
 	typedef jflib::timeseries::maskedvector<T,M,F> masked_type;
 	static std::string get(const masked_type& ts) {
-		std::string d = "[";
-		bool first = true;
-		for(typename masked_type::const_iterator it=ts.begin();it!=ts.end();++it) {
-			if(!first)
-				d+=", ";
-			first = false;
-			d += obj2str(*it);
-		}
-		d+="]";
-		return d;
+		textwriter w(16*ts.size());
+		textformat<masked_type>::put(w,ts);
+		return w.str();
 	}
 };
 
@@ -152,6 +149,24 @@ struct obj2string<jflib::timeseries::maskedvectorelem<T> > {
 	}
 };
 
+template<class T, class M, unsigned F>
+struct textformat<jflib::timeseries::maskedvector<T,M,F> > {
+	typedef jflib::timeseries::maskedvector<T,M,F> masked_type;
+	typedef typename masked_type::value_type value_type;
+	static void put(textwriter& w, const masked_type& v) {
+		w.put('[');
+		for(std::size_t c=0;c<v.size();++c) {
+			if(c)
+				w.put(", ",2);
+			if(v.mask()[c])
+				textformat<value_type>::put(w,v.data()[c]);
+			else
+				w.put("#N/A",4);
+		}
+		w.put(']');
+	}
+};
+
 
 }
 
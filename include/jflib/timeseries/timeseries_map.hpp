@@ -128,10 +128,7 @@ private:
 	std::string	m_name;
 
 	void _copy(self_type& ts, const_iterator start, const_iterator end) const {
-		iterator io = ts.begin();
-		for(const_iterator it = start; it != end; ++it) {
-			io = ts.insert(io, value_type(it->first,it->second));
-		}
+		ts.insert(start,end);
 	}
 };
 
@@ -9,6 +9,7 @@
 #include <jflib/jflib.hpp>
 #include <jflib/timeseries/masked/oper.hpp>
 #include <jflib/timeseries/structures.hpp>
+#include <jflib/timeseries/impl/rowindex.hpp>
 #include <jflib/timeseries/traits/matrix.hpp>
 #include <jflib/timeseries/traits/utils.hpp>
 
@@ -25,6 +26,8 @@ namespace jflib { namespace timeseries {
  *
  * A timeseries of family 1 is based on a matrix structure for the data.
  * This type of structure facilitate econometric analysis of multivariate time-series.
+ * Rows are indexed by a sorted array of keys (see rowindex), row proxies
+ * are created on demand while iterating.
  */
 template<class Key, class T, class Tag>
 class timeseries<Key,T,Tag,1u,true>: public timeseries_base<timeseries<Key,T,Tag,1u,true> >  {
@@ -41,19 +44,18 @@ public:
 	typedef traits::matrix_traits<matrix_data_type>							matrix_data_traits;
 	typedef typename matrix_data_traits::reference_type						matrix_data_reference;
 	typedef maskedvector<matrix_data_type,matrix_mask_type,tag::family>		mapped_type;
-	typedef matrixmap<mapped_type>											maptag;
-	typedef typename traits::ts<key_type,mapped_type,maptag>::type			map_type;
+	typedef rowindex<key_type,mapped_type>									index_type;
 
-	typedef typename map_type::value_type									value_type;
+	typedef typename index_type::value_type									value_type;
 	typedef typename mapped_type::size_type									size_type;
 
-	// Map iterators
-	typedef typename map_type::iterator										iterator;
-	typedef typename map_type::const_iterator								const_iterator;
-	typedef typename map_type::key_iterator									key_iterator;
-	typedef typename map_type::const_key_iterator							const_key_iterator;
-	typedef typename map_type::val_iterator									val_iterator;
-	typedef typename map_type::const_val_iterator							const_val_iterator;
+	// Index iterators
+	typedef typename index_type::iterator									iterator;
+	typedef typename index_type::const_iterator								const_iterator;
+	typedef typename index_type::key_iterator								key_iterator;
+	typedef typename index_type::const_key_iterator							const_key_iterator;
+	typedef typename index_type::val_iterator								val_iterator;
+	typedef typename index_type::const_val_iterator							const_val_iterator;
 
 	typedef typename daycountertype<key_type>::type							daycounter;
 
@@ -61,14 +63,24 @@ public:
 	typedef typename mapped_type::traits_type	 							matrix_type;
 	typedef typename mapped_type::traits_type_ptr 							matrix_type_ptr;
 
+	// Zero-copy windows over the shared data
+	typedef traits::range													range;
+	typedef boost::numeric::ublas::matrix_range<const matrix_data_type>		matrix_data_range;
+	typedef boost::numeric::ublas::matrix_range<const matrix_mask_type>		matrix_mask_range;
+
 	static const unsigned family 	 = tag::family;
 	static const bool multipleseries = true;
 
-	timeseries():m_data(new matrix_type){}
-	timeseries(const std::string& name):m_name(name),m_data(new matrix_type){}
-	timeseries(size_type TT, size_type NN):m_data(new matrix_type(TT,NN)){}
-	timeseries(const std::string& name, size_type TT, size_type NN):m_name(name),m_data(new matrix_type(TT,NN)){}
-	timeseries(const timeseries& rhs):m_name(rhs.m_name),m_data(rhs.m_data),m_map(rhs.m_map){}
+	timeseries():m_data(new matrix_type),m_index(m_data,range(0,0)){}
+	timeseries(const std::string& name):m_name(name),m_data(new matrix_type),m_index(m_data,range(0,0)){}
+	timeseries(size_type TT, size_type NN):m_data(new matrix_type(TT,NN)),m_index(m_data,range(0,NN)) {m_index.reserve(TT);}
+	timeseries(const std::string& name, size_type TT, size_type NN):
+		m_name(name),m_data(new matrix_type(TT,NN)),m_index(m_data,range(0,NN)) {m_index.reserve(TT);}
+	timeseries(const timeseries& rhs):m_name(rhs.m_name),m_data(rhs.m_data),m_index(rhs.m_index){}
+
+	/// \brief Timeseries over existing data and index (see shared::attach)
+	timeseries(const std::string& name, matrix_type_ptr data, const index_type& index):
+		m_name(name),m_data(data),m_index(index){}
 
 	// Template Copy constructor
 	template<class Ctag, unsigned F2, bool M2>
@@ -81,81 +93,196 @@ public:
 		}
 		timeseries ts(rhs.size(),rhs.series());
 		size_type r = 0;
-		iterator it1 = ts.begin();
-		map_type map = ts.map();
 		for(typename tstype::const_iterator it=rhs.begin(); it!=rhs.end(); ++it) {
 			mapped_type row(ts.m_data, r);
-			it1 = map.insert(it1, value_type(it->first,row));
 			traits::CopyRow<tstype::multipleseries,multipleseries>::copy(it->second,row);
+			ts.m_index.push_back(it->first);
 			r++;
 		}
 		return ts;
 	}
 
 	const std::string& name() const {return m_name;}
-	bool	  empty()      const  {return m_map.empty();}
-	size_type size()       const  {return m_map.size();}
-	size_type series()     const  {return m_data->data.size2();}
+	bool	  empty()      const  {return m_index.empty();}
+	size_type size()       const  {return m_index.size();}
+	size_type series()     const  {return m_index.cols().size();}
 	size_type	masked()	const {return 0;}
 
+	/// \brief True if the timeseries is a window over a larger matrix
+	bool	  is_view()	   const  {return m_index.is_window() || this->series() != m_data->cols();}
+
+	/// \brief True if keys and data are external and cannot be modified
+	bool	  is_readonly() const {return m_index.is_readonly();}
+
 	size_type removemasked() {QM_FAIL("Cannot remove masked values in this timeseries structure");}
 
 	const self_type& apply() const {return *this;}
-	bool has_key(const key_type& key) const {return m_map.has_key(key);}
-	const mapped_type& at(const key_type& key) const {return m_map.at(key);}
+	bool has_key(const key_type& key) const {return m_index.has_key(key);}
+	mapped_type at(const key_type& key) const {return m_index.at(key);}
 	void add(const key_type& key, const mapped_type& value) {QM_FAIL("Cannot add items to this timeseries");}
 	bool is_valid() const {return true;}
 
 	// Functions used by Python.
-	matrix_data_type data() const {return m_data->data;}
-	matrix_mask_type mask() const {return m_data->mask;}
-
-	const map_type& map() const {return m_map;}
-
-	iterator				begin()			  {return m_map.begin();}
-	iterator				end()			  {return m_map.end();}
-	const_iterator			begin()		const {return m_map.begin();}
-	const_iterator			end()		const {return m_map.end();}
-
-	// The map keys iterators
-	key_iterator			key_begin()       {return m_map.key_begin();}
-	key_iterator	    	key_end()		  {return m_map.key_end();}
-	const_key_iterator  	key_begin() const {return m_map.key_begin();}
-	const_key_iterator  	key_end()   const {return m_map.key_end();}
-
-	// The map values iterators
-	val_iterator			val_begin()       {return m_map.val_begin();}
-	val_iterator	    	val_end()		  {return m_map.val_end();}
-	const_val_iterator  	val_begin() const {return m_map.val_begin();}
-	const_val_iterator  	val_end()   const {return m_map.val_end();}
+	matrix_data_type data() const {return matrix_data_type(this->data_range());}
+	matrix_mask_type mask() const {return matrix_mask_type(this->mask_range());}
+
+	const index_type& index() const {return m_index;}
+	/// \deprecated Use index(), the row index has the interface of the map it replaces
+	const index_type& map() const {return m_index;}
+
+	// Rows are proxies created on demand, iterators are the same with or without const
+	iterator				begin()			  {return m_index.begin();}
+	iterator				end()			  {return m_index.end();}
+	const_iterator			begin()		const {return m_index.begin();}
+	const_iterator			end()		const {return m_index.end();}
+	const_iterator			find(const key_type& key) const {return m_index.find(key);}
+
+	// The keys iterators
+	key_iterator			key_begin()       {return m_index.key_begin();}
+	key_iterator	    	key_end()		  {return m_index.key_end();}
+	const_key_iterator  	key_begin() const {return m_index.key_begin();}
+	const_key_iterator  	key_end()   const {return m_index.key_end();}
+
+	// The values iterators
+	val_iterator			val_begin()       {return m_index.val_begin();}
+	val_iterator	    	val_end()		  {return m_index.val_end();}
+	const_val_iterator  	val_begin() const {return m_index.val_begin();}
+	const_val_iterator  	val_end()   const {return m_index.val_end();}
+
+	value_type				front()		const {return m_index.front();}
+	value_type				back()		const {return m_index.back();}
+
+	/// \brief Zero-copy view of the dates in (start, end]
+	self_type view(const key_type& start, const key_type& end) const {
+		size_type first = m_index.upper_bound(start).row();
+		size_type last  = std::max(first,m_index.upper_bound(end).row());
+		return self_type(*this,index_type(m_index,first,last,m_index.cols()));
+	}
 
-	const value_type&		front()		const {return m_map.front();}
-	const value_type&		back()		const {return m_map.back();}
+	/// \brief Zero-copy view of the series in [start, end)
+	self_type columns(size_type start, size_type end) const {
+		QM_REQUIRE(start <= end && end <= this->series(),"Out of bound");
+		size_type c0 = m_index.cols().start();
+		range rows = m_index.rows();
+		return self_type(*this,index_type(m_index,rows.start(),rows.start()+rows.size(),range(c0+start,c0+end)));
+	}
 
 	self_type copy(const key_type& start, const key_type& end) const {
-		QM_FAIL("copy not implemented");
+		return this->view(start,end).clone();
 	}
 
+	/// \brief Deep copy of the data in the timeseries window
 	self_type clone() const {
-		QM_FAIL("copy not implemented");
+		self_type ts(m_name,this->size(),this->series());
+		ts.m_data->data = this->data_range();
+		ts.m_data->mask = this->mask_range();
+		for(const_key_iterator k=this->key_begin(); k!=this->key_end(); ++k)
+			ts.m_index.push_back(*k);
+		return ts;
 	}
 
+	/// \brief Append key with values ae at row r, growing the matrix if needed
 	template<class AE>
 	iterator insertexpression(iterator it, size_type r, const key_type& key, const AE& ae) {
-		mapped_type m(m_data, r);
+		QM_REQUIRE(!this->is_readonly(),"Cannot add rows to a read-only timeseries");
+		QM_REQUIRE(!m_index.is_pinned(),"Cannot add rows while arrays share the timeseries memory");
+		QM_REQUIRE(r == this->nextrow(),"Rows must be inserted in order");
+		if(r >= m_data->rows()) {
+			QM_REQUIRE(!this->is_view(),"Cannot add rows to a timeseries view");
+			size_type S = m_data->cols() ? m_data->cols() : size_type(ae.size());
+			m_data->data.resize(std::max(r+1,2*m_data->rows()),S);
+			m_data->mask.resize(std::max(r+1,2*m_data->rows()),S);
+			m_index.cols(range(0,S));
+		}
+		mapped_type m(m_data, r, m_index.cols());
 		m = ae;
-		return m_map.insert(it, value_type(key,m));
+		std::fill(m.mask_begin(),m.mask_end(),1);
+		return m_index.push_back(key);
 	}
 
-	matrix_type_ptr             support() {return m_data;}
+	/// \brief Row of the next key appended to the timeseries
+	size_type nextrow() const {return m_index.rows().start() + m_index.size();}
+
+	/// \brief Append key for row r without touching the row values
+	iterator insertrow(iterator it, size_type r, const key_type& key) {
+		QM_REQUIRE(r == this->nextrow(),"Rows must be inserted in order");
+		return m_index.push_back(key);
+	}
+
+	/**
+	 * \brief Append rows from sorted keys and a row-major array of S values per key
+	 *
+	 * The matrix is resized once. NaN values are masked.
+	 */
+	template<class KeyIterator, class ValIterator>
+	void load(KeyIterator kfirst, KeyIterator klast, ValIterator vfirst, size_type S) {
+		QM_REQUIRE(!this->is_readonly(),"Cannot add rows to a read-only timeseries");
+		QM_REQUIRE(!m_index.is_pinned(),"Cannot add rows while arrays share the timeseries memory");
+		QM_REQUIRE(!this->is_view(),"Cannot add rows to a timeseries view");
+		QM_REQUIRE(this->empty() || S == this->series(),"Number of series does not match");
+		size_type r = this->nextrow();
+		size_type N = r + std::distance(kfirst,klast);
+		if(N > m_data->rows() || S != m_data->cols()) {
+			m_data->data.resize(N,S);
+			m_data->mask.resize(N,S);
+			m_index.cols(range(0,S));
+		}
+		for(;kfirst!=klast;++kfirst,++r) {
+			for(size_type c=0;c<S;++c,++vfirst) {
+				numtype v = *vfirst;
+				m_data->data(r,c) = v;
+				m_data->mask(r,c) = v == v ? 1 : 0;
+			}
+			m_index.push_back(*kfirst);
+		}
+	}
+
+	/// \brief Make room for n rows of S series, so that loading them does not resize the matrix again
+	void reserve(size_type n, size_type S) {
+		QM_REQUIRE(!this->is_readonly(),"Cannot add rows to a read-only timeseries");
+		QM_REQUIRE(!m_index.is_pinned(),"Cannot add rows while arrays share the timeseries memory");
+		QM_REQUIRE(!this->is_view(),"Cannot add rows to a timeseries view");
+		QM_REQUIRE(this->empty() || S == this->series(),"Number of series does not match");
+		if(n > m_data->rows() || S != m_data->cols()) {
+			m_data->data.resize(std::max(n,m_data->rows()),S);
+			m_data->mask.resize(std::max(n,m_data->rows()),S);
+			m_index.cols(range(0,S));
+		}
+		m_index.reserve(n);
+	}
+
+	/// \brief Append a series with constant value v
+	void appendseries(const numtype& v) {
+		QM_REQUIRE(!this->is_readonly(),"Cannot add series to a read-only timeseries");
+		QM_REQUIRE(!m_index.is_pinned(),"Cannot add series while arrays share the timeseries memory");
+		QM_REQUIRE(!this->is_view(),"Cannot add series to a timeseries view");
+		size_type N = m_data->rows();
+		size_type S = m_data->cols();
+		m_data->data.resize(N,S+1);
+		m_data->mask.resize(N,S+1);
+		for(size_type r=0;r<N;++r) {
+			m_data->data(r,S) = v;
+			m_data->mask(r,S) = 1;
+		}
+		m_index.cols(range(0,S+1));
+	}
+
+	matrix_type_ptr             support() const {return m_data;}
 	const matrix_data_type&		internal_data() const {return m_data->data;}
 	matrix_data_type&			internal_data() {return m_data->data;}
 
+	/// \brief The window of the shared data seen by this timeseries
+	matrix_data_range			data_range() const {return matrix_data_range(m_data->data,m_index.rows(),m_index.cols());}
+	matrix_mask_range			mask_range() const {return matrix_mask_range(m_data->mask,m_index.rows(),m_index.cols());}
+
 	self_type tomatrix() const {return *this;}
 private:
 	std::string			m_name;
 	matrix_type_ptr		m_data;
-	map_type			m_map;
+	index_type			m_index;
+
+	timeseries(const timeseries& rhs, const index_type& index):
+		m_name(rhs.m_name),m_data(rhs.m_data),m_index(index){}
 };
 
 
@@ -43,7 +43,7 @@ struct AddTs<timeseries<K,T,tag1,0u,true>, timeseries<K,T,tag2,tag2::family,tag2
 
 		iterator  i1 = ts1.begin();
 		size_type  S = ts1.series();
-		size_type S2 = ts1.series();
+		size_type S2 = ts2.series();
 
 
 		// if timeserie is empty simply copy timeserie2
@@ -54,34 +54,29 @@ struct AddTs<timeseries<K,T,tag1,0u,true>, timeseries<K,T,tag2,tag2::family,tag2
 			}
 		}
 		else {
-			// Loop over timeseries 2
-			for(typename TS2::const_iterator it=ts2.begin();it!=ts2.end();++it) {
-				i1 = ts1.lower_bound(it->first);
-
-				if(i1 != ts1.end()) {
-					// Found data with same date, append to vector
-					if(i1->first == it->first) {
-						i1->second.push_back(it->second);
-					}
-					// No data found
-					else {
-						mapped_type ne(S);
-						ne.push_back(it->second);
-						ts1.insert(i1,value_type(it->first,ne));
-					}
-				}
-				else {
+			// Single linear merge of the two sorted key sequences.
+			// Rows only in ts1 are padded, rows only in ts2 are inserted
+			// with a hint so that each step is amortised constant time.
+			typename TS2::const_iterator it = ts2.begin();
+			while(it != ts2.end()) {
+				if(i1 == ts1.end() || it->first < i1->first) {
 					mapped_type ne(S);
 					ne.push_back(it->second);
-					ts1.insert(value_type(it->first,ne));
+					ts1.insert(i1,value_type(it->first,ne));
+					++it;
 				}
-			}
-
-			// And now check for othe missing values
-			for(i1 = ts1.begin(); i1!= ts1.end(); ++i1) {
-				if(i1->second.size() == S)
+				else if(i1->first < it->first) {
 					i1->second.push_empty(S2);
+					++i1;
+				}
+				else {
+					i1->second.push_back(it->second);
+					++i1;
+					++it;
+				}
 			}
+			for(;i1!=ts1.end();++i1)
+				i1->second.push_empty(S2);
 		}
 		return ts1;
 	}
@@ -168,10 +163,7 @@ struct AddTsDummy<timeseries<K,T,tag,1u,true> > {
 		size_type N = ts.size();
 		if(!N)
 			return ts;
-		size_type S = ts.series();
-		ts.internal_data().resize(N,S+1);
-		for(size_type r=0;r<N;++r)
-			ts.internal_data()(r,S) = v;
+		ts.appendseries(v);
 		return ts;
 	}
 };
@@ -0,0 +1,162 @@
+/**
+ * \brief Text export of timeseries
+ *
+ * Keys and values are formatted straight into a textwriter, so that the
+ * cost of exporting a series is linear in its size. Three formats are
+ * available
+ *
+ * - repr: one "key: value" line per key
+ * - csv: a header line and one line per key, missing values are empty
+ * - json: flot-style array of [timestamp, value, ...] with timestamps in
+ *   milliseconds since the unix epoch, missing values are null
+ */
+
+#ifndef __TIMESERIES_WRITER_HPP__
+#define __TIMESERIES_WRITER_HPP__
+
+#include <jflib/datetime/date.hpp>
+#include <jflib/timeseries/timeseries_base.hpp>
+#include <jflib/textwriter.hpp>
+
+
+namespace jflib { namespace timeseries { namespace writer {
+
+
+	typedef std::size_t		size_type;
+
+
+	/**
+	 * \brief Key formatting, by default with the key textformat
+	 */
+	template<class K>
+	struct keyformat {
+		static void iso(textwriter& w, const K& k)		{textformat<K>::put(w,k);}
+		static void epoch(textwriter& w, const K& k)	{textformat<K>::put(w,k);}
+	};
+
+	/// \brief Dates are YYYY-MM-DD in csv and milliseconds since the epoch in json
+	template<>
+	struct keyformat<qdate> {
+		static void iso(textwriter& w, const qdate& k)		{w.putdate(k.year(),k.month(),k.day());}
+		static void epoch(textwriter& w, const qdate& k)	{w.putint(1000*k.timegm());}
+	};
+
+
+	/**
+	 * \brief Cells of a mapped value, by default a single always valid cell
+	 */
+	template<class T>
+	struct cells {
+		static size_type size(const T&)							{return 1;}
+		static bool valid(const T&, size_type)						{return true;}
+		static void put(textwriter& w, const T& x, size_type)		{textformat<T>::put(w,x);}
+	};
+
+	template<>
+	struct cells<double> {
+		static size_type size(double)								{return 1;}
+		static bool valid(double x, size_type)					{return x == x && std::fabs(x) <= 1.7976931348623157e308;}
+		static void put(textwriter& w, double x, size_type)		{w.putdouble(x);}
+	};
+
+	/// \brief A cell for each series, masked and non finite values are not valid
+	template<class D, class M, unsigned F>
+	struct cells<maskedvector<D,M,F> > {
+		typedef maskedvector<D,M,F>				masked_type;
+		typedef typename masked_type::value_type	value_type;
+		static size_type size(const masked_type& x)		{return x.size();}
+		static bool valid(const masked_type& x, size_type c) {
+			return x.mask()[c] && cells<value_type>::valid(x.data()[c],0);
+		}
+		static void put(textwriter& w, const masked_type& x, size_type c) {
+			cells<value_type>::put(w,x.data()[c],0);
+		}
+	};
+
+
+	/// \brief One "key: value" line per key, as the timeseries __repr__
+	template<class TS>
+	void repr(const TS& ts, textwriter& w) {
+		obj2string<TS>::put(w,ts);
+	}
+
+	/**
+	 * \brief CSV lines with the keys in the first column
+	 *
+	 * The header holds the name of a single series or the series numbers.
+	 */
+	template<class TS>
+	void csv(const TS& ts, textwriter& w, char delimiter = ',') {
+		typedef typename TS::key_type		key_type;
+		typedef typename TS::mapped_type	mapped_type;
+		typedef cells<mapped_type>			cells_type;
+		size_type S = ts.series();
+		w.put("date",4);
+		for(size_type c=0;c<S;++c) {
+			w.put(delimiter);
+			if(!TS::multipleseries && !ts.name().empty())
+				w.put(ts.name());
+			else
+				w.putint(c);
+		}
+		w.put('\n');
+		for(typename TS::const_iterator it=ts.begin();it!=ts.end();++it) {
+			keyformat<key_type>::iso(w,it->first);
+			const mapped_type& x = it->second;
+			for(size_type c=0;c<cells_type::size(x);++c) {
+				w.put(delimiter);
+				if(cells_type::valid(x,c))
+					cells_type::put(w,x,c);
+			}
+			w.put('\n');
+		}
+	}
+
+	/**
+	 * \brief Flot-style JSON array [[timestamp, value, ...], ...]
+	 */
+	template<class TS>
+	void json(const TS& ts, textwriter& w) {
+		typedef typename TS::key_type		key_type;
+		typedef typename TS::mapped_type	mapped_type;
+		typedef cells<mapped_type>			cells_type;
+		w.put('[');
+		for(typename TS::const_iterator it=ts.begin();it!=ts.end();++it) {
+			if(it!=ts.begin())
+				w.put(',');
+			w.put('[');
+			keyformat<key_type>::epoch(w,it->first);
+			const mapped_type& x = it->second;
+			for(size_type c=0;c<cells_type::size(x);++c) {
+				w.put(',');
+				if(cells_type::valid(x,c))
+					cells_type::put(w,x,c);
+				else
+					w.put("null",4);
+			}
+			w.put(']');
+		}
+		w.put(']');
+	}
+
+
+	/// \brief Convenience functions returning a string
+	template<class TS>
+	std::string tocsv(const TS& ts, char delimiter = ',') {
+		textwriter w(24*ts.size()*(ts.series() + 1));
+		csv(ts,w,delimiter);
+		return w.str();
+	}
+
+	template<class TS>
+	std::string tojson(const TS& ts) {
+		textwriter w(24*ts.size()*(ts.series() + 1));
+		json(ts,w);
+		return w.str();
+	}
+
+
+}}}
+
+
+#endif	//	__TIMESERIES_WRITER_HPP__
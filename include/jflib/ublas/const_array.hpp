@@ -0,0 +1,244 @@
+//
+/// \file
+/// \brief ublas storage array which may repeat a single value
+/// \ingroup ublas
+//
+#ifndef		__UBLAS_CONST_ARRAY_HPP__
+#define		__UBLAS_CONST_ARRAY_HPP__
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/numeric/ublas/storage.hpp>
+
+
+namespace jflib { namespace ublas {
+
+
+/** \brief ublas storage array which may repeat a single value
+ *
+ *	It behaves as boost::numeric::ublas::array_adaptor, owning its elements
+ *	or aliasing external memory, and can also be a constant array holding
+ *	one value for all its elements, so that a large matrix of a single
+ *	value takes no memory. Constant arrays are read-only and stay constant
+ *	until resized to another size.
+ *
+ *	Iterators step over the elements, with a step of 0 for constant arrays.
+ */
+template<class T>
+class const_array: public boost::numeric::ublas::storage_array<const_array<T> > {
+	typedef const_array<T>							self_type;
+
+	template<class V>
+	class stepiterator: public boost::iterator_facade<stepiterator<V>,V,boost::random_access_traversal_tag> {
+	public:
+		stepiterator():m_data(0),m_pos(0),m_step(1){}
+		stepiterator(V* data, std::ptrdiff_t pos, std::ptrdiff_t step):m_data(data),m_pos(pos),m_step(step){}
+		template<class W>
+		stepiterator(const stepiterator<W>& it):m_data(it.m_data),m_pos(it.m_pos),m_step(it.m_step){}
+	private:
+		template<class> friend class stepiterator;
+		friend class boost::iterator_core_access;
+
+		V*				m_data;
+		std::ptrdiff_t	m_pos;
+		std::ptrdiff_t	m_step;
+
+		V& dereference() const {return m_data[m_pos*m_step];}
+		template<class W>
+		bool equal(const stepiterator<W>& it) const {return m_pos == it.m_pos;}
+		void increment() {++m_pos;}
+		void decrement() {--m_pos;}
+		void advance(std::ptrdiff_t n) {m_pos += n;}
+		template<class W>
+		std::ptrdiff_t distance_to(const stepiterator<W>& it) const {return it.m_pos - m_pos;}
+	};
+public:
+	typedef std::size_t 							size_type;
+	typedef std::ptrdiff_t 							difference_type;
+	typedef T 										value_type;
+	typedef const T&								const_reference;
+	typedef T&										reference;
+	typedef const T*								const_pointer;
+	typedef T*										pointer;
+	typedef stepiterator<const T>					const_iterator;
+	typedef stepiterator<T>							iterator;
+	typedef std::reverse_iterator<const_iterator>	const_reverse_iterator;
+	typedef std::reverse_iterator<iterator>			reverse_iterator;
+
+	BOOST_UBLAS_INLINE
+	const_array():m_data(&m_value),m_size(0),m_step(1),m_own(false),m_value(){}
+
+	explicit BOOST_UBLAS_INLINE
+	const_array(size_type size):m_data(new value_type[size]),m_size(size),m_step(1),m_own(true),m_value(){}
+
+	BOOST_UBLAS_INLINE
+	const_array(size_type size, const value_type& init):
+		m_data(new value_type[size]),m_size(size),m_step(1),m_own(true),m_value() {
+		std::fill(m_data, m_data + size, init);
+	}
+
+	/// \brief Alias the size elements at data
+	BOOST_UBLAS_INLINE
+	const_array(size_type size, pointer data):m_data(data),m_size(size),m_step(1),m_own(false),m_value(){}
+
+	BOOST_UBLAS_INLINE
+	const_array(const const_array& c):
+		boost::numeric::ublas::storage_array<self_type>(),
+		m_data(&m_value),m_size(c.m_size),m_step(c.m_step),m_own(c.m_step != 0),m_value(c.m_value) {
+		if(m_own) {
+			m_data = new value_type[m_size];
+			std::copy(c.begin(), c.end(), m_data);
+		}
+	}
+
+	BOOST_UBLAS_INLINE
+	~const_array() {this->release();}
+
+	// Resizing
+	BOOST_UBLAS_INLINE
+	void resize(size_type size) {this->resize_internal(size, value_type(), false);}
+	BOOST_UBLAS_INLINE
+	void resize(size_type size, value_type init) {this->resize_internal(size, init, true);}
+
+	/// \brief Alias the size elements at data
+	BOOST_UBLAS_INLINE
+	void resize(size_type size, pointer data) {
+		this->release();
+		m_data = data;
+		m_size = size;
+		m_step = 1;
+	}
+
+	/// \brief Make the array a constant array of size elements equal to value
+	BOOST_UBLAS_INLINE
+	void constant(size_type size, const value_type& value) {
+		this->release();
+		m_value = value;
+		m_size  = size;
+		m_step  = 0;
+	}
+
+	BOOST_UBLAS_INLINE
+	size_type size() const {return m_size;}
+	BOOST_UBLAS_INLINE
+	size_type max_size() const {return std::numeric_limits<size_type>::max()/sizeof(T);}
+	BOOST_UBLAS_INLINE
+	bool empty() const {return m_size == 0;}
+	BOOST_UBLAS_INLINE
+	bool is_constant() const {return m_step == 0;}
+
+	/// \brief Address of the first element
+	BOOST_UBLAS_INLINE
+	const_pointer data() const {return m_data;}
+	/// \brief Distance in memory between consecutive elements, 0 for a constant array
+	BOOST_UBLAS_INLINE
+	difference_type step() const {return m_step;}
+
+	// Element access
+	BOOST_UBLAS_INLINE
+	const_reference operator [] (size_type i) const {
+		BOOST_UBLAS_CHECK(i < m_size, boost::numeric::ublas::bad_index());
+		return m_data[i*m_step];
+	}
+	BOOST_UBLAS_INLINE
+	reference operator [] (size_type i) {
+		BOOST_UBLAS_CHECK(i < m_size, boost::numeric::ublas::bad_index());
+		return m_data[i*m_step];
+	}
+
+	// Assignment, a constant array stays constant
+	BOOST_UBLAS_INLINE
+	const_array& operator = (const const_array& a) {
+		if(this != &a) {
+			if(a.is_constant())
+				this->constant(a.m_size, a.m_value);
+			else {
+				this->resize(a.m_size);
+				std::copy(a.begin(), a.end(), this->begin());
+			}
+		}
+		return *this;
+	}
+
+	BOOST_UBLAS_INLINE
+	const_array& assign_temporary(const_array& a) {
+		if(m_own && a.m_own)
+			this->swap(a);
+		else
+			*this = a;
+		return *this;
+	}
+
+	// Swapping. Pointers to the constant value of the other array are moved to our own
+	BOOST_UBLAS_INLINE
+	void swap(const_array& a) {
+		if(this == &a) return;
+		std::swap(m_data, a.m_data);
+		std::swap(m_size, a.m_size);
+		std::swap(m_step, a.m_step);
+		std::swap(m_own, a.m_own);
+		std::swap(m_value, a.m_value);
+		if(m_data == &a.m_value)
+			m_data = &m_value;
+		if(a.m_data == &m_value)
+			a.m_data = &a.m_value;
+	}
+
+	BOOST_UBLAS_INLINE
+	friend void swap(const_array& a1, const_array& a2) {a1.swap(a2);}
+
+	// Iterators
+	BOOST_UBLAS_INLINE
+	const_iterator begin() const {return const_iterator(m_data, 0, m_step);}
+	BOOST_UBLAS_INLINE
+	const_iterator end() const {return const_iterator(m_data, m_size, m_step);}
+	BOOST_UBLAS_INLINE
+	iterator begin() {return iterator(m_data, 0, m_step);}
+	BOOST_UBLAS_INLINE
+	iterator end() {return iterator(m_data, m_size, m_step);}
+
+	BOOST_UBLAS_INLINE
+	const_reverse_iterator rbegin() const {return const_reverse_iterator(end());}
+	BOOST_UBLAS_INLINE
+	const_reverse_iterator rend() const {return const_reverse_iterator(begin());}
+	BOOST_UBLAS_INLINE
+	reverse_iterator rbegin() {return reverse_iterator(end());}
+	BOOST_UBLAS_INLINE
+	reverse_iterator rend() {return reverse_iterator(begin());}
+
+private:
+	pointer			m_data;
+	size_type		m_size;
+	difference_type	m_step;
+	bool			m_own;
+	value_type		m_value;
+
+	void release() {
+		if(m_own) delete [] m_data;
+		m_data = &m_value;
+		m_own  = false;
+	}
+
+	void resize_internal(size_type size, const value_type& init, bool preserve) {
+		if(size == m_size) return;
+		pointer p = new value_type[size];
+		if(preserve) {
+			size_type n = std::min(size, m_size);
+			std::copy(this->begin(), this->begin() + n, p);
+			std::fill(p + n, p + size, init);
+		}
+		this->release();
+		m_data = p;
+		m_size = size;
+		m_step = 1;
+		m_own  = true;
+	}
+};
+
+
+}}
+
+
+#endif	//	__UBLAS_CONST_ARRAY_HPP__
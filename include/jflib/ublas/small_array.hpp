@@ -0,0 +1,195 @@
+//
+/// \file
+/// \brief ublas storage array with inline capacity
+/// \ingroup ublas
+//
+#ifndef		__UBLAS_SMALL_ARRAY_HPP__
+#define		__UBLAS_SMALL_ARRAY_HPP__
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <boost/numeric/ublas/storage.hpp>
+
+
+namespace jflib { namespace ublas {
+
+
+/** \brief ublas storage array with inline capacity
+ *
+ *	The first N elements are stored inside the object itself, so that a
+ *	small vector does not touch the heap. When the array grows beyond N
+ *	elements the storage moves to the heap and the capacity is doubled,
+ *	so that repeated resize(size()+1) calls are amortised O(1).
+ *
+ *	It models the same Storage concept as boost::numeric::ublas::unbounded_array
+ *	and can be used as the second template parameter of ublas::vector.
+ */
+template<class T, std::size_t N>
+class small_array: public boost::numeric::ublas::storage_array<small_array<T,N> > {
+	typedef small_array<T,N>						self_type;
+public:
+	typedef std::size_t 							size_type;
+	typedef std::ptrdiff_t 							difference_type;
+	typedef T 										value_type;
+	typedef const T&								const_reference;
+	typedef T&										reference;
+	typedef const T*								const_pointer;
+	typedef T*										pointer;
+	typedef const_pointer							const_iterator;
+	typedef pointer									iterator;
+	typedef std::reverse_iterator<const_iterator>	const_reverse_iterator;
+	typedef std::reverse_iterator<iterator>			reverse_iterator;
+
+	static const size_type inline_capacity = N;
+
+	BOOST_UBLAS_INLINE
+	small_array():m_data(m_inline),m_size(0),m_capacity(N){}
+
+	explicit BOOST_UBLAS_INLINE
+	small_array(size_type size):m_data(m_inline),m_size(0),m_capacity(N) {
+		this->resize_internal(size, value_type(), false);
+	}
+
+	BOOST_UBLAS_INLINE
+	small_array(size_type size, const value_type& init):m_data(m_inline),m_size(0),m_capacity(N) {
+		this->resize_internal(size, init, true);
+	}
+
+	BOOST_UBLAS_INLINE
+	small_array(const small_array& c):
+		boost::numeric::ublas::storage_array<self_type>(),m_data(m_inline),m_size(0),m_capacity(N) {
+		this->reserve_internal(c.m_size, false);
+		std::copy(c.begin(), c.end(), m_data);
+		m_size = c.m_size;
+	}
+
+	BOOST_UBLAS_INLINE
+	~small_array() {this->release();}
+
+	// Resizing
+	BOOST_UBLAS_INLINE
+	void resize(size_type size) {this->resize_internal(size, value_type(), false);}
+	BOOST_UBLAS_INLINE
+	void resize(size_type size, value_type init) {this->resize_internal(size, init, true);}
+
+	/// \brief Make sure size elements can be stored without reallocating
+	BOOST_UBLAS_INLINE
+	void reserve(size_type size) {this->reserve_internal(size, true);}
+
+	BOOST_UBLAS_INLINE
+	size_type size() const {return m_size;}
+	BOOST_UBLAS_INLINE
+	size_type capacity() const {return m_capacity;}
+	BOOST_UBLAS_INLINE
+	size_type max_size() const {return std::numeric_limits<size_type>::max()/sizeof(T);}
+	BOOST_UBLAS_INLINE
+	bool empty() const {return m_size == 0;}
+	BOOST_UBLAS_INLINE
+	bool is_inline() const {return m_data == m_inline;}
+
+	// Element access
+	BOOST_UBLAS_INLINE
+	const_reference operator [] (size_type i) const {
+		BOOST_UBLAS_CHECK(i < m_size, boost::numeric::ublas::bad_index());
+		return m_data[i];
+	}
+	BOOST_UBLAS_INLINE
+	reference operator [] (size_type i) {
+		BOOST_UBLAS_CHECK(i < m_size, boost::numeric::ublas::bad_index());
+		return m_data[i];
+	}
+
+	// Assignment
+	BOOST_UBLAS_INLINE
+	small_array& operator = (const small_array& a) {
+		if(this != &a) {
+			this->reserve_internal(a.m_size, false);
+			std::copy(a.begin(), a.end(), m_data);
+			m_size = a.m_size;
+		}
+		return *this;
+	}
+
+	BOOST_UBLAS_INLINE
+	small_array& assign_temporary(small_array& a) {
+		this->swap(a);
+		return *this;
+	}
+
+	// Swapping. Heap buffers are exchanged, inline buffers are copied
+	BOOST_UBLAS_INLINE
+	void swap(small_array& a) {
+		if(this == &a) return;
+		if(!this->is_inline() && !a.is_inline()) {
+			std::swap(m_data, a.m_data);
+			std::swap(m_size, a.m_size);
+			std::swap(m_capacity, a.m_capacity);
+		}
+		else {
+			small_array tmp(*this);
+			*this = a;
+			a = tmp;
+		}
+	}
+
+	BOOST_UBLAS_INLINE
+	friend void swap(small_array& a1, small_array& a2) {a1.swap(a2);}
+
+	// Iterators
+	BOOST_UBLAS_INLINE
+	const_iterator begin() const {return m_data;}
+	BOOST_UBLAS_INLINE
+	const_iterator end() const {return m_data + m_size;}
+	BOOST_UBLAS_INLINE
+	iterator begin() {return m_data;}
+	BOOST_UBLAS_INLINE
+	iterator end() {return m_data + m_size;}
+
+	BOOST_UBLAS_INLINE
+	const_reverse_iterator rbegin() const {return const_reverse_iterator(end());}
+	BOOST_UBLAS_INLINE
+	const_reverse_iterator rend() const {return const_reverse_iterator(begin());}
+	BOOST_UBLAS_INLINE
+	reverse_iterator rbegin() {return reverse_iterator(end());}
+	BOOST_UBLAS_INLINE
+	reverse_iterator rend() {return reverse_iterator(begin());}
+
+private:
+	pointer		m_data;
+	size_type	m_size;
+	size_type	m_capacity;
+	value_type	m_inline[N ? N : 1];
+
+	void release() {
+		if(!this->is_inline()) delete [] m_data;
+		m_data 	   = m_inline;
+		m_capacity = N;
+	}
+
+	void reserve_internal(size_type size, bool preserve) {
+		if(size <= m_capacity) return;
+		size_type cap = std::max(size, 2*m_capacity);
+		pointer p = new value_type[cap];
+		if(preserve)
+			std::copy(m_data, m_data + m_size, p);
+		else
+			m_size = 0;
+		this->release();
+		m_data 	   = p;
+		m_capacity = cap;
+	}
+
+	void resize_internal(size_type size, const value_type& init, bool preserve) {
+		this->reserve_internal(size, preserve);
+		if(preserve && size > m_size)
+			std::fill(m_data + m_size, m_data + size, init);
+		m_size = size;
+	}
+};
+
+
+}}
+
+
+#endif	//	__UBLAS_SMALL_ARRAY_HPP__
@@ -13,24 +13,35 @@ class jmain(main):
     def setup(self):
         boost = self.boostdir()
         boost_python  = self.boost('python')
-        if boost_python == None:
+        # native threads: build only the sources of this platform
+        if os.name == 'nt':
+            boost_thread = self.boost('thread', exclude = ['pthread'])
+        else:
+            boost_thread = self.boost('thread', exclude = ['win32'])
+        if boost_python == None or boost_thread == None:
             print 'Could not find boost libraries'
             return
         bplib = boost_python.name
+        btlib = boost_thread.name
         if self.debug:
             bplib = '%s_debug' % bplib
+            btlib = '%s_debug' % btlib
+        # the bloomberg tests are standalone programs
+        bloomberg_tests = os.path.join('src','tests','bloomberg')
+        sources = [s for s in self.getcpp("src") if not s.startswith(bloomberg_tests)]
             
         jflow_extenstions = self.Extension("_jflib",
-                                           sources = self.getcpp("src"),
+                                           sources = sources,
                                            include_dirs = ['include', boost,self.numpydir()],
-                                           libraries    = [bplib,'lapack'],
+                                           libraries    = [bplib,btlib,'lapack'],
                                            define_macros = [('BOOST_ALL_NO_LIB',1),
+                                                            ('BOOST_THREAD_USE_DLL',1),
                                                             ('SCL_SECURE_NO_WARNINGS',1),
                                                             ('BOOST_UBLAS_CHECK_ENABLE',0),
                                                             ('__JFLIB_UBLAS_NUMPY_CONVERSION__',1)],
-                                  depends_on   = boost_python)
+                                  depends_on   = [boost_python,boost_thread])
     
-        extension_libs = [boost_python,jflow_extenstions]
+        extension_libs = [boost_python,boost_thread,jflow_extenstions]
         pass
         self._setup(name             = "jflow",
                     version          = '0.1',
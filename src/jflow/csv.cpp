@@ -0,0 +1,411 @@
+
+#include <jflib/timeseries/csv.hpp>
+#include <jflib/threads/threadpool.hpp>
+
+#include <cmath>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+
+namespace jflib { namespace timeseries { namespace csv {
+
+namespace {
+
+	const double pow10[] = {1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,
+							1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22};
+
+	inline bool isdigit(char c) {return c >= '0' && c <= '9';}
+
+	inline bool isblank(char c) {return c == ' ' || c == '\t';}
+
+	/// \brief Parse n digits
+	inline bool digits(const char* p, int n, int& v) {
+		v = 0;
+		for(int i=0;i<n;++i) {
+			if(!isdigit(p[i]))
+				return false;
+			v = 10*v + (p[i] - '0');
+		}
+		return true;
+	}
+
+	inline bool isleap(int y) {return (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;}
+
+	/// \brief Days since 1970-01-01 of a valid date (H. Hinnant, days_from_civil)
+	inline long unixdays(int y, int m, int d) {
+		y -= m <= 2;
+		long era = (y >= 0 ? y : y - 399)/400;
+		long yoe = y - era*400;
+		long doy = (153*(m + (m > 2 ? -3 : 9)) + 2)/5 + d - 1;
+		long doe = yoe*365 + yoe/4 - yoe/100 + doy;
+		return era*146097 + doe - 719468;
+	}
+
+	/// \brief Case insensitive comparison of [p, end) with a lower case token
+	inline bool token(const char* p, const char* end, const char* t) {
+		for(;*t;++p,++t)
+			if(p == end || (*p | 0x20) != *t)
+				return false;
+		return p == end;
+	}
+
+	inline bool missing(const char* p, const char* end) {
+		return p == end || token(p,end,"na") || token(p,end,"nan") || token(p,end,"n/a") || token(p,end,"null");
+	}
+
+	/// \brief Slow path for numbers the fast path cannot round exactly
+	double classic(const char* p, const char* end) {
+		std::istringstream in(std::string(p,end));
+		in.imbue(std::locale::classic());
+		double v = 0;
+		in >> v;
+		// out of range values fail with the largest finite value
+		if(in.fail() && std::fabs(v) == std::numeric_limits<double>::max())
+			v = std::numeric_limits<double>::infinity();
+		return v;
+	}
+
+	/// \brief Rows parsed from a chunk of the file
+	struct chunk {
+		chunk():begin(0),end(0){}
+
+		const char*				begin;
+		const char*				end;
+		std::vector<qdate>		keys;
+		std::vector<double>		values;
+		std::string				error;
+	};
+
+	/// \brief Count down of running tasks
+	class latch {
+	public:
+		latch(size_type n):m_count(n){}
+		void done() {
+			boost::mutex::scoped_lock lock(m_mutex);
+			if(--m_count == 0)
+				m_ready.notify_all();
+		}
+		void wait() {
+			boost::mutex::scoped_lock lock(m_mutex);
+			while(m_count)
+				m_ready.wait(lock);
+		}
+	private:
+		boost::mutex				m_mutex;
+		boost::condition_variable	m_ready;
+		size_type					m_count;
+	};
+
+	/// \brief Split a line into fields, stripping blanks and quotes
+	///
+	/// A quoted field can contain the delimiter, a quote in it is doubled.
+	/// Fields do not span lines.
+	inline void fields(const char* p, const char* end, char delimiter,
+					   std::vector<std::pair<const char*,const char*> >& out) {
+		out.clear();
+		for(;;) {
+			while(p != end && isblank(*p))
+				++p;
+			const char* f = p;
+			const char* e;
+			if(p != end && *p == '"') {
+				f = ++p;
+				bool closed = false;
+				for(;p != end && !closed;++p)
+					if(*p == '"') {
+						if(p + 1 != end && p[1] == '"')
+							++p;
+						else
+							closed = true;
+					}
+				QM_REQUIRE(closed,"Unbalanced quotes in '" << std::string(f-1,end) << "'");
+				e = p - 1;
+				while(p != end && isblank(*p))
+					++p;
+				QM_REQUIRE(p == end || *p == delimiter,"Text after the quotes in '" << std::string(f-1,end) << "'");
+			}
+			else {
+				while(p != end && *p != delimiter)
+					++p;
+				e = p;
+				while(e != f && isblank(e[-1])) --e;
+			}
+			out.push_back(std::make_pair(f,e));
+			if(p == end)
+				return;
+			++p;
+		}
+	}
+
+	/// \brief Text of a field, with the doubled quotes of a quoted field made single
+	inline std::string unquote(const char* f, const char* e) {
+		std::string s(f,e);
+		for(std::string::size_type i=s.find("\"\"");i!=std::string::npos;i=s.find("\"\"",i+1))
+			s.erase(i,1);
+		return s;
+	}
+
+	inline const char* lineend(const char* p, const char* end) {
+		while(p != end && *p != '\n')
+			++p;
+		return p;
+	}
+
+	/// \brief Strip the carriage return of a CRLF line
+	inline const char* trimcr(const char* b, const char* e) {
+		return e != b && e[-1] == '\r' ? e - 1 : e;
+	}
+
+	struct parsechunk {
+		parsechunk(chunk& c, const options& o, size_type n, latch& l):
+			m_chunk(c),m_opts(o),m_columns(n),m_latch(l){}
+
+		void operator () () const {
+			try {
+				this->parse();
+			}
+			catch(std::exception& e) {
+				m_chunk.error = e.what();
+			}
+			m_latch.done();
+		}
+	private:
+		chunk&			m_chunk;
+		const options&	m_opts;
+		size_type		m_columns;
+		latch&			m_latch;
+
+		void parse() const {
+			typedef std::pair<const char*,const char*>	field;
+			std::vector<field> cells;
+			size_type S = m_columns - 1;
+			const char* p = m_chunk.begin;
+			while(p != m_chunk.end) {
+				const char* e = lineend(p,m_chunk.end);
+				const char* le = trimcr(p,e);
+				if(le != p) {
+					fields(p,le,m_opts.delimiter,cells);
+					QM_REQUIRE(cells.size() <= m_columns,"Too many cells in line '" << std::string(p,le) << "'");
+					qdate d;
+					QM_REQUIRE(m_opts.datecolumn < cells.size(),"Missing date in line '" << std::string(p,le) << "'");
+					const char* f = cells[m_opts.datecolumn].first;
+					QM_REQUIRE(parsedate(f,cells[m_opts.datecolumn].second,d) && f == cells[m_opts.datecolumn].second,
+							   "Cannot parse date in line '" << std::string(p,le) << "'");
+					m_chunk.keys.push_back(d);
+					for(size_type c=0;c<m_columns;++c) {
+						if(c == m_opts.datecolumn)
+							continue;
+						double v = std::numeric_limits<double>::quiet_NaN();
+						if(c < cells.size()) {
+							const char* q = cells[c].first;
+							QM_REQUIRE(parsedouble(q,cells[c].second,v) && q == cells[c].second,
+									   "Cannot parse '" << std::string(cells[c].first,cells[c].second) << "'");
+						}
+						m_chunk.values.push_back(v);
+					}
+				}
+				p = e == m_chunk.end ? e : e + 1;
+			}
+			QM_REQUIRE(m_chunk.values.size() == S*m_chunk.keys.size(),"Inconsistent number of values");
+		}
+	};
+
+	struct keyorder {
+		keyorder(const std::vector<qdate>& k):keys(k){}
+		bool operator () (size_type a, size_type b) const {return keys[a] < keys[b];}
+		const std::vector<qdate>& keys;
+	};
+
+}
+
+
+bool parsedate(const char*& p, const char* end, qdate& d) {
+	int y, m, dd;
+	const char* q = p;
+	if(end - q >= 10 && q[4] == '-' && q[7] == '-') {
+		if(!digits(q,4,y) || !digits(q+5,2,m) || !digits(q+8,2,dd))
+			return false;
+		q += 10;
+		// a time after an ISO date is ignored
+		if(q != end && (*q == 'T' || *q == ' '))
+			q = end;
+	}
+	else if(end - q >= 8) {
+		if(!digits(q,4,y) || !digits(q+4,2,m) || !digits(q+6,2,dd))
+			return false;
+		q += 8;
+	}
+	else
+		return false;
+	static const int mdays[] = {31,28,31,30,31,30,31,31,30,31,30,31};
+	if(m < 1 || m > 12 || dd < 1 || dd > mdays[m-1] + (m == 2 && isleap(y) ? 1 : 0))
+		return false;
+	d = qdate::fromunixdays(unixdays(y,m,dd));
+	p = q;
+	return true;
+}
+
+
+/**
+ * Numbers with at most 15 significant digits and a power of ten within
+ * 1e22 are computed exactly from their integer mantissa (Clinger's fast
+ * path), others are parsed by the classic locale. Numbers too large for a
+ * double are infinite.
+ */
+bool parsedouble(const char*& p, const char* end, double& v) {
+	const char* q = p;
+	if(missing(q,end)) {
+		v = std::numeric_limits<double>::quiet_NaN();
+		p = end;
+		return true;
+	}
+	bool negative = false;
+	if(*q == '-' || *q == '+')
+		negative = *q++ == '-';
+	boost::uint64_t mantissa = 0;
+	int ndigits = 0, exponent = 0;
+	bool any = false;
+	for(;q != end && isdigit(*q);++q,any=true) {
+		if(ndigits < 19) {
+			mantissa = 10*mantissa + (*q - '0');
+			if(mantissa) ++ndigits;
+		}
+		else
+			++exponent;
+	}
+	if(q != end && *q == '.') {
+		for(++q;q != end && isdigit(*q);++q,any=true) {
+			if(ndigits < 19) {
+				mantissa = 10*mantissa + (*q - '0');
+				if(mantissa) ++ndigits;
+				--exponent;
+			}
+		}
+	}
+	if(!any)
+		return false;
+	if(q != end && (*q == 'e' || *q == 'E')) {
+		const char* e = q + 1;
+		bool eneg = false;
+		if(e != end && (*e == '-' || *e == '+'))
+			eneg = *e++ == '-';
+		if(e == end || !isdigit(*e))
+			return false;
+		int x = 0;
+		for(;e != end && isdigit(*e);++e)
+			if(x < 100000) x = 10*x + (*e - '0');
+		exponent += eneg ? -x : x;
+		q = e;
+	}
+	if(mantissa == 0)
+		v = 0;
+	else if(ndigits <= 15 && exponent >= -22 && exponent <= 22) {
+		v = double(mantissa);
+		v = exponent < 0 ? v/pow10[-exponent] : v*pow10[exponent];
+	}
+	else
+		v = std::fabs(classic(p,q));
+	if(negative)
+		v = -v;
+	p = q;
+	return true;
+}
+
+
+table read(const std::string& path, const options& opts) {
+	namespace ip = boost::interprocess;
+	typedef std::pair<const char*,const char*>	field;
+	table t;
+
+	ip::file_mapping file(path.c_str(),ip::read_only);
+	ip::mapped_region region(file,ip::read_only);
+	const char* p   = static_cast<const char*>(region.get_address());
+	const char* end = p + region.get_size();
+	region.advise(ip::mapped_region::advice_sequential);
+
+	// skip a UTF-8 byte order mark
+	if(end - p >= 3 && p[0] == '\xef' && p[1] == '\xbb' && p[2] == '\xbf')
+		p += 3;
+
+	// the first non empty line gives the number of columns
+	std::vector<field> cells;
+	const char* e = lineend(p,end);
+	while(p != end && trimcr(p,e) == p) {
+		p = e == end ? e : e + 1;
+		e = lineend(p,end);
+	}
+	if(p == end)
+		return t;
+	fields(p,trimcr(p,e),opts.delimiter,cells);
+	size_type columns = cells.size();
+	QM_REQUIRE(opts.datecolumn < columns,"Date column " << opts.datecolumn << " out of bound");
+	t.series = columns - 1;
+	if(opts.header) {
+		for(size_type c=0;c<columns;++c)
+			if(c != opts.datecolumn)
+				t.names.push_back(unquote(cells[c].first,cells[c].second));
+		p = e == end ? e : e + 1;
+	}
+
+	// chunks on line boundaries
+	threads::threadpool::threadpool_ptr pool = threads::threadpool::global();
+	size_type n = opts.chunks ? opts.chunks : 4*pool->size();
+	size_type target = std::max<size_type>((end - p)/n,1 << 16);
+	std::vector<chunk> chunks;
+	while(p != end) {
+		chunk c;
+		c.begin = p;
+		c.end   = end - p > std::ptrdiff_t(target) ? lineend(p + target,end) : end;
+		if(c.end != end)
+			++c.end;
+		chunks.push_back(c);
+		p = c.end;
+	}
+
+	latch done(chunks.size());
+	for(size_type i=0;i<chunks.size();++i)
+		pool->submit(parsechunk(chunks[i],opts,columns,done));
+	done.wait();
+
+	size_type N = 0;
+	for(size_type i=0;i<chunks.size();++i) {
+		QM_REQUIRE(chunks[i].error.empty(),"Cannot read " << path << ": " << chunks[i].error);
+		N += chunks[i].keys.size();
+	}
+	t.keys.reserve(N);
+	t.values.reserve(N*t.series);
+	for(size_type i=0;i<chunks.size();++i) {
+		t.keys.insert(t.keys.end(),chunks[i].keys.begin(),chunks[i].keys.end());
+		t.values.insert(t.values.end(),chunks[i].values.begin(),chunks[i].values.end());
+		std::vector<qdate>().swap(chunks[i].keys);
+		std::vector<double>().swap(chunks[i].values);
+	}
+
+	// sort rows by date if needed
+	bool sorted = true;
+	for(size_type r=1;r<N && sorted;++r)
+		sorted = t.keys[r-1] < t.keys[r];
+	if(!sorted) {
+		std::vector<size_type> order(N);
+		for(size_type r=0;r<N;++r)
+			order[r] = r;
+		std::stable_sort(order.begin(),order.end(),keyorder(t.keys));
+		std::vector<qdate>	keys(N);
+		std::vector<double>	values(N*t.series);
+		for(size_type r=0;r<N;++r) {
+			keys[r] = t.keys[order[r]];
+			std::copy(t.values.begin() + order[r]*t.series,t.values.begin() + (order[r]+1)*t.series,
+					  values.begin() + r*t.series);
+			QM_REQUIRE(r == 0 || keys[r-1] < keys[r],"Duplicate date " << keys[r].boostdate() << " in " << path);
+		}
+		t.keys.swap(keys);
+		t.values.swap(values);
+	}
+	return t;
+}
+
+
+}}}
@@ -0,0 +1,81 @@
+
+#include <jflib/threads/threadpool.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
+
+
+namespace jflib { namespace threads {
+
+namespace {
+	boost::mutex					global_mutex;
+	threadpool::threadpool_ptr		global_pool;
+}
+
+
+threadpool::threadpool(size_type workers):m_size(workers),m_stop(false) {
+	if(!m_size)
+		m_size = std::max(1u,boost::thread::hardware_concurrency());
+	for(size_type i=0;i<m_size;++i)
+		m_workers.create_thread(boost::bind(&threadpool::run,this));
+}
+
+threadpool::~threadpool() {
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+		m_stop = true;
+	}
+	m_ready.notify_all();
+	m_workers.join_all();
+}
+
+void threadpool::submit(const task_type& task) {
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+		QM_REQUIRE(!m_stop,"Thread pool is stopping");
+		m_tasks.push_back(task);
+	}
+	m_ready.notify_one();
+}
+
+threadpool::size_type threadpool::pending() const {
+	boost::mutex::scoped_lock lock(m_mutex);
+	return m_tasks.size();
+}
+
+void threadpool::run() {
+	for(;;) {
+		task_type task;
+		{
+			boost::mutex::scoped_lock lock(m_mutex);
+			while(m_tasks.empty() && !m_stop)
+				m_ready.wait(lock);
+			if(m_tasks.empty())
+				return;
+			task.swap(m_tasks.front());
+			m_tasks.pop_front();
+		}
+		try {
+			task();
+		}
+		catch(...) {}
+	}
+}
+
+threadpool::threadpool_ptr threadpool::global() {
+	boost::mutex::scoped_lock lock(global_mutex);
+	if(!global_pool)
+		global_pool.reset(new threadpool);
+	return global_pool;
+}
+
+void threadpool::resize(size_type workers) {
+	threadpool_ptr pool(new threadpool(workers));
+	{
+		boost::mutex::scoped_lock lock(global_mutex);
+		global_pool.swap(pool);
+	}
+	// the previous pool, if not in use elsewhere, is joined here
+}
+
+
+}}
@@ -26,6 +26,7 @@ BOOST_PYTHON_MODULE(_jflib)  {
 	datetime_wrap();
 	timeseries_wrap();
 	taplefunction_wrap();
+	threads_wrap();
 
 	expose_tests();
 
@@ -404,6 +404,10 @@ void numpy_expose_converters() {
 	expose_converters<npy_int>();
 	//expose_converters<npy_uint>();
 	expose_converters<npy_long>();
+#	if NPY_BITSOF_LONG < 64
+	// int64 arrays of timeseries keys where long has 32 bits
+	expose_converters<npy_longlong>();
+#	endif
 	//expose_converters<npy_ulong>();
 	expose_converters<npy_float>();
 	expose_converters<npy_double>();
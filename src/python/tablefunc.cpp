@@ -3,6 +3,11 @@
 #include <jflib/python/pyconfig.hpp>
 #include <jflib/templates/tablefunc.hpp>
 #include <boost/python/stl_iterator.hpp>
+#include <algorithm>
+#include <vector>
+#ifdef	__JFLIB_UBLAS_NUMPY_CONVERSION__
+#	include <jflib/python/numpy/numpy_vector.hpp>
+#endif
 
 
 
@@ -26,6 +31,11 @@ struct exposetablefunc {
 	typedef ts::tablefunction<K,T>		tfunc;
 	typedef typename tfunc::value_type	value_type;
 	typedef tablefuncname<K,T>			tname;
+	typedef std::pair<K,T>				pair_type;
+
+	struct pair_less {
+		bool operator () (const pair_type& a, const pair_type& b) const {return a.first < b.first;}
+	};
 
 	static std::string repr(const tfunc& f) {
 		return tname::name() + ": "  + f.name();
@@ -34,15 +44,30 @@ struct exposetablefunc {
 	static tfunc fromtuplelist(const std::string& name, py::list li) {
 		typedef py::stl_input_iterator<py::tuple> tupleiter;
 		tupleiter begin(li), end;
-		tfunc f(name);
-		typename tfunc::iterator io = f.begin();
+		std::vector<pair_type> items;
+		items.reserve(py::len(li));
 		for(tupleiter it=begin;it!=end;++it) {
 			K k = py::extract<K>((*it)[0]);
-			T v = py::extract<K>((*it)[1]);
-			io = f.insert(io,value_type(k,v));
+			T v = py::extract<T>((*it)[1]);
+			items.push_back(pair_type(k,v));
 		}
+		// Sorted input is loaded in linear time
+		std::stable_sort(items.begin(),items.end(),pair_less());
+		tfunc f(name);
+		f.insert(items.begin(),items.end());
+		return f;
+	}
+
+#ifdef	__JFLIB_UBLAS_NUMPY_CONVERSION__
+	static tfunc fromarrays(const std::string& name,
+							const numpy::numpy_vector<K>& keys,
+							const numpy::numpy_vector<T>& values) {
+		QM_REQUIRE(keys.size() == values.size(),"Keys and values must have the same size");
+		tfunc f(name);
+		f.load(keys.begin(),keys.end(),values.begin());
 		return f;
 	}
+#endif
 
 	static void apply(const std::string& descr) {
 		std::string name = tname::name();
@@ -56,6 +81,9 @@ struct exposetablefunc {
 			;
 
 		py::def(name.c_str(),fromtuplelist,py::args("name","tuplelist"),"Create a table function from a list of tuples");
+#ifdef	__JFLIB_UBLAS_NUMPY_CONVERSION__
+		py::def(name.c_str(),fromarrays,py::args("name","keys","values"),"Create a table function from sorted arrays of keys and values");
+#endif
 	}
 };
 
@@ -0,0 +1,54 @@
+
+#include <jflib/python/future.hpp>
+#include <jflib/threads/latency.hpp>
+
+
+namespace jflib { namespace python {
+
+	namespace py    = boost::python;
+
+	namespace {
+		unsigned num_threads() {return threads::threadpool::global()->size();}
+
+		void set_num_threads(unsigned n) {
+			release_gil g;
+			threads::threadpool::resize(n);
+		}
+
+		boost::int64_t latency_clock() {return threads::latencyclock::now();}
+
+		py::list latency_values(const threads::latencyhistogram& h) {
+			std::vector<threads::latencyhistogram::value_type> bounds, counts;
+			h.values(bounds,counts);
+			py::list values;
+			for(std::size_t i=0;i<bounds.size();++i)
+				values.append(py::make_tuple(bounds[i],counts[i]));
+			return values;
+		}
+	}
+
+	void threads_wrap() {
+		py::class_<pyfuture>("future","Result of a jflib calculation running on the native thread pool",py::no_init)
+			.def("done",				&pyfuture::done,"True if the calculation has finished")
+			.def("wait",				&pyfuture::wait,(py::arg("timeout")=-1.0),"Wait for the calculation to finish, for timeout seconds if timeout is not negative. Return True if finished")
+			.def("result",				&pyfuture::result,(py::arg("timeout")=-1.0),"Wait for and return the result of the calculation")
+			.def("add_done_callback",	&pyfuture::add_done_callback,py::arg("fn"),"Call fn with the future, from the worker thread, when the calculation has finished")
+			;
+
+		py::class_<threads::latencyhistogram,boost::noncopyable>("latencyhistogram","Histogram of latencies in nanoseconds, within 1/16 of the value")
+			.def("record",				&threads::latencyhistogram::record,py::arg("ns"),"Count a latency in nanoseconds")
+			.def("count",				&threads::latencyhistogram::count,"Number of latencies recorded")
+			.def("mean",				&threads::latencyhistogram::mean,"Mean latency")
+			.def("min",					&threads::latencyhistogram::min,"Smallest latency")
+			.def("max",					&threads::latencyhistogram::max,"Largest latency")
+			.def("percentile",			&threads::latencyhistogram::percentile,py::arg("p"),"Latency not exceeded by p percent of the values")
+			.def("values",				latency_values,"List of (upper bound, count) of the non empty buckets")
+			.def("reset",				&threads::latencyhistogram::reset,"Forget the latencies recorded")
+			;
+
+		py::def("latency_clock",	latency_clock,"Nanoseconds on the monotonic clock of latencyhistogram");
+		py::def("num_threads",		num_threads,"Number of threads in the native thread pool");
+		py::def("set_num_threads",	set_num_threads,py::arg("n"),"Replace the native thread pool with a pool of n threads, one per core if n is 0");
+	}
+
+}}
@@ -8,11 +8,16 @@
 
 #include <jflib/datetime/date.hpp>
 #include <jflib/python/timeseries/timeseries_wrap.hpp>
+#include <jflib/timeseries/store.hpp>
+#include <jflib/timeseries/codec.hpp>
+#include <jflib/timeseries/csv.hpp>
+#include <jflib/python/gil.hpp>
 
 #include <jflib/python/ublas.hpp>
 #include <jflib/python/helpers.hpp>
 #include <jflib/python/pair_to_tuple.hpp>
 #include <boost/mpl/vector/vector10.hpp>
+#include <boost/python/stl_iterator.hpp>
 
 namespace jflib { namespace python {
 
@@ -47,6 +52,11 @@ namespace jflib { namespace python {
 	typedef ts::traits::ts<tgtdate,double,tsmatrixtag>::type	tsmatrix;
 
 	typedef ts::traits::ts<tgtdate,calcmatrix,tsmaptag>::type	tsmapmatrix;
+
+	typedef ts::traits::ts<tgtdate,double,ts::tsshared>::type	tsshared;
+	typedef ts::traits::ts<tgtdate,double,ts::tsstore>::type	tsstore;
+	typedef ts::store::reader<tgtdate,double>					tsreader;
+	typedef ts::codec::compressed<tgtdate>						tscompressed;
 	//__________________________________________________________________________________________________
 
 
@@ -63,6 +73,115 @@ namespace jflib { namespace python {
 		return li;
 	}
 
+	/**
+	 * \brief Flot data of a timeseries, a list of tuples or a JSON string
+	 */
+	py::object toflot(const tsmap& rhs, bool asjson)  {
+		if(!asjson)
+			return json<tsmap>(rhs);
+		textwriter w(32*rhs.size());
+		ts::writer::json(rhs,w);
+		return py::str(w.data(),w.size());
+	}
+
+
+	/**
+	 * \brief Align a list of numeric timeseries into a matrix timeseries
+	 */
+	tsmatrix alignmatrix(py::object li)  {
+		typedef py::stl_input_iterator<tsmap> tsiter;
+		ts::tsalign<tsmap> al;
+		for(tsiter it(li), end; it != end; ++it)
+			al.add(*it);
+		return al.tomatrix<tsmatrixtag>();
+	}
+
+	/**
+	 * \brief Align a list of numeric timeseries into a vector timeseries
+	 */
+	tsvmap alignvector(py::object li)  {
+		typedef py::stl_input_iterator<tsmap> tsiter;
+		ts::tsalign<tsmap> al;
+		for(tsiter it(li), end; it != end; ++it)
+			al.add(*it);
+		return al.tovector<tsvmaptag>();
+	}
+
+
+	/**
+	 * \brief Shared memory and memory-mapped file matrix timeseries
+	 */
+	void publish(const std::string& name, const tsmatrix& rhs)  {
+		ts::shared::publish(name,rhs);
+	}
+
+	tsshared attach(const std::string& name)  {
+		return ts::shared::attach<tgtdate,double>(name);
+	}
+
+	void publish_file(const std::string& path, const tsmatrix& rhs)  {
+		ts::shared::publish_file(path,rhs);
+	}
+
+	tsshared attach_file(const std::string& path)  {
+		return ts::shared::attach_file<tgtdate,double>(path);
+	}
+
+	void store(const std::string& path, const tsmatrix& rhs, std::size_t blocksize)  {
+		ts::store::write(path,rhs,blocksize);
+	}
+
+	tscompressed compress(const tsmatrix& rhs, std::size_t blocksize)  {
+		return ts::codec::encode(rhs,blocksize);
+	}
+
+	tscompressed opencompressed(const std::string& path)  {
+		return ts::codec::open<tgtdate>(path);
+	}
+
+	tsmatrix decompress(const tscompressed& c)  {
+		tsmatrix res(c.name());
+		c.decode(res);
+		return res;
+	}
+
+	tsmatrix decompress_range(const tscompressed& c, const tgtdate& start, const tgtdate& end)  {
+		tsmatrix res(c.name());
+		c.decode(start,end,res);
+		return res;
+	}
+
+
+	/// \brief Parse a csv file without the GIL, the table is returned in place
+	ts::csv::table readtable(const std::string& path, const ts::csv::options& opts) {
+		release_gil g;
+		return ts::csv::read(path,opts);
+	}
+
+	/**
+	 * \brief Read a csv file into a timeseries. The file is parsed without the GIL
+	 */
+	template<class TS>
+	TS readcsv(const std::string& path, const std::string& name, char delimiter, bool header,
+			   std::size_t datecolumn, std::size_t column)  {
+		ts::csv::options opts;
+		opts.delimiter  = delimiter;
+		opts.header     = header;
+		opts.datecolumn = datecolumn;
+		ts::csv::table t(readtable(path,opts));
+		TS res(name.empty() ? path : name);
+		ts::csv::load(t,res,column);
+		return res;
+	}
+
+	tsmatrix readcsv_matrix(const std::string& path, const std::string& name, char delimiter, bool header, std::size_t datecolumn)  {
+		return readcsv<tsmatrix>(path,name,delimiter,header,datecolumn,0);
+	}
+
+	tsvmap readcsv_vector(const std::string& path, const std::string& name, char delimiter, bool header, std::size_t datecolumn)  {
+		return readcsv<tsvmap>(path,name,delimiter,header,datecolumn,0);
+	}
+
 
 	void timeseries_wrap() {
 		//typedef ts::numeric::tsoper	tsoper;
@@ -76,6 +195,28 @@ namespace jflib { namespace python {
 		pyts<tsmap,    tsvmaptag, calcmatrix, ts_add_types, tsmatrixtag>::reg("numericts");
 		pyts<tsvmap,   tsvmaptag, calcmatrix, ts_add_types, tsmatrixtag>::reg("numerictsv");
 		pyts<tsmatrix, tsvmaptag, calcmatrix>::reg("matrixseries");
+		pyts<tsshared, tsvmaptag, calcmatrix>::reg("sharedseries");
+		pyts<tsstore,  tsvmaptag, calcmatrix>::reg("storeseries");
+
+		py::class_<tsreader>("storefile","Read-only memory-mapped timeseries file written by store",py::init<std::string>(py::arg("path")))
+			.add_property("size",		&tsreader::size,"Number of dates")
+			.add_property("series",		&tsreader::series,"Number of series")
+			.add_property("blocks",		&tsreader::blocks,"Number of blocks in the block index")
+			.add_property("all",		py::make_function(&tsreader::all,py::return_value_policy<py::copy_const_reference>()),
+										"The whole file as a storeseries, without copying")
+			.def("view",				&tsreader::view,(py::arg("start"),py::arg("end")),"storeseries of the dates in (start, end], located with the block index")
+			;
+
+		py::class_<tscompressed>("compressedseries","Matrix timeseries compressed in independent blocks",py::no_init)
+			.add_property("name",		&tscompressed::name)
+			.add_property("size",		&tscompressed::size,"Number of dates")
+			.add_property("series",		&tscompressed::series,"Number of series")
+			.add_property("blocks",		&tscompressed::blocks,"Number of blocks")
+			.add_property("bytes",		&tscompressed::bytes,"Number of compressed bytes")
+			.def("save",				&tscompressed::save,py::arg("path"),"Write into a file which can be opened with opencompressed")
+			.def("decompress",			decompress,"Decode into a matrixseries")
+			.def("decompress",			decompress_range,(py::arg("start"),py::arg("end")),"Decode the dates in (start, end] into a matrixseries. Only their blocks are decoded")
+			;
 
 		// Register map timeseries with matrices and its key-value pair _________________
 		pyts<tsmapmatrix, tsvmaptag>::reg("mapmatrixseries");
@@ -89,7 +230,34 @@ namespace jflib { namespace python {
 		// Expose the tsmatrix proxy element for a row
 		//expose_matrix_proxy<tsmatrix::mapped_type>("matrix_row_double","Proxy for a matrix row");
 
-		py::def("toflot",json<tsmap>,py::arg("timeseries"),"Convert a date-numeric timeseries into a timestamp-numeric tuple list");
+		py::def("toflot",toflot,(py::arg("timeseries"),py::arg("asjson")=false),
+				"Convert a date-numeric timeseries into a timestamp-numeric tuple list, or its JSON string if asjson is true");
+		py::def("alignmatrix",alignmatrix,py::arg("series"),"Align a list of numericts on the union of their dates into a matrixseries");
+		py::def("alignvector",alignvector,py::arg("series"),"Align a list of numericts on the union of their dates into a numerictsv");
+
+		py::def("publish",publish,(py::arg("name"),py::arg("series")),"Copy a matrixseries into the named shared memory segment, which lives until unpublished");
+		py::def("unpublish",ts::shared::unpublish,py::arg("name"),"Remove a shared memory segment. Attached series remain valid");
+		py::def("attach",attach,py::arg("name"),"Read-only sharedseries over a shared memory segment, without copying. Forked workers inherit it");
+		py::def("publish_file",publish_file,(py::arg("path"),py::arg("series")),"Write a matrixseries into a file which can be attached with attach_file");
+		py::def("attach_file",attach_file,py::arg("path"),"Read-only sharedseries over a memory-mapped file, without copying");
+		py::def("store",store,(py::arg("path"),py::arg("series"),py::arg("blocksize")=ts::store::blocksize),
+				"Write a matrixseries into a versioned binary file which can be opened with storefile");
+		py::def("compress",compress,(py::arg("series"),py::arg("blocksize")=ts::codec::blocksize),
+				"Compress a matrixseries: delta-of-delta keys and XOR encoded values");
+		py::def("opencompressed",opencompressed,py::arg("path"),"Memory-map a compressedseries saved to a file");
+
+		py::def("readcsv",readcsv_matrix,
+				(py::arg("path"),py::arg("name")=std::string(),py::arg("delimiter")=',',py::arg("header")=true,py::arg("datecolumn")=0),
+				"Read a csv file of dates (YYYYMMDD or YYYY-MM-DD) and numbers into a matrixseries. Missing cells are masked");
+		py::def("readcsvv",readcsv_vector,
+				(py::arg("path"),py::arg("name")=std::string(),py::arg("delimiter")=',',py::arg("header")=true,py::arg("datecolumn")=0),
+				"Read a csv file into a numerictsv. Missing cells are masked");
+		py::def("readcsvts",readcsv<tsmap>,
+				(py::arg("path"),py::arg("name")=std::string(),py::arg("delimiter")=',',py::arg("header")=true,py::arg("datecolumn")=0,py::arg("column")=0),
+				"Read a series of a csv file into a numericts. column counts the series, without the date column. Missing cells are skipped");
+
+		py::def("fromarrow",fromarrow<tgtdate>,py::arg("array"),
+				"storeseries over an arrow struct array of date32 and float64 columns (an object with __arrow_c_array__). Value buffers are shared when adjacent");
 
 //#		define EXPOSEOPER(name,type1,Op,type2) 	py::def(name,tsoper<tstype>::make<type1,Op,type2>)
 
@@ -0,0 +1,69 @@
+//
+/// \file
+/// \brief Loopback test and benchmark of blb against a bbreplay server
+///
+/// A standalone program, not part of the python extension:
+///
+/// \code
+/// g++ -O2 -DBB_PLATFORM_LINUX_INTEL -Iinclude -Iinclude/bloomberg -o loopback
+///     src/tests/bloomberg/loopback.cpp src/jflow/error.cpp -lboost_thread -lboost_system -lpthread
+/// ./loopback [seconds]
+/// \endcode
+///
+/// The tests check that every tick sent by the server is received or
+/// counted as dropped, then the benchmark streams ticks as fast as
+/// possible for the given seconds (1 by default). It returns 0 when all
+/// tests pass, the number of the first failed test otherwise.
+///
+#define BB_LOOPBACK_IMPLEMENTATION
+#include <bbload.hpp>
+
+#include <cstdlib>
+#include <iostream>
+
+
+namespace {
+
+	using namespace bloomberg;
+
+	void report(const char* name, const bbloadresult& r) {
+		std::cout << name << ": sent " << r.sent << ", received " << r.ticks << ", dropped " << r.dropped
+				  << ", " << r.rate << " ticks per second" << std::endl;
+	}
+
+	/// \brief At a rate blb keeps up with, every tick sent is received
+	int ticks() {
+		bbreplay::options opts;
+		opts.rate = 20000;
+		bbloadresult r = bbload(opts,10,1.);
+		report("ticks",r);
+		return r.sent > 0 && r.ticks == r.sent && r.dropped == 0 ? 0 : 1;
+	}
+
+	/// \brief With a pool smaller than a message, ticks not published are counted as dropped
+	int smallpool() {
+		bbreplay::options opts;
+		opts.rate = 20000;
+		bbloadresult r = bbload(opts,10,1.,4);
+		report("small pool",r);
+		return r.sent > 0 && r.ticks + r.dropped == r.sent ? 0 : 2;
+	}
+
+	/// \brief Ticks decoded per second, published or dropped, at full speed
+	int benchmark(double seconds) {
+		bbreplay::options opts;
+		bbloadresult r = bbload(opts,100,seconds);
+		report("benchmark",r);
+		return r.ticks > 0 ? 0 : 3;
+	}
+
+}
+
+
+int main(int argc, char** argv) {
+	double seconds = argc > 1 ? std::atof(argv[1]) : 1.;
+	int failed = ticks();
+	if(!failed) failed = smallpool();
+	if(!failed) failed = benchmark(seconds);
+	return failed;
+}
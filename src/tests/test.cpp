@@ -13,6 +13,13 @@ namespace jflib { namespace python {
 		py::class_<handle>("TestHandle",py::init<>())
 			.def("ublasmatrix",		&handle::ublasmatrix,"Ublas matrix operations")
 			.def("eigenvectors",	&handle::eigenvectors,py::arg("dimension"),"Eigenvectors test")
+			.def("tsmatrixroll",	&handle::tsmatrixroll,"Rolling analysis of matrix timeseries")
+			.def("tsshared",		&handle::tsshared,py::arg("path"),"Publish and attach a timeseries file at path")
+			.def("tsstore",			&handle::tsstore,py::arg("path"),"Write, read and view a timeseries file at path")
+			.def("tscodec",			&handle::tscodec,"Encode and decode a matrix timeseries")
+			.def("tscsv",			&handle::tscsv,py::arg("path"),"Read a CSV file at path")
+			.def("tsarrow",			&handle::tsarrow,"Arrow export and import of a timeseries")
+			.def("tswriter",		&handle::tswriter,"Text export of a timeseries under a comma-decimal locale")
 			;
 	}
 
@@ -0,0 +1,78 @@
+#include <jflib/tests/all.hpp>
+#include <jflib/datetime/date.hpp>
+#include <jflib/timeseries/arrow.hpp>
+
+#include <limits>
+
+
+namespace jflib { namespace tests {
+
+namespace ts = jflib::timeseries;
+
+typedef ts::traits::ts<qdate,double,ts::ublas_tsmatrix>::type	tsmatrix;
+typedef ts::traits::ts<qdate,double,ts::tsstore>::type			storets;
+
+
+/// \brief A timeseries exported to arrow and imported back is the same, read-only
+int TestHandle::tsarrow() {
+	tsmatrix m("arrow");
+	qdate	keys[] = {qdate(2010,1,4),qdate(2010,1,5),qdate(2010,1,7)};
+	double	values[] = {1,10,2,std::numeric_limits<double>::quiet_NaN(),3,30};
+	m.load(keys,keys+3,values,2);
+
+	ArrowSchema schema;
+	ArrowArray	array;
+	ts::arrow::exportts(m,&schema,&array);
+	if(std::string(schema.format) != "+s" || schema.n_children != 3 || array.length != 3)
+		return 1;
+	if(array.children[2]->null_count != 1)
+		return 2;
+	storets back = ts::arrow::importts<qdate>(&schema,&array);
+	if(schema.release || array.release)
+		return 3;
+	if(back.name() != "arrow" || back.size() != 3 || back.series() != 2)
+		return 4;
+	for(std::size_t i=0;i<3;++i) {
+		if(!(back.key_begin()[i] == keys[i]))
+			return 5;
+		for(std::size_t j=0;j<2;++j) {
+			if(back.mask()(i,j) != m.mask()(i,j))
+				return 6;
+			if(m.mask()(i,j) && back.data()(i,j) != m.data()(i,j))
+				return 7;
+		}
+	}
+	// the import may alias foreign memory
+	if(!back.is_readonly())
+		return 8;
+	try {
+		back.insertrow(back.end(),back.size(),qdate(2010,2,1));
+		return 9;
+	}
+	catch(std::exception&) {}
+	// keys of another type are refused
+	ts::arrow::exportts(m,&schema,&array);
+	try {
+		ts::arrow::importts<long>(&schema,&array);
+		return 10;
+	}
+	catch(std::exception&) {}
+	// a key column shorter than the array, or with a negative offset, is refused
+	for(int k=0;k<2;++k) {
+		ts::arrow::exportts(m,&schema,&array);
+		if(k)
+			array.children[0]->offset = -1;
+		else
+			array.children[0]->length = 2;
+		try {
+			ts::arrow::importts<qdate>(&schema,&array);
+			return 11;
+		}
+		catch(std::exception&) {}
+		if(schema.release || array.release)
+			return 12;
+	}
+	return 0;
+}
+
+}}
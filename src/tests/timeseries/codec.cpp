@@ -0,0 +1,66 @@
+#include <jflib/tests/all.hpp>
+#include <jflib/datetime/date.hpp>
+#include <jflib/timeseries/codec.hpp>
+
+#include <cmath>
+#include <limits>
+
+
+namespace jflib { namespace tests {
+
+namespace ts = jflib::timeseries;
+
+typedef ts::traits::ts<qdate,double,ts::ublas_tsmatrix>::type	tsmatrix;
+
+
+/// \brief Encoded and decoded values are the same, NaN and masked values decode as masked
+int TestHandle::tscodec() {
+	const double nan = std::numeric_limits<double>::quiet_NaN();
+	const int N = 500;
+	tsmatrix m("codec");
+	std::vector<qdate>	keys;
+	std::vector<double>	values;
+	for(int d=0;d<N;++d) {
+		keys.push_back(qdate::fromunixdays(14610 + d + (d % 5 == 4 ? 2 : 0) + 3*(d/5)));
+		values.push_back(std::floor(100.*std::sin(0.1*d))/100.);
+		values.push_back(d % 11 ? 1e-3*d : nan);
+		values.push_back(-0.);
+	}
+	m.load(keys.begin(),keys.end(),values.begin(),3);
+	// a masked value which is not NaN and an unmasked NaN
+	m.support()->mask(3,0) = 0;
+	m.support()->data(5,2) = nan;
+
+	ts::codec::compressed<qdate> c = ts::codec::encode(m,64);
+	if(c.size() != N || c.blocks() != (N + 63)/64)
+		return 1;
+	tsmatrix out("out");
+	c.decode(out);
+	if(out.size() != m.size() || out.series() != 3)
+		return 2;
+	for(std::size_t i=0;i<m.size();++i) {
+		if(!(out.key_begin()[i] == m.key_begin()[i]))
+			return 3;
+		for(std::size_t j=0;j<3;++j) {
+			bool valid = m.mask()(i,j) && !std::isnan(m.data()(i,j));
+			if(bool(out.mask()(i,j)) != valid)
+				return 4;
+			if(valid && (out.data()(i,j) != m.data()(i,j) || std::signbit(out.data()(i,j)) != std::signbit(m.data()(i,j))))
+				return 5;
+		}
+	}
+	if(out.mask()(3,0) || out.mask()(5,2) || out.mask()(0,1) || !out.mask()(1,1))
+		return 6;
+	// ranges decode the rows in (start, end]
+	for(std::size_t s=0;s<m.size();s+=37)
+		for(std::size_t e=s;e<m.size();e+=113) {
+			qdate start = m.key_begin()[s], end = m.key_begin()[e];
+			tsmatrix r("range");
+			c.decode(start,end,r);
+			if(r.size() != e - s || (r.size() && !(r.back().first == end)))
+				return 7;
+		}
+	return 0;
+}
+
+}}
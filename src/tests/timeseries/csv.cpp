@@ -0,0 +1,92 @@
+#include <jflib/tests/all.hpp>
+#include <jflib/datetime/date.hpp>
+#include <jflib/timeseries/all.hpp>
+#include <jflib/timeseries/csv.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+
+namespace jflib { namespace tests {
+
+namespace csv = jflib::timeseries::csv;
+namespace ts = jflib::timeseries;
+
+typedef ts::traits::ts<qdate,double,ts::tsmap>::type			mapts;
+typedef ts::traits::ts<qdate,double,ts::ublas_tsvmap>::type		vmapts;
+
+
+// parsedouble of the whole of s, NaN if it does not parse
+double parsed(const char* s) {
+	const char* p = s;
+	const char* end = s + std::strlen(s);
+	double v;
+	if(!csv::parsedouble(p,end,v) || p != end)
+		return std::numeric_limits<double>::quiet_NaN();
+	return v;
+}
+
+
+/// \brief Quoted fields, missing values and numbers out of the double range
+int TestHandle::tscsv(const std::string& path) {
+	{
+		std::ofstream f(path.c_str(),std::ios_base::binary);
+		f << "date,\"a, \"\"quoted\"\"\",b\r\n"
+		  << "2010-01-05, \"1.5\" ,NA\r\n"
+		  << "20100104,\"\",\"-2e3\"\r\n";
+	}
+	csv::table t = csv::read(path);
+	if(t.size() != 2 || t.series != 2 || t.names.size() != 2)
+		return 1;
+	if(t.names[0] != "a, \"quoted\"" || t.names[1] != "b")
+		return 2;
+	// rows are sorted by date
+	if(!(t.keys[0] == qdate(2010,1,4)) || !(t.keys[1] == qdate(2010,1,5)))
+		return 3;
+	if(!std::isnan(t.values[0]) || t.values[1] != -2e3 || t.values[2] != 1.5 || !std::isnan(t.values[3]))
+		return 4;
+	{
+		std::ofstream f(path.c_str(),std::ios_base::binary);
+		f << "date,a\n20100104,\"1\n";
+	}
+	try {
+		csv::read(path);
+		return 5;
+	}
+	catch(std::exception&) {}
+	// dates with text after them are rejected
+	const char* baddates[] = {"20100104abc","201001041","2010-01-04x"};
+	for(std::size_t i=0;i<3;++i) {
+		{
+			std::ofstream f(path.c_str(),std::ios_base::binary);
+			f << "date,a\n" << baddates[i] << ",1\n";
+		}
+		try {
+			csv::read(path);
+			return 9;
+		}
+		catch(std::exception&) {}
+	}
+	// a single column skips missing values, a vector series masks them
+	mapts m("m");
+	csv::load(t,m,1);
+	if(m.size() != 1 || !(m.front().first == qdate(2010,1,4)) || m.front().second != -2e3)
+		return 10;
+	vmapts v("v");
+	csv::load(t,v);
+	if(v.size() != 2 || v.front().second.mask()[0] || !v.front().second.mask()[1] || v.back().second.data()[0] != 1.5)
+		return 11;
+
+	const double inf = std::numeric_limits<double>::infinity();
+	if(parsed("1e400") != inf || parsed("-1e400") != -inf || parsed("12345678901234567890e300") != inf)
+		return 6;
+	if(parsed("1e-400") != 0 || parsed("1.7976931348623157e308") != std::numeric_limits<double>::max())
+		return 7;
+	if(parsed("0.1") != 0.1 || parsed("3.141592653589793") != 3.141592653589793 || parsed("5e-324") == 0)
+		return 8;
+	return 0;
+}
+
+}}
@@ -0,0 +1,114 @@
+#include <jflib/tests/all.hpp>
+#include <jflib/datetime/date.hpp>
+#include <jflib/timeseries/all.hpp>
+
+
+namespace jflib { namespace tests {
+
+namespace ts = jflib::timeseries;
+
+typedef ts::traits::ts<qdate,double,ts::tsmap>::type				tsmap;
+typedef ts::traits::ts<qdate,double,ts::ublas_tsmatrix>::type		tsmatrix;
+typedef boost::numeric::ublas::matrix<double,boost::numeric::ublas::column_major>	calcmatrix;
+
+
+// Three series over N days, aligned into a matrix timeseries
+tsmatrix make_matrix(int N) {
+	ts::tsalign<tsmap> al;
+	for(int s=0;s<3;++s) {
+		tsmap a;
+		for(int d=1;d<=N;++d)
+			a.add(qdate(2010,1,d),10*s + d*d + (d % 3)*s);
+		al.add(a);
+	}
+	return al.tomatrix<ts::ublas_tsmatrix>();
+}
+
+
+/// \brief Rolling operators append the rows of their intermediate timeseries in order
+int tsroll() {
+	typedef ts::econometric::analysis<tsmatrix,ts::ublas_tsvmap,calcmatrix>		vanalysis;
+	typedef ts::econometric::analysis<tsmatrix,ts::ublas_tsmatrix,calcmatrix>	manalysis;
+	const int N = 20;
+	const std::size_t W = 5;
+	tsmatrix m = make_matrix(N);
+	vanalysis va(m);
+	tsmatrix vol = va.roll_vol(W);
+	if(vol.size() != N - W || vol.series() != 3)
+		return 1;
+	// Keys of the rolled series are the last keys of the windows
+	if(!(vol.back().first == m.back().first))
+		return 2;
+	if(va.roll_covar(W).size() != N - W)
+		return 3;
+	// OLS rolls over an intermediate matrix timeseries
+	manalysis ma(m);
+	try {
+		ma.roll_ols(W);
+	}
+	catch(std::exception&) {
+		return 4;
+	}
+	return 0;
+}
+
+
+/// \brief Copies share the keys, views are fixed windows
+int tscopies() {
+	tsmatrix m = make_matrix(10);
+	tsmatrix c = m;
+	boost::numeric::ublas::vector<double> v(3,1.);
+	c.insertexpression(c.end(),c.nextrow(),qdate(2010,2,1),v);
+	m.insertexpression(m.end(),m.nextrow(),qdate(2010,2,2),v);
+	if(m.size() != 12 || c.size() != 12 || m.is_view() || c.is_view())
+		return 1;
+	tsmatrix w = m.view(qdate(2010,1,2),qdate(2010,1,5));
+	if(w.size() != 3 || !w.is_view())
+		return 2;
+	try {
+		w.insertexpression(w.end(),w.nextrow(),qdate(2010,3,1),v);
+		return 3;
+	}
+	catch(std::exception&) {}
+	return 0;
+}
+
+
+/// \brief A pinned timeseries, aliased by numpy arrays, does not grow
+int tspin() {
+	tsmatrix m = make_matrix(10);
+	tsmatrix c = m;
+	boost::numeric::ublas::vector<double> v(3,1.);
+	{
+		tsmatrix::index_type::pin p(m.index());
+		try {
+			c.insertexpression(c.end(),c.nextrow(),qdate(2010,2,1),v);
+			return 1;
+		}
+		catch(std::exception&) {}
+		try {
+			m.appendseries(0.);
+			return 2;
+		}
+		catch(std::exception&) {}
+		if(m.size() != 10 || m.series() != 3)
+			return 3;
+	}
+	m.insertexpression(m.end(),m.nextrow(),qdate(2010,2,1),v);
+	if(c.size() != 11 || *m.index().ordinals() != qdate(2010,1,1).unixdays())
+		return 4;
+	return 0;
+}
+
+
+int TestHandle::tsmatrixroll() {
+	if(int r = tsroll())
+		return r;
+	if(int r = tscopies())
+		return 10 + r;
+	if(int r = tspin())
+		return 20 + r;
+	return 0;
+}
+
+}}
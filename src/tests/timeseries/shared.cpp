@@ -0,0 +1,61 @@
+#include <jflib/tests/all.hpp>
+#include <jflib/datetime/date.hpp>
+#include <jflib/timeseries/shared.hpp>
+
+#include <fstream>
+#include <limits>
+
+
+namespace jflib { namespace tests {
+
+namespace ts = jflib::timeseries;
+
+typedef ts::traits::ts<qdate,double,ts::ublas_tsmatrix>::type	tsmatrix;
+typedef ts::traits::ts<qdate,double,ts::tsshared>::type			sharedts;
+
+
+/// \brief A file written by publish_file attaches as the timeseries, with its keys stored as ordinals
+int TestHandle::tsshared(const std::string& path) {
+	const int N = 100;
+	tsmatrix m("shared");
+	std::vector<qdate>	keys;
+	std::vector<double>	values;
+	for(int d=0;d<N;++d) {
+		keys.push_back(qdate::fromunixdays(14610 + 2*d));
+		values.push_back(d);
+		values.push_back(d % 3 ? -0.5*d : std::numeric_limits<double>::quiet_NaN());
+	}
+	m.load(keys.begin(),keys.end(),values.begin(),2);
+	ts::shared::publish_file(path,m);
+	{
+		ts::shared::header h;
+		boost::int64_t k;
+		std::ifstream f(path.c_str(),std::ios_base::binary);
+		f.read(reinterpret_cast<char*>(&h),sizeof(h));
+		f.seekg(h.keys + (N-1)*sizeof(k));
+		f.read(reinterpret_cast<char*>(&k),sizeof(k));
+		if(!f || h.keysize != sizeof(k) || k != m.back().first.unixdays())
+			return 1;
+	}
+	sharedts s = ts::shared::attach_file<qdate,double>(path);
+	if(s.name() != "shared" || s.size() != N || s.series() != 2 || !s.is_readonly())
+		return 2;
+	for(std::size_t i=0;i<m.size();++i) {
+		if(!(s.key_begin()[i] == m.key_begin()[i]))
+			return 3;
+		for(std::size_t c=0;c<2;++c) {
+			if(bool(s.mask()(i,c)) != bool(m.mask()(i,c)))
+				return 4;
+			if(m.mask()(i,c) && s.data()(i,c) != m.data()(i,c))
+				return 5;
+		}
+	}
+	try {
+		ts::shared::attach_file<qdate,float>(path);
+		return 6;
+	}
+	catch(std::exception&) {}
+	return 0;
+}
+
+}}
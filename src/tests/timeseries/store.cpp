@@ -0,0 +1,96 @@
+#include <jflib/tests/all.hpp>
+#include <jflib/datetime/date.hpp>
+#include <jflib/timeseries/store.hpp>
+
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+
+namespace jflib { namespace tests {
+
+namespace ts = jflib::timeseries;
+
+typedef ts::traits::ts<qdate,double,ts::ublas_tsmatrix>::type	tsmatrix;
+typedef ts::store::reader<qdate,double>						tsreader;
+
+
+// Two series over N business days, the second masked every seventh row if masked
+tsmatrix make_store_input(int N, bool masked = true) {
+	tsmatrix m("store");
+	std::vector<qdate>	keys;
+	std::vector<double>	values;
+	for(int d=0;d<N;++d) {
+		keys.push_back(qdate::fromunixdays(14610 + d + 2*(d/5)));
+		values.push_back(100. + d);
+		values.push_back(d % 7 || !masked ? 0.5*d : std::numeric_limits<double>::quiet_NaN());
+	}
+	m.load(keys.begin(),keys.end(),values.begin(),2);
+	return m;
+}
+
+
+/// \brief A file written by store::write reads back as the timeseries, views are windows of it
+int TestHandle::tsstore(const std::string& path) {
+	const int N = 1000;
+	tsmatrix m = make_store_input(N);
+	ts::store::write(path,m,64);
+	tsreader r(path);
+	const tsreader::tstype& all = r.all();
+	if(r.size() != N || r.series() != 2 || all.size() != N || r.blocks() != (N + 63)/64)
+		return 1;
+	if(!all.is_readonly() || all.support()->mask.data().is_constant())
+		return 2;
+	for(std::size_t i=0;i<m.size();++i) {
+		if(!(all.key_begin()[i] == m.key_begin()[i]))
+			return 3;
+		for(std::size_t c=0;c<2;++c) {
+			if(all.mask()(i,c) != m.mask()(i,c))
+				return 4;
+			if(m.mask()(i,c) && all.data()(i,c) != m.data()(i,c))
+				return 5;
+		}
+	}
+	// views across block boundaries are the same as views of the input
+	for(std::size_t s=0;s<m.size();s+=97)
+		for(std::size_t e=s;e<m.size();e+=151) {
+			qdate start = m.key_begin()[s], end = m.key_begin()[e];
+			tsreader::tstype v = r.view(start,end);
+			tsmatrix w = m.view(start,end);
+			if(v.size() != w.size())
+				return 6;
+			if(v.size() && (!(v.front().first == w.front().first) || !(v.back().first == w.back().first)))
+				return 7;
+		}
+	if(r.view(m.back().first,m.back().first).size() != 0)
+		return 8;
+	try {
+		ts::store::reader<qdate,float> wrong(path);
+		return 9;
+	}
+	catch(std::exception&) {}
+
+	// keys are stored as their ordinals
+	{
+		ts::store::header h;
+		boost::int64_t k;
+		std::ifstream f(path.c_str(),std::ios_base::binary);
+		f.read(reinterpret_cast<char*>(&h),sizeof(h));
+		f.seekg(h.keys + (N-1)*sizeof(k));
+		f.read(reinterpret_cast<char*>(&k),sizeof(k));
+		if(!f || h.keysize != sizeof(k) || k != m.back().first.unixdays())
+			return 10;
+	}
+	// without missing values the mask is constant and all valid
+	m = make_store_input(N,false);
+	ts::store::write(path,m,64);
+	tsreader c(path);
+	if(c.info().mask || !c.all().support()->mask.data().is_constant())
+		return 11;
+	tsreader::tstype v = c.view(m.key_begin()[10],m.key_begin()[20]);
+	if(v.size() != 10 || !v.mask()(9,1) || v.data()(9,1) != 0.5*20)
+		return 12;
+	return 0;
+}
+
+}}
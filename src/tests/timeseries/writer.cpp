@@ -0,0 +1,72 @@
+#include <jflib/tests/all.hpp>
+#include <jflib/datetime/date.hpp>
+#include <jflib/timeseries/all.hpp>
+#include <jflib/timeseries/writer.hpp>
+
+#include <clocale>
+#include <locale>
+
+
+namespace jflib { namespace tests {
+
+namespace ts = jflib::timeseries;
+
+typedef ts::traits::ts<qdate,double,ts::tsmap>::type	mapts;
+
+
+namespace {
+
+	/// \brief Numbers with a comma as decimal point and grouped thousands
+	struct commapunct: std::numpunct<char> {
+		char do_decimal_point() const {return ',';}
+		char do_thousands_sep() const {return '.';}
+		std::string do_grouping() const {return "\3";}
+	};
+
+	/// \brief Set a comma-decimal locale as global C++ locale, and as C locale when one is installed
+	struct commalocale {
+		commalocale():m_cpp(std::locale::global(std::locale(std::locale::classic(),new commapunct))),
+					  m_c(std::setlocale(LC_NUMERIC,0)) {
+			const char* names[] = {"de_DE.UTF-8","de_DE.utf8","fr_FR.UTF-8","fr_FR.utf8","de_DE","fr_FR"};
+			for(std::size_t i=0;i<sizeof(names)/sizeof(names[0]);++i)
+				if(std::setlocale(LC_NUMERIC,names[i]))
+					break;
+		}
+		~commalocale() {
+			std::setlocale(LC_NUMERIC,m_c.c_str());
+			std::locale::global(m_cpp);
+		}
+	private:
+		std::locale	m_cpp;
+		std::string	m_c;
+	};
+
+}
+
+
+/// \brief Numbers are written with a dot under a comma-decimal locale
+int TestHandle::tswriter() {
+	commalocale l;
+	textwriter w;
+	w.putdouble(0.1);
+	w.put(' ');
+	w.putdouble(1234.5);
+	w.put(' ');
+	w.putdouble(-1e20);
+	w.put(' ');
+	w.putdouble(1.0/3);
+	w.put(' ');
+	w.putfloat(0.1f);
+	if(w.str() != "0.1 1234.5 -1e+20 0.3333333333333333 0.1")
+		return 1;
+	mapts m("w");
+	m.add(qdate(2010,1,4),1.25);
+	m.add(qdate(2010,1,5),-2500.5);
+	if(ts::writer::tocsv(m,';') != "date;w\n2010-01-04;1.25\n2010-01-05;-2500.5\n")
+		return 2;
+	if(ts::writer::tojson(m) != "[[1262563200000,1.25],[1262649600000,-2500.5]]")
+		return 3;
+	return 0;
+}
+
+}}